@@ -2,9 +2,34 @@
 #define ROC_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 
 typedef enum { NODE_CPU, NODE_GPU, NODE_MEMORY, NODE_STORAGE } NodeType;
 
+struct RNode;
+typedef void (*NodeWatchFn)(struct RNode* node, void* arg);
+
+// Called after capacity is returned to a node (on_reserve: after it is taken).
+// Entries are only unlinked when the node is destroyed, so release() and
+// reserve() walk the list without a lock; node_unwatch frees an entry for
+// the next node_watch on the same node, so the list never grows past the
+// most watchers the node has had at once.
+typedef enum {
+    WATCH_FREE,        // unused, may be claimed
+    WATCH_CLAIMED,     // being filled in by node_watch_all
+    WATCH_LIVE,        // callbacks run
+    WATCH_RETIRING     // node_unwatch is waiting for running callbacks
+} NodeWatchState;
+
+typedef struct RNodeWatcher {
+    NodeWatchFn fn;           // optional, after each release()
+    NodeWatchFn on_reserve;   // optional, after each successful reserve()
+    void* arg;
+    atomic_int state;         // NodeWatchState
+    atomic_int inflight;      // callbacks running right now
+    struct RNodeWatcher* next;
+} RNodeWatcher;
+
 // =====================
 // Resource Node
 // =====================
@@ -19,7 +44,12 @@ typedef struct RNode {
     struct RLink** links; // connected links
     int link_count;
 
+    int id;               // index in owning network, -1 when detached
+    struct RNetwork* net; // owning network, NULL when detached
+    int host;             // nodes sharing a host id are co-located; -1 = none
     void* metadata;       // optional user-defined data
+
+    _Atomic(RNodeWatcher*) watchers;   // notified by release()
 } RNode;
 
 // =====================
@@ -43,6 +73,12 @@ typedef struct RLink {
     int latency;    // milliseconds
     unsigned int permissions;
     int enabled;
+
+    struct RNetwork* net; // owning network, notified on attribute changes
+    struct RLinkQueue* txq; // transmit queue, one chunk on the wire at a time
+    atomic_int load;        // units queued for or crossing the link right now
+    int id;                 // unique within the network, never reused
+    struct RLink* retired;  // next removed link awaiting destroy_network
 } RLink;
 
 // =====================
@@ -54,6 +90,15 @@ typedef struct RNetwork {
 
     RLink** links;
     int link_count;
+
+    int next_link_id;
+    RLink* retired_links;                 // removed links, still reachable from snapshots and transfers
+    pthread_rwlock_t lock;                // written while nodes/links are reallocated
+    atomic_ulong version;                 // bumped on every topology change
+    struct RContractionHierarchy* ch;     // optional latency routing index
+
+    struct RTopology* topology;           // cached snapshot, see topology_current()
+    pthread_rwlock_t topology_lock;       // guards swapping in a fresh one
 } RNetwork;
 
 // =====================
@@ -79,12 +124,20 @@ typedef struct TimedReserveArgs {
 // =====================
 typedef enum {
     POLICY_SHORTEST,
-    POLICY_WIDEST
+    POLICY_WIDEST,
+    POLICY_LATENCY,       // lowest summed link latency (uses net->ch when attached)
+    POLICY_LEAST_LOADED,  // lowest summed backlog time (load+1)/bandwidth + latency
+    POLICY_FASTEST_COMPLETION  // lowest sum(latency) + amount / bottleneck bandwidth
 } RoutePolicy;
 
+#define MAX_PATH_LEN 256
+
 // Forward declarations for policy-based pathfinding
 int find_path_shortest(RNetwork* net, RNode* src, RNode* dst, RLink** path, int* plen);
 int find_path_widest(RNetwork* net, RNode* src, RNode* dst, RLink** path, int* plen);
+int find_path_latency(RNetwork* net, RNode* src, RNode* dst, RLink** path, int* plen);
+int find_path_least_loaded(RNetwork* net, RNode* src, RNode* dst, RLink** path, int* plen);
+int find_path_fastest(RNetwork* net, RNode* src, RNode* dst, int amount, RLink** path, int* plen);
 
 // =====================
 // Node management
@@ -100,6 +153,13 @@ typedef enum { STATUS_OK, STATUS_BUSY, STATUS_OVERLOAD } NodeStatus;
 int reserve(RNode* node, int amount);
 void release(RNode* node, int amount);
 int monitor(RNode* node);
+RNodeWatcher* node_watch(RNode* node, NodeWatchFn fn, void* arg);
+RNodeWatcher* node_watch_all(RNode* node, NodeWatchFn on_release, NodeWatchFn on_reserve, void* arg);
+// Returns once no callback is running. Must not be called from one of the
+// watcher's own callbacks, which would wait for itself.
+void node_unwatch(RNodeWatcher* watcher);
+// Move capacity in use over the nodes' shared network and wait for it; the
+// timed variant gives the migrated units back on the target after timeout_ms
 int migrate(RPacket* pkt, RNode* from, RNode* to);
 int migrate_timed(RNode* from, RNode* to, int amount, int timeout_ms);
 int reserve_timed(RNode* node, int amount, int timeout_ms);
@@ -122,6 +182,7 @@ int get_link_latency(RLink* link);
 void disable_link(RLink* link);
 void enable_link(RLink* link);
 int is_link_enabled(RLink* link);
+int get_link_load(RLink* link);
 
 // =====================
 // Network management
@@ -137,19 +198,29 @@ int count_links(RNetwork* net);
 void list_links(RNetwork* net);
 int connect_nodes(RNetwork* net, const char* name1, const char* name2, int bandwidth, int latency);
 int disconnect_nodes(RNetwork* net, const char* name1, const char* name2);
+void network_changed(RNetwork* net);   // bump version and invalidate routing indexes
 
 // =====================
 // Routing / transfer
 // =====================
 int route_packet(RNetwork* net, RNode* src, RNode* dst, RPacket* pkt, RoutePolicy policy);
 
+// Move pkt across a precomputed path (path[0] = last hop) with link queueing
+// and simulated delays, without reserving or releasing node capacity
+int carry_packet(RNode* src, RLink** path, int plen, RPacket* pkt, RoutePolicy policy, int chunk);
+
 // =====================
 // RController
 // =====================
 typedef struct RController {
     RNetwork* network;
-    RoutePolicy policy;       // Default routing policy
-    pthread_mutex_t lock;     // For thread-safe operations
+    _Atomic RoutePolicy policy;     // Default routing policy
+
+    pthread_rwlock_t lock;          // guards starting the engine
+
+    struct RTransferEngine* engine;  // async transfers, started on demand
+    atomic_int chunk_size;           // units per link grant, 0 = whole packet
+    atomic_int cut_through;          // chunks pipeline through all hops at once
 } RController;
 
 // Controller operations
@@ -160,7 +231,32 @@ void destroy_controller(RController* ctrl);
 int send_packet(RController* ctrl, RNode* src, RNode* dst, int amount);
 int send_packet_timed(RController* ctrl, RNode* src, RNode* dst, int amount, int timeout_ms);
 
+// Sends many packets at once: one route search per source, one transfer per
+// (src, dst) pair. Blocks until all are done; returns the number delivered.
+int send_packets_batch(RController* ctrl, RPacket* pkts, int n);
+int send_packet_priority(RController* ctrl, RNode* src, RNode* dst, int amount, int priority);
+
+// Route lookup under the controller's current policy (snapshot / CH backed)
+int controller_route(RController* ctrl, RNode* src, RNode* dst, int amount, RLink** path, int* plen);
+
 // Change the controller's default policy
 void set_policy(RController* ctrl, RoutePolicy policy);
 
+// Split transfers into chunks of this many units so higher-priority packets
+// can interleave on shared links (0 sends each packet as one piece)
+void set_chunk_size(RController* ctrl, int units);
+
+// Cut-through mode: chunks move through all hops at once instead of each hop
+// waiting for the whole packet (needs a chunk size; sends run on the engine)
+void set_cut_through(RController* ctrl, int enabled);
+
+// Asynchronous sends (see roc_transfer.h for poll/wait/release on the handle).
+// Returns NULL when there is no route or the source lacks capacity.
+struct RTransfer;
+int controller_start_engine(RController* ctrl, int threads);
+struct RTransfer* send_packet_async(RController* ctrl, RNode* src, RNode* dst, int amount,
+                                    void (*callback)(struct RTransfer*, void*), void* arg);
+struct RTransfer* send_packet_async_priority(RController* ctrl, RNode* src, RNode* dst, int amount, int priority,
+                                             void (*callback)(struct RTransfer*, void*), void* arg);
+
 #endif
@@ -35,7 +35,11 @@ typedef struct {
     int priority;         // bundle-level priority
     BundleStatus status;
 
+    int pending;          // items not yet finished in the current run
+    RCompletionHook* hooks;
+
     pthread_mutex_t lock;
+    pthread_cond_t done;  // broadcast when the last item finishes
 } RBundle;
 
 // Bundle operations
@@ -49,4 +53,9 @@ int bundle_add_task(RBundle* bundle, RTask* task);
 int bundle_run(RBundle* bundle, RTaskScheduler* sched);
 BundleStatus bundle_status(RBundle* bundle);
 
+// A run finishes once every item has; both return at once for a bundle
+// that is not running
+BundleStatus bundle_wait(RBundle* bundle);
+int bundle_on_complete(RBundle* bundle, CompletionFn fn, void* arg);   // fn(bundle, arg)
+
 #endif
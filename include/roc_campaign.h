@@ -23,7 +23,11 @@ typedef struct {
     int priority;  // campaign-level priority
     CampaignStatus status;
 
+    int running;   // campaign_run in progress
+    RCompletionHook* hooks;
+
     pthread_mutex_t lock;
+    pthread_cond_t done;   // broadcast when campaign_run finishes
 } RCampaign;
 
 // Campaign operations
@@ -34,4 +38,9 @@ int campaign_add_bundle(RCampaign* campaign, RBundle* bundle);
 int campaign_run(RCampaign* campaign, RTaskScheduler* sched);
 CampaignStatus campaign_status(RCampaign* campaign);
 
+// For other threads: campaign_run itself returns once the campaign is done.
+// Both return at once if the campaign is not running.
+CampaignStatus campaign_wait(RCampaign* campaign);
+int campaign_on_complete(RCampaign* campaign, CompletionFn fn, void* arg);   // fn(campaign, arg)
+
 #endif
@@ -0,0 +1,49 @@
+#ifndef ROC_CH_H
+#define ROC_CH_H
+
+#include "roc.h"
+#include <pthread.h>
+
+// =====================
+// Contraction hierarchy
+// =====================
+// Optional preprocessing of a mostly static RNetwork for latency routing.
+// Nodes are contracted in importance order and shortcut edges preserve
+// shortest latencies, so a point-to-point query only searches "upward"
+// from both endpoints and settles a tiny fraction of the graph.
+//
+// The hierarchy attaches itself to net->ch; route_packet() then uses it
+// for POLICY_LATENCY. Any topology change marks it dirty and a background
+// thread rebuilds it, swapping the new graph in atomically for readers.
+// The rebuild copies the network under net->lock, so edits may continue
+// while it runs. Until it is done the graph is stale and latency routing
+// falls back to find_path_latency.
+
+typedef struct CHGraph CHGraph;   // immutable contracted graph
+
+typedef struct RContractionHierarchy {
+    RNetwork* network;
+
+    CHGraph* graph;                // current hierarchy
+    pthread_rwlock_t graph_lock;   // queries read, rebuild swaps
+
+    pthread_mutex_t lock;          // protects dirty/running
+    pthread_cond_t cond;
+    int dirty;                     // topology changed since last build
+    int running;                   // background rebuild thread active
+    pthread_t thread;
+} RContractionHierarchy;
+
+// Build the hierarchy, attach it to net and start background rebuilds
+RContractionHierarchy* create_contraction_hierarchy(RNetwork* net);
+void destroy_contraction_hierarchy(RContractionHierarchy* ch);
+
+int ch_rebuild(RContractionHierarchy* ch);        // synchronous rebuild
+void ch_invalidate(RContractionHierarchy* ch);    // schedule background rebuild
+int ch_shortcut_count(RContractionHierarchy* ch);
+
+// Lowest-latency path, unpacked into RLink* hops (same layout as find_path_*).
+// Returns -1 when the graph is older than the network; search without it.
+int find_path_ch(RContractionHierarchy* ch, RNode* src, RNode* dst, RLink** path, int* plen);
+
+#endif
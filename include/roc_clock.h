@@ -0,0 +1,45 @@
+#ifndef ROC_CLOCK_H
+#define ROC_CLOCK_H
+
+#include <pthread.h>
+
+// =====================
+// ROC clock
+// =====================
+// Every simulated delay in ROC goes through this module. In real mode the
+// calls map straight onto the OS (monotonic time, sleeps, pthread condition
+// variables). In virtual mode time is a counter owned by a discrete-event
+// simulator: a sleeping or waiting thread becomes an event in a priority
+// queue, and once every participating thread is blocked the clock jumps
+// to the earliest event and releases exactly one waiter. Runs therefore
+// finish as fast as the CPU allows and in a deterministic order.
+//
+// Participants are the threads ROC spawns through roc_thread_spawn() plus
+// the thread that enabled virtual mode. Other threads may call into the
+// clock but are not waited for. Switch modes before starting any work.
+
+void roc_clock_use_virtual(void);
+void roc_clock_use_real(void);
+int roc_clock_is_virtual(void);
+
+long long roc_now_us(void);          // monotonic, real or virtual
+long long roc_now_ms(void);
+void roc_sleep_us(long long us);
+void roc_sleep_ms(long long ms);
+
+// Condition variables that the simulator can see (plain pthread in real mode).
+// Deadlines are absolute roc_now_us() values; timedwait returns ETIMEDOUT.
+void roc_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+int roc_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, long long deadline_us);
+void roc_cond_signal(pthread_cond_t* cond);
+void roc_cond_broadcast(pthread_cond_t* cond);
+
+// Start a participating thread; out == NULL creates it detached. Returns 1 on success.
+int roc_thread_spawn(pthread_t* out, void* (*func)(void*), void* arg);
+int roc_thread_join(pthread_t thread);   // counts the caller as blocked meanwhile
+
+// Register/unregister a thread that was not started by roc_thread_spawn()
+void roc_clock_thread_enter(void);
+void roc_clock_thread_leave(void);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef ROC_COMPLETION_H
+#define ROC_COMPLETION_H
+
+// =====================
+// Completion callbacks
+// =====================
+// One-shot callbacks that a task or container runs when it finishes. The
+// owner keeps the list under its own lock, detaches it when it finishes and
+// runs it after unlocking, so a callback may take other locks (a parent
+// container counting its children, for instance).
+typedef void (*CompletionFn)(void* source, void* arg);
+
+typedef struct RCompletionHook {
+    CompletionFn fn;
+    void* arg;
+    struct RCompletionHook* next;
+} RCompletionHook;
+
+int completion_hook_add(RCompletionHook** list, CompletionFn fn, void* arg);   // 0 on OOM
+void completion_hooks_run(RCompletionHook* list, void* source);   // in order added, then frees
+void completion_hooks_free(RCompletionHook* list);
+
+#endif
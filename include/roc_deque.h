@@ -0,0 +1,37 @@
+#ifndef ROC_DEQUE_H
+#define ROC_DEQUE_H
+
+#include <stdatomic.h>
+
+// Chase–Lev work-stealing deque. The owning thread pushes and takes at the
+// bottom (LIFO, cache-warm); any other thread steals from the top (FIFO).
+// Neither end takes a lock. The buffer grows on demand; replaced buffers
+// are kept until the deque is freed because a thief may still read them.
+
+#define ROC_DEQUE_EMPTY ((void*)0)
+#define ROC_DEQUE_ABORT ((void*)1)   // steal lost a race; retry or move on
+
+typedef struct RDequeArray {
+    long size;                       // power of two
+    struct RDequeArray* retired;     // previous, smaller buffer
+    _Atomic(void*) items[];
+} RDequeArray;
+
+typedef struct {
+    atomic_long top;
+    char pad[64 - sizeof(atomic_long)];   // keep thieves off the owner's line
+    atomic_long bottom;
+    _Atomic(RDequeArray*) array;
+} RDeque;
+
+// =====================
+// Deque operations
+// =====================
+void deque_init(RDeque* d, long initial_size);
+void deque_free(RDeque* d);
+
+void deque_push(RDeque* d, void* item);   // owner only
+void* deque_take(RDeque* d);              // owner only; ROC_DEQUE_EMPTY if empty
+void* deque_steal(RDeque* d);             // any thread; EMPTY or ABORT when nothing was taken
+
+#endif
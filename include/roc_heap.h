@@ -0,0 +1,37 @@
+#ifndef ROC_HEAP_H
+#define ROC_HEAP_H
+
+// Growable d-ary min-heap keyed by (key, insertion order).
+// Equal keys pop in FIFO order, which keeps every user of the heap
+// (routing searches, timers, schedulers) deterministic.
+
+#define ROC_HEAP_ARITY 4
+
+typedef struct {
+    long long key;
+    unsigned long long seq;   // insertion sequence, breaks key ties
+    void* data;
+} RHeapItem;
+
+typedef struct {
+    RHeapItem* items;
+    int count;
+    int capacity;
+    unsigned long long next_seq;
+} RHeap;
+
+// =====================
+// Heap operations
+// =====================
+void heap_init(RHeap* heap);
+void heap_free(RHeap* heap);
+void heap_clear(RHeap* heap);
+
+int heap_push(RHeap* heap, long long key, void* data);   // 1 on success, 0 on OOM
+int heap_push_item(RHeap* heap, const RHeapItem* item);  // re-insert a popped item, keeping its place
+int heap_pop(RHeap* heap, RHeapItem* out);               // 0 if empty
+int heap_remove(RHeap* heap, void* data);                // linear search; 0 if absent
+RHeapItem* heap_peek(RHeap* heap);                       // NULL if empty
+int heap_size(RHeap* heap);
+
+#endif
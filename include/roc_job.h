@@ -21,8 +21,14 @@ typedef struct {
 
     int priority;          // job-level priority
     JobStatus status;
+    int gang;              // tasks start together or not at all
+    int owner;             // tenant for every task, -1 = as set on each task
+
+    int pending;           // tasks not yet finished in the current run
+    RCompletionHook* hooks;
 
     pthread_mutex_t lock;
+    pthread_cond_t done;   // broadcast when the last task finishes
 
     // Dependency tracking
     int dep_matrix[MAX_TASKS_PER_JOB][MAX_TASKS_PER_JOB]; 
@@ -34,7 +40,14 @@ RJob* create_job(const char* name, int priority);
 void destroy_job(RJob* job);
 
 int job_add_task(RJob* job, RTask* task);
+void job_set_gang(RJob* job, int gang);   // takes effect on the next job_run
+void job_set_owner(RJob* job, int owner); // likewise; see scheduler_set_owner_weight
 int job_run(RJob* job, RTaskScheduler* sched);  // enqueue all tasks
 JobStatus job_status(RJob* job);
 
+// A run finishes once every task has completed or failed; the job must
+// outlive its run. Both return at once for a job that is not running.
+JobStatus job_wait(RJob* job);
+int job_on_complete(RJob* job, CompletionFn fn, void* arg);   // fn(job, arg)
+
 #endif
@@ -0,0 +1,47 @@
+#ifndef ROC_LINKQ_H
+#define ROC_LINKQ_H
+
+#include "roc_heap.h"
+#include <pthread.h>
+
+#define LINKQ_CLASSES 8            // WFQ classes; packet priority is clamped into 0..7
+
+typedef enum {
+    LINKQ_STRICT,                  // highest RPacket::priority first, FIFO within a priority
+    LINKQ_WFQ                      // weighted fair queueing, class weight = priority + 1
+} LinkQueueMode;
+
+typedef void (*LinkGrantFn)(void* arg);
+
+// =====================
+// Link transmit queue
+// =====================
+// A link carries one chunk at a time. Senders ask for the wire with the
+// chunk's priority and size; whoever is waiting longest in the best class
+// gets it when the current chunk finishes. Waiting is expressed through a
+// grant callback so both blocking senders and the transfer engine can use it.
+typedef struct RLinkQueue {
+    pthread_mutex_t lock;
+    LinkQueueMode mode;
+    int busy;                      // a chunk is on the wire
+    RHeap waiting;                 // key = -priority (strict) or finish tag (WFQ)
+
+    long long vtime;               // WFQ: finish tag of the chunk in service
+    long long last_finish[LINKQ_CLASSES];
+} RLinkQueue;
+
+RLinkQueue* create_link_queue(void);
+void destroy_link_queue(RLinkQueue* q);
+void linkq_set_mode(RLinkQueue* q, LinkQueueMode mode);
+
+// Returns 1 if the wire was free and is now held by the caller (grant is not
+// called). Returns 0 if queued; grant(arg) runs once the caller holds it.
+int linkq_acquire(RLinkQueue* q, int priority, int size, LinkGrantFn grant, void* arg);
+void linkq_acquire_wait(RLinkQueue* q, int priority, int size);   // blocking form
+void linkq_release(RLinkQueue* q);                                 // hand over to the next waiter
+// Withdraw a queued acquire. Returns 1 if it was still waiting (grant will
+// never run), 0 if it was already granted or never queued.
+int linkq_cancel(RLinkQueue* q, LinkGrantFn grant, void* arg);
+int linkq_waiting(RLinkQueue* q);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef ROC_LOG_H
+#define ROC_LOG_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+// =====================
+// ROC log
+// =====================
+// Leveled logging for every ROC module. Statements below ROC_LOG_LEVEL
+// compile to nothing (their arguments are type-checked, never evaluated);
+// the rest are filtered at runtime against roc_log_set_level, which starts
+// at ROC_LEVEL_WARN. Records that pass are prefixed with their level,
+// formatted by the caller, pushed onto a lock-free queue and written by a
+// single background thread, so logging threads never contend on stdio.
+// Build with -DROC_LOG_LEVEL=ROC_LEVEL_OFF to drop all module output.
+
+#define ROC_LEVEL_DEBUG 0
+#define ROC_LEVEL_INFO  1
+#define ROC_LEVEL_WARN  2
+#define ROC_LEVEL_ERROR 3
+#define ROC_LEVEL_OFF   4
+
+#ifndef ROC_LOG_LEVEL
+#define ROC_LOG_LEVEL ROC_LEVEL_INFO
+#endif
+
+#define ROC_LOG_MSG_MAX 256      // longer messages are truncated
+
+extern atomic_int roc_log_runtime_level;   // read by ROC_LOG_AT, set through roc_log_set_level
+
+void roc_log_write(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void roc_log_set_level(int level);    // default ROC_LEVEL_WARN
+int roc_log_level(void);
+void roc_log_set_output(FILE* out);   // default stdout
+void roc_log_flush(void);             // returns once every record logged so far is written
+
+#define ROC_LOG_AT(level, ...) \
+    do {                                                                            \
+        if ((level) >= ROC_LOG_LEVEL &&                                             \
+            (level) >= atomic_load_explicit(&roc_log_runtime_level, memory_order_relaxed)) \
+            roc_log_write((level), __VA_ARGS__);                                    \
+    } while (0)
+
+#define ROC_DEBUG(...) ROC_LOG_AT(ROC_LEVEL_DEBUG, __VA_ARGS__)
+#define ROC_INFO(...)  ROC_LOG_AT(ROC_LEVEL_INFO, __VA_ARGS__)
+#define ROC_WARN(...)  ROC_LOG_AT(ROC_LEVEL_WARN, __VA_ARGS__)
+#define ROC_ERROR(...) ROC_LOG_AT(ROC_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
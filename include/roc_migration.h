@@ -0,0 +1,82 @@
+#ifndef ROC_MIGRATION_H
+#define ROC_MIGRATION_H
+
+#include "roc.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MIGRATION_DEFAULT_CHUNK 10
+#define MIGRATION_DEFAULT_CONCURRENCY 4
+
+typedef enum {
+    MIGRATION_PENDING,
+    MIGRATION_RUNNING,
+    MIGRATION_COMPLETED,
+    MIGRATION_FAILED
+} MigrationStatus;
+
+struct RMigration;
+typedef void (*MigrationProgressFn)(struct RMigration* m, int moved, int total,
+                                    double units_per_sec, void* arg);
+typedef void (*MigrationDoneFn)(struct RMigration* m, void* arg);
+
+// =====================
+// Migration handle
+// =====================
+// Moves capacity in use from one node to another over the network. Each
+// chunk is claimed on the target, carried along the controller's route and
+// then freed on the source, so both sides show partial progress.
+typedef struct RMigration {
+    RNode* from;
+    RNode* to;
+    int amount;
+    int chunk;
+
+    int moved;               // units landed on the target so far
+    MigrationStatus status;
+    long long started_us;    // roc_now_us() when the first chunk left
+    long long finished_us;
+
+    MigrationProgressFn on_progress;
+    MigrationDoneFn on_done;
+    void* arg;
+
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    atomic_int refs;         // one for the caller, one while in the engine
+    struct RMigration* next; // pending queue
+} RMigration;
+
+// =====================
+// Migration engine
+// =====================
+typedef struct RMigrationEngine {
+    RController* ctrl;       // routing policy and topology snapshots
+
+    RMigration* head;        // pending, FIFO
+    RMigration* tail;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    pthread_t* threads;      // one per concurrent migration
+    int thread_count;
+    int running;
+
+    atomic_llong total_moved;
+} RMigrationEngine;
+
+RMigrationEngine* create_migration_engine(RController* ctrl, int max_concurrent);
+void destroy_migration_engine(RMigrationEngine* engine);   // pending migrations fail on engine threads
+
+// chunk <= 0 uses the controller's chunk size (or MIGRATION_DEFAULT_CHUNK).
+// Callbacks run on an engine thread; on_done fires exactly once.
+RMigration* migration_submit(RMigrationEngine* engine, RNode* from, RNode* to, int amount, int chunk,
+                             MigrationProgressFn on_progress, MigrationDoneFn on_done, void* arg);
+
+MigrationStatus migration_poll(RMigration* m);
+MigrationStatus migration_wait(RMigration* m);
+int migration_moved(RMigration* m);
+double migration_throughput(RMigration* m);   // units/sec so far
+void migration_release(RMigration* m);        // drop the caller's reference
+
+#endif
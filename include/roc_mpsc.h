@@ -0,0 +1,36 @@
+#ifndef ROC_MPSC_H
+#define ROC_MPSC_H
+
+#include <stdatomic.h>
+
+// Intrusive multi-producer / single-consumer queue (Vyukov). Producers
+// never block and never retry: a push is one atomic exchange. Embed an
+// RMpscNode in the element and recover the element from the popped node.
+//
+// A pop can report empty for a moment while a producer is half-way through
+// its push; the consumer simply sees that element on its next pass.
+//
+// The exchange in mpsc_push is sequentially consistent, so a producer may
+// check a "consumer is sleeping" flag right after pushing; a consumer that
+// sets the flag and then finds mpsc_empty() true cannot miss that push.
+
+typedef struct RMpscNode {
+    _Atomic(struct RMpscNode*) next;
+} RMpscNode;
+
+typedef struct {
+    _Atomic(RMpscNode*) head;   // producers swap themselves in here
+    char pad[64 - sizeof(RMpscNode*)];   // keep producers off the consumer's line
+    RMpscNode* tail;            // consumer side only
+    RMpscNode stub;
+} RMpscQueue;
+
+// =====================
+// Queue operations
+// =====================
+void mpsc_init(RMpscQueue* q);
+int mpsc_push(RMpscQueue* q, RMpscNode* node);   // any thread; 1 if the queue looked empty (a hint)
+RMpscNode* mpsc_pop(RMpscQueue* q);              // consumer only; NULL if empty
+int mpsc_empty(RMpscQueue* q);                   // consumer only; 0 while a push is in flight
+
+#endif
@@ -18,6 +18,9 @@ typedef struct {
     int stage_count;
     int priority;
     PhaseStatus status;
+    RCompletionHook* hooks;
+    pthread_mutex_t lock;
+    pthread_cond_t done;    // broadcast when a run finishes
 } RPhase;
 
 // Phase operations
@@ -29,4 +32,9 @@ int phase_add_stage(RPhase* phase, RStage* stage);
 int phase_run(RPhase* phase, RTaskScheduler* sched);            // pass scheduler here
 PhaseStatus phase_status(RPhase* phase);
 
+// Stages run one after another; a failed stage fails the phase and the
+// stages after it do not start. Both return at once if the phase is not running.
+PhaseStatus phase_wait(RPhase* phase);
+int phase_on_complete(RPhase* phase, CompletionFn fn, void* arg);   // fn(phase, arg)
+
 #endif
@@ -20,7 +20,9 @@ typedef struct {
     int task_count;
     int priority;         // New: pipe-level priority
     PipeStatus status;
+    RCompletionHook* hooks;
     pthread_mutex_t lock;
+    pthread_cond_t done;  // broadcast when the run finishes
 } RPipe;
 
 // Pipe operations
@@ -31,4 +33,8 @@ int pipe_add_task(RPipe* pipe, RTask* task);
 int pipe_run(RPipe* pipe, RTaskScheduler* sched);
 PipeStatus pipe_status(RPipe* pipe);
 
+// Both return at once for a pipe that is not running
+PipeStatus pipe_wait(RPipe* pipe);
+int pipe_on_complete(RPipe* pipe, CompletionFn fn, void* arg);   // fn(pipe, arg)
+
 #endif
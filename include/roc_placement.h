@@ -0,0 +1,66 @@
+#ifndef ROC_PLACEMENT_H
+#define ROC_PLACEMENT_H
+
+#include "roc.h"
+#include "roc_task.h"
+#include "roc_mpsc.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define PLACEMENT_MAX_PROBES 64   // hosts tried for one co-location group
+
+typedef enum {
+    PLACE_BEST_FIT,    // fullest node that still fits
+    PLACE_WORST_FIT,   // emptiest node
+    PLACE_FIRST_FIT    // lowest node id that fits
+} PlacementPolicy;
+
+struct PlaceEntry;
+struct PlaceIndex;
+
+// =====================
+// Placement engine
+// =====================
+// Binds unbound requirements (TaskResourceReq::node == NULL) to nodes of a
+// network. Each node type has a treap keyed by (available, node id) and
+// augmented with the smallest id in each subtree, so best-, worst- and
+// first-fit lookups are O(log nodes) whatever the cluster size.
+//
+// The index follows reserve() and release() through node watchers, which
+// only queue the node; queued nodes are re-read before the next lookup, and
+// every candidate is checked against monitor(). Requirements of a task that share
+// a group are placed on nodes with the same RNode::host; a bound member of
+// the group fixes the host. The node set is taken from the network when the
+// engine is created.
+typedef struct RPlacement {
+    RNetwork* net;
+    PlacementPolicy policy;
+
+    struct PlaceEntry* entries;   // one per network node, by RNode::id
+    int entry_count;
+    struct PlaceIndex* types;     // one treap per node type
+    int type_count;
+    RNodeWatcher** watches;
+
+    RMpscQueue stale;             // nodes released since the last lookup
+    NodeWatchFn on_release;       // optional listener, after the refresh is queued
+    void* release_arg;
+
+    pthread_mutex_t lock;
+} RPlacement;
+
+RPlacement* create_placement(RNetwork* net, PlacementPolicy policy);   // NULL when out of memory
+void destroy_placement(RPlacement* p);
+void placement_set_policy(RPlacement* p, PlacementPolicy policy);
+void placement_set_listener(RPlacement* p, NodeWatchFn fn, void* arg);   // set before use
+
+// Choose nodes for every unbound (or previously placed) requirement, then
+// reserve the whole task as allocate_task / try_allocate_task do. Bound
+// requirements are kept as they are.
+int placement_allocate(RPlacement* p, RTask* task);       // the task fails if it cannot be placed
+int placement_try_allocate(RPlacement* p, RTask* task);   // status unchanged if it cannot
+
+// 0 if some unbound requirement is larger than every node of its type
+int placement_can_ever_fit(RPlacement* p, RTask* task);
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef ROC_POOL_H
+#define ROC_POOL_H
+
+#include "roc_heap.h"
+#include "roc_deque.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Coarse priority bands, highest first: >= 10, 1..9, 0, < 0
+#define ROC_POOL_BANDS 4
+
+typedef void (*RPoolFn)(void* arg);
+
+// Embed one in a long-lived object to submit it without allocating
+typedef struct {
+    RPoolFn fn;
+    void* arg;
+    int band;                // set on submit
+    int owned;               // pool frees the job after running it
+} RPoolJob;
+
+typedef struct {
+    RPoolJob** jobs;         // circular FIFO
+    int head;
+    int count;
+    int capacity;
+} RPoolRing;
+
+struct RWorkerPool;
+
+typedef struct {
+    RDeque local[ROC_POOL_BANDS];   // jobs submitted by this worker
+    struct RWorkerPool* pool;
+    unsigned rng;                   // victim selection
+    int cpu;                        // -1 = not pinned
+} RPoolWorker;
+
+// =====================
+// Worker pool
+// =====================
+// A fixed set of threads started once, so running work never creates or
+// tears down a thread. Each worker owns a work-stealing deque per priority
+// band: jobs submitted from a worker stay on its deque, jobs from other
+// threads go through a shared injection queue, and idle workers steal from
+// random victims. A worker always looks for higher-band work anywhere
+// before running lower-band work of its own.
+//
+// Delayed jobs wait in a deadline heap (roc_now_us() time) and join the
+// injection queue when due; they do not occupy a worker while waiting.
+// Workers check the earliest deadline between jobs, so a saturated pool
+// does not hold due jobs back.
+typedef struct RWorkerPool {
+    RPoolWorker* workers;
+    int worker_count;
+    pthread_t* threads;
+    int thread_count;                     // started workers
+
+    atomic_long queued[ROC_POOL_BANDS];   // runnable jobs, any queue
+    atomic_int sleepers;                  // workers parked on `work`
+
+    pthread_mutex_t lock;                 // injection queues, delayed heap, parking
+    pthread_cond_t work;                  // parked workers: a job is ready
+    pthread_cond_t timer;                 // timekeeper: the earliest deadline changed
+    RPoolRing inject[ROC_POOL_BANDS];
+    atomic_int injected;                  // jobs in the injection queues
+    RHeap delayed;                        // key = due time in us, data = RPoolJob*
+    atomic_llong next_due;                // earliest key in `delayed`, LLONG_MAX when empty
+    int timekeeper;                       // a parked worker sleeps until the earliest deadline
+    int parked;                           // workers waiting on `work`
+
+    atomic_int running;
+} RWorkerPool;
+
+int roc_cpu_count(void);
+int worker_pool_band(int priority);
+
+// threads <= 0 sizes the pool to the machine; pin_cpus != 0 pins worker i to CPU i % cpus
+RWorkerPool* create_worker_pool(int threads, int pin_cpus);
+void destroy_worker_pool(RWorkerPool* pool);   // waits for queued and delayed jobs
+
+// All return 1 on success. The *_job variants never allocate; the job must
+// stay valid until its function runs.
+int worker_pool_submit(RWorkerPool* pool, RPoolFn fn, void* arg);
+int worker_pool_submit_after(RWorkerPool* pool, long long delay_us, RPoolFn fn, void* arg);
+int worker_pool_submit_job(RWorkerPool* pool, RPoolJob* job, int priority);
+int worker_pool_submit_job_after(RWorkerPool* pool, RPoolJob* job, int priority, long long delay_us);
+int worker_pool_size(RWorkerPool* pool);
+
+// Withdraw a delayed job that is still waiting for its deadline; 1 if it
+// was withdrawn and will not run. Linear in the delayed jobs.
+int worker_pool_cancel_job(RWorkerPool* pool, RPoolJob* job);
+
+// Shared pool used by run_task() / run_task_async(), created on first use
+RWorkerPool* roc_default_pool(void);
+void roc_set_default_pool_size(int threads, int pin_cpus);   // before first use; ignored after
+
+#endif
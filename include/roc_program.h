@@ -22,7 +22,11 @@ typedef struct {
     int priority; // Program-level priority
     ProgramStatus status;
 
+    int running;  // program_run in progress
+    RCompletionHook* hooks;
+
     pthread_mutex_t lock;
+    pthread_cond_t done;  // broadcast when program_run finishes
 } RProgram;
 
 // Program operations
@@ -33,4 +37,9 @@ int program_add_campaign(RProgram* program, RCampaign* campaign);
 int program_run(RProgram* program, RTaskScheduler* sched);
 ProgramStatus program_status(RProgram* program);
 
+// For other threads: program_run itself returns once the program is done.
+// Both return at once if the program is not running.
+ProgramStatus program_wait(RProgram* program);
+int program_on_complete(RProgram* program, CompletionFn fn, void* arg);   // fn(program, arg)
+
 #endif
@@ -3,30 +3,174 @@
 
 #include "roc_task.h"
 #include "roc.h"
+#include "roc_pool.h"
+#include "roc_heap.h"
+#include "roc_mpsc.h"
+#include "roc_placement.h"
 #include <pthread.h>
+#include <stdatomic.h>
 
-#define MAX_TASK_QUEUE 128
+#define SCHED_BACKFILL_DEPTH 64   // queued tasks examined behind a blocked head
+#define SCHED_GANG_MAX 16         // tasks per gang
+#define SCHED_UNIT_DEMAND 128     // distinct nodes one queue entry may name
+#define SCHED_RESOURCE_TYPES 8    // node types tracked for fair sharing
+#define SCHED_OWNER_MAX 65536     // owner ids are 0 .. SCHED_OWNER_MAX - 1
 
-typedef struct {
-    RTask* queue[MAX_TASK_QUEUE];
+// Queue order among tasks of equal priority
+typedef enum {
+    SCHED_PACK_FIFO,          // submission order
+    SCHED_PACK_GANGS_FIRST    // gangs before single tasks, largest gang first
+} SchedPacking;
+
+// Tasks that are allocated and started together, or not at all. Queued
+// through its first task.
+typedef struct RGang {
     int count;
+    int units;               // total units over all requirements
+    RTask* tasks[SCHED_GANG_MAX];
+} RGang;
+
+// A tenant sharing the cluster. Usage per node type is charged when its
+// tasks start and refunded when they finish.
+typedef struct {
+    RHeap queue;       // pending entries, key = -priority (packing among equals)
+    double weight;
+    long long used[SCHED_RESOURCE_TYPES];
+    double share;      // dominant share: max over types of used / total, over weight
+    int ready_slot;    // position in the scheduler's ready heap, -1 if absent
+} RSchedOwner;
+
+// Outcomes of tasks with a deadline
+typedef struct {
+    long long admitted;
+    long long rejected;          // failed at admission: could not finish in time
+    long long met;
+    long long missed;
+    long long total_late_us;     // summed over missed deadlines
+    long long max_late_us;
+} RSchedDeadlineStats;
+
+// A task the scheduler started, with its estimated completion
+typedef struct {
+    RTask* task;
+    long long end_us;
+    int in_gang;       // never preempted alone
+    RHeapItem entry;   // queue entry it was started from; a victim goes back in its place
+} RSchedActive;
+
+typedef struct {
+    RMpscQueue intake;   // submitted, not yet seen by the dispatcher
+    RHeap deadlines;       // deadline class, key = deadline (EDF)
+    RSchedDeadlineStats deadline_stats;
+
+    RSchedOwner* owners;   // indexed by owner id, grown on demand
+    int owner_count;
+    int* ready;            // owners with queued work, min-heap by share
+    int ready_count;
+
+    char type_names[SCHED_RESOURCE_TYPES][20];
+    long long type_total[SCHED_RESOURCE_TYPES];   // capacity per node type
+    int type_count;
+    int totals_fixed;      // totals come from scheduler_set_network
+
+    RSchedActive* active;   // started and not yet finished
+    int active_count;
+    int active_capacity;
+
+    RHeapItem* evicted;     // queue entries of tasks stopped this pass, requeued after on_evict
+    int evicted_count;
+    int evicted_capacity;
+
+    RNodeWatcher** watches;   // on nodes that waiting tasks need
+    RNode** watched;
+    int watch_count;
+    int watch_capacity;
+    atomic_int dirty;         // capacity was released since the last pass
+    atomic_int sleeping;      // dispatcher is (about to be) waiting on cond
+    SchedPacking packing;
+    int preemption;           // a blocked head may evict lower-priority tasks
+    RPlacement* placement;    // binds unbound requirements, NULL = none
 
     pthread_mutex_t lock;
     pthread_cond_t cond;
 
     int running; // 1 = scheduler active, 0 = stop
     pthread_t thread;
+
+    RWorkerPool* pool;   // workers that execute dispatched tasks
 } RTaskScheduler;
 
 // =====================
 // Scheduler operations
 // =====================
-RTaskScheduler* create_scheduler();
-void destroy_scheduler(RTaskScheduler* sched);
+// Tasks are started in priority order. A task that does not fit yet stays
+// queued at the head and capacity is held for it (EASY backfilling): a
+// later task may start first only if it fits now and, by its run-time
+// estimate, will not delay the head. Tasks that can never fit fail.
+// The dispatcher sleeps until a task is added or finishes, or capacity is
+// released on a node a waiting task needs. Submission is lock-free: tasks
+// go through an MPSC queue that the dispatcher drains into its heap, and a
+// producer only takes the lock to wake a sleeping dispatcher.
+//
+// Owners (RTask::owner) share the cluster by Dominant Resource Fairness:
+// each pass takes the next entry from the owner whose weighted dominant
+// share is lowest, and priority orders entries within one owner. Shares
+// are updated as tasks start and finish, so choosing an owner costs
+// O(log owners). With a single owner this is plain priority order.
+//
+// Tasks with a deadline form a class of their own, served before the
+// priority classes in earliest-deadline-first order. They are admitted
+// only if, on every node they use, the deadline work already admitted
+// plus theirs can still be done by each deadline from its run-time
+// estimate; otherwise they fail at once. The check cannot see capacity
+// the other classes will hold, so misses are still possible and are
+// counted in the deadline stats.
+RTaskScheduler* create_scheduler();   // one worker per CPU
+RTaskScheduler* create_scheduler_workers(int workers, int pin_cpus);
+void destroy_scheduler(RTaskScheduler* sched);   // waits for dispatched tasks
 
-// Add a task to the queue
+// Add a task to the queue; any thread, never blocks. Always returns 1: a
+// task the dispatcher cannot queue (out of memory) fails instead.
 int scheduler_add_task(RTaskScheduler* sched, RTask* task);
 
+// Queue tasks as a gang: the scheduler treats them as one entry whose
+// demand is the sum of theirs, allocates them all or none, and starts
+// them in the same pass. Returns 0 (nothing queued) for more than
+// SCHED_GANG_MAX tasks or when out of memory.
+int scheduler_add_gang(RTaskScheduler* sched, RTask** tasks, int count);
+
+// Applies to tasks submitted from now on; default SCHED_PACK_GANGS_FIRST.
+// Packing gangs first, largest first, keeps a stream of small tasks from
+// breaking free capacity into pieces no gang can use.
+void scheduler_set_packing(RTaskScheduler* sched, SchedPacking packing);
+
+// Off by default. When on, a head entry that does not fit evicts a minimal
+// set of lower-priority running tasks (not gang members) whose resources
+// let it start now; a deadline task may evict any task without one. Victims
+// become TASK_PREEMPTED and are queued again in their old place, resuming
+// from their progress; their on_evict hooks run outside the scheduler lock.
+void scheduler_set_preemption(RTaskScheduler* sched, int on);
+
+// Tasks with unbound requirements are placed by p when they are started;
+// without an engine they fail as unplaceable. Placement only considers
+// capacity free at the time, not the head reservation. Call before
+// scheduler_start; the engine must outlive the scheduler.
+void scheduler_set_placement(RTaskScheduler* sched, RPlacement* p);
+
+// Deadline class outcomes so far (a consistent snapshot)
+void scheduler_deadline_stats(RTaskScheduler* sched, RSchedDeadlineStats* out);
+
+// Weight of an owner's share (default 1.0): an owner with weight 2 may hold
+// twice the dominant share of one with weight 1. Returns 0 for an invalid
+// owner or weight, or when out of memory.
+int scheduler_set_owner_weight(RTaskScheduler* sched, int owner, double weight);
+double scheduler_owner_share(RTaskScheduler* sched, int owner);
+
+// Take per-type capacity totals from every node in net; call again after
+// adding nodes. Until then the largest node of each type seen in a
+// requirement stands in for its total.
+void scheduler_set_network(RTaskScheduler* sched, RNetwork* net);
+
 // Start the scheduler thread
 void scheduler_start(RTaskScheduler* sched);
 
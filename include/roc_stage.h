@@ -33,7 +33,10 @@ typedef struct {
     int item_count;
     int priority;
     StageStatus status;
+    int pending;            // items not yet finished in the current run
+    RCompletionHook* hooks;
     pthread_mutex_t lock;
+    pthread_cond_t done;    // broadcast when the last item finishes
 } RStage;
 
 // Stage operations
@@ -43,4 +46,9 @@ int stage_add_item(RStage* stage, void* item, StageItemType type);
 int stage_run(RStage* stage, RTaskScheduler* sched);
 StageStatus stage_status(RStage* stage);
 
+// A run finishes once every job, workflow and task in it has; campaign items
+// are not run by a stage. Both return at once for a stage that is not running.
+StageStatus stage_wait(RStage* stage);
+int stage_on_complete(RStage* stage, CompletionFn fn, void* arg);   // fn(stage, arg)
+
 #endif
@@ -2,50 +2,128 @@
 #define ROC_TASK_H
 
 #include "roc.h"
+#include "roc_pool.h"
+#include "roc_completion.h"
+#include "roc_mpsc.h"
 #include <pthread.h>
 
-#define MAX_RESOURCES_PER_TASK 8
+#define TASK_INLINE_RESOURCES 8   // requirements stored in the task; more are allocated
+#define ROC_CACHE_LINE 64
+#define TASK_SLAB_SIZE 64     // tasks allocated at once when the pool runs dry
+#define TASK_CACHE_SIZE 32    // free tasks a thread keeps before returning a batch
 
 typedef enum {
     TASK_PENDING,
     TASK_RUNNING,
     TASK_COMPLETED,
-    TASK_FAILED
+    TASK_FAILED,
+    TASK_PREEMPTED   // evicted by the scheduler and queued again
 } TaskStatus;
 
-// Represents a single resource requirement
+// Represents a single resource requirement. A requirement without a node
+// is unbound: a placement engine (roc_placement.h) picks a node of the
+// given type for it, and requirements sharing a nonzero group land on one host.
 typedef struct {
     RNode* node;   // Optional: preselected node, NULL = any
     int amount;    // Units required
+    int group;     // co-location group, 0 = none
+    int placed;    // node was chosen by placement and is chosen again on the next run
+    char type[20]; // node type for an unbound requirement, "" = any type
 } TaskResourceReq;
 
-// Represents a task/job in ROC
-typedef struct {
-    char name[50];
-    TaskResourceReq resources[MAX_RESOURCES_PER_TASK];
-    int resource_count;
+struct RTask;
+struct RGang;
+typedef void (*TaskDoneFn)(struct RTask* task, void* arg);
 
-    int priority;        // Higher = more urgent
-    TaskStatus status;
+// Runs once an evicted task has stopped and released its resources, with
+// the work it has done so far. Return 1 if that progress was checkpointed
+// and the task resumes from it, 0 to start it over.
+typedef int (*TaskEvictFn)(struct RTask* task, long long progress_us, void* arg);
 
+// Represents a task/job in ROC. Fields read on every status check and
+// scheduling pass come first, each group starting on its own cache line:
+// the lock with what it guards, then the requirements.
+typedef struct RTask {
+    _Alignas(ROC_CACHE_LINE) TaskStatus status;
+    int priority;        // Higher = more urgent
+    int resource_count;
+    int sched_slot;      // index in the owning scheduler's active set
+    int owner;           // tenant charged by the scheduler; fixed while queued or running
     pthread_mutex_t lock;
+
+    _Alignas(ROC_CACHE_LINE) TaskResourceReq* resources;   // inline until it outgrows them
+    int resource_capacity;
+    TaskResourceReq inline_resources[TASK_INLINE_RESOURCES];
+
+    _Alignas(ROC_CACHE_LINE) char name[50];
+    RWorkerPool* pool;   // pool running the task
+    RPoolJob job;        // start, then completion; no allocation per task
+
+    TaskDoneFn on_done;  // runs on a pool worker once resources are released
+    void* done_arg;
+    TaskEvictFn on_evict;     // NULL: progress is kept
+    void* evict_arg;
+    long long progress_us;    // simulated work done in earlier runs
+    long long run_start_us;   // start of the current run
+    long long deadline_us;    // absolute roc_now_us() time to finish by, 0 = none
+
+    RCompletionHook* hooks;   // task_on_complete callbacks, run once
+    int finishing;            // hooks of a final status still running; task_wait holds on
+    pthread_cond_t done;      // broadcast when the task completes or fails
+    RMpscNode intake;         // scheduler submission queue
+    struct RGang* gang;       // set on the queued leader of a scheduler gang
+    struct RTask* next_free;  // task pool free list
 } RTask;
 
 // =====================
 // Task operations
 // =====================
-RTask* create_task(const char* name, int priority);
+// Tasks come from a pool: each thread keeps a small cache of free tasks and
+// trades batches with a shared free list, so creating and destroying tasks
+// is O(1) and allocation-free once the pool has grown to the working set.
+// Pool memory is kept for reuse, not returned to the system.
+RTask* create_task(const char* name, int priority);   // NULL when out of memory
 void destroy_task(RTask* task);
 
-int add_resource_req(RTask* task, RNode* node, int amount);
+int add_resource_req(RTask* task, RNode* node, int amount);   // 0 when out of memory
+int add_resource_any(RTask* task, const char* type, int amount, int group);   // unbound; type NULL = any
+int task_needs_placement(RTask* task);   // some requirement has no node, or was placed
 int remove_resource_req(RTask* task, int index);
 
 int allocate_task(RTask* task);     // Reserve all resources
+int try_allocate_task(RTask* task); // Same, but a task that does not fit keeps its status
+void deallocate_task(RTask* task);  // Undo an allocation that never started; pending again
 void release_task(RTask* task);     // Release all resources
 
 int run_task(RTask* task);           // Simulate execution based on allocated resources
+int run_task_on(RWorkerPool* pool, RTask* task);
+int start_task_on(RWorkerPool* pool, RTask* task);   // task already allocated
+int start_tasks_on(RWorkerPool* pool, RTask** tasks, int count);   // all start, or none if 0
+long long task_estimate_us(RTask* task);              // simulated run time left
+
+// Stop a running task and release its resources; it becomes TASK_PREEMPTED
+// and can be started again. Returns 0 if the task is not running or is
+// already finishing. The task's on_done does not run.
+int task_preempt(RTask* task);
+// The same in two steps, for callers that hold locks the hook may need:
+// task_suspend stops the task, task_notify_evict later runs its on_evict.
+int task_suspend(RTask* task);
+void task_notify_evict(RTask* task);
+void task_set_evict(RTask* task, TaskEvictFn fn, void* arg);
+void task_set_deadline(RTask* task, long long deadline_us);   // before submitting
 
 TaskStatus task_status(RTask* task);
 int run_task_async(RTask* task);
 
+// =====================
+// Completion
+// =====================
+// A task is finished once it is TASK_COMPLETED or TASK_FAILED. Waiters and
+// callbacks are released after the status changes; callbacks run on the
+// thread that finished the task. A callback added to a finished task runs
+// at once, on the caller's thread.
+TaskStatus task_wait(RTask* task);    // blocks until the task is finished
+int task_on_complete(RTask* task, CompletionFn fn, void* arg);   // fn(task, arg)
+void task_finish(RTask* task, TaskStatus status);   // sets a final status
+
 #endif
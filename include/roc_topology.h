@@ -0,0 +1,58 @@
+#ifndef ROC_TOPOLOGY_H
+#define ROC_TOPOLOGY_H
+
+#include "roc.h"
+#include <stdatomic.h>
+
+// =====================
+// Topology snapshot
+// =====================
+// Immutable CSR copy of an RNetwork's enabled adjacency and link attributes,
+// tagged with the network version it was taken at. Path searches read a
+// snapshot without any lock, so concurrent senders never serialize on the
+// network. Only RLink::load is read live, since it changes on every send.
+
+typedef struct RTopology {
+    unsigned long version;   // net->version at snapshot time
+    int node_count;
+    RNode** nodes;           // nodes[i]->id == i
+
+    int* adj_off;            // node_count + 1 offsets into adj_*
+    int* adj_to;             // neighbour index
+    RLink** adj_link;        // link to that neighbour
+    int* adj_latency;        // link attributes at snapshot time
+    int* adj_bandwidth;
+    unsigned int* adj_perm;
+
+    atomic_int refs;
+} RTopology;
+
+RTopology* topology_snapshot(RNetwork* net);
+// The network's cached snapshot (retained), rebuilt only once net->version
+// has moved on. Release it with topology_release().
+RTopology* topology_current(RNetwork* net);
+void topology_retain(RTopology* topo);
+void topology_release(RTopology* topo);
+
+// Index of a node inside the snapshot, -1 if it is not part of it
+int topology_index(RTopology* topo, RNode* node);
+
+// Single-source search under a policy. prev[i] receives the link used to
+// reach node i (NULL if unreached). Stops once dst is settled; dst = -1
+// builds the full tree. POLICY_FASTEST_COMPLETION depends on the packet
+// size, so its tree only answers reachability (hop-count BFS).
+int topology_search(RTopology* topo, RoutePolicy policy, int src, int dst, RLink** prev);
+
+// Walk prev[] back from dst into the find_path_* layout (path[0] = last hop)
+int topology_path(RTopology* topo, RLink** prev, int src, int dst, RLink** path, int* plen);
+
+// Convenience: search + path extraction; amount is used by POLICY_FASTEST_COMPLETION
+int topology_find_path(RTopology* topo, RoutePolicy policy, RNode* src, RNode* dst, int amount,
+                       RLink** path, int* plen);
+
+// Exact minimum of sum(latency) + amount / min(bandwidth), in milliseconds,
+// by label-setting over the Pareto frontier of (latency, bandwidth)
+int topology_fastest_path(RTopology* topo, int src, int dst, int amount, RLink** path, int* plen,
+                          long long* cost_ms);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef ROC_TRACE_H
+#define ROC_TRACE_H
+
+#include <stdint.h>
+
+// =====================
+// Packet trace
+// =====================
+// Fixed-size binary records go into a lock-free ring owned by the emitting
+// thread. A background drainer copies every ring to the trace file, so the
+// hot path never takes a lock or touches stdio. Emission compiles to nothing
+// unless ROC_TRACE is defined; the control functions are always available.
+// Decode a file with tools/roc_trace_decode.
+
+#define ROC_TRACE_MAGIC "ROCTRACE"
+#define ROC_TRACE_VERSION 1
+#define ROC_TRACE_RING_SIZE 1024          // records per thread, power of two
+
+// X(name, label): event ids are stable within a trace version
+#define ROC_TRACE_EVENTS(X)                    \
+    X(TRACE_HOP_START,       "hop_start")      \
+    X(TRACE_HOP_END,         "hop_end")        \
+    X(TRACE_CHUNK_SENT,      "chunk_sent")     \
+    X(TRACE_TRANSFER_SUBMIT, "transfer_submit")\
+    X(TRACE_TRANSFER_DONE,   "transfer_done")  \
+    X(TRACE_TRANSFER_FAILED, "transfer_failed")\
+    X(TRACE_MIGRATE_START,   "migrate_start")  \
+    X(TRACE_MIGRATE_CHUNK,   "migrate_chunk")  \
+    X(TRACE_MIGRATE_END,     "migrate_end")    \
+    X(TRACE_TASK_START,      "task_start")     \
+    X(TRACE_TASK_END,        "task_end")       \
+    X(TRACE_TASK_PREEMPT,    "task_preempt")
+
+#define ROC_TRACE_ENUM(name, label) name,
+typedef enum { ROC_TRACE_EVENTS(ROC_TRACE_ENUM) TRACE_EVENT_COUNT } RTraceEvent;
+#undef ROC_TRACE_ENUM
+
+// 32 bytes; ids are RNode::id / RLink::id, -1 when not applicable
+typedef struct RTraceRecord {
+    int64_t time_us;         // roc_now_us(), virtual time in simulation mode
+    uint32_t thread;         // ring (emitting thread) number
+    uint16_t event;          // RTraceEvent
+    uint16_t reserved;
+    int32_t node_a;
+    int32_t node_b;
+    int32_t link;
+    int32_t amount;
+} RTraceRecord;
+
+// File layout: this header, then records in per-thread order
+typedef struct RTraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} RTraceHeader;
+
+int roc_trace_start(const char* path);    // returns 0 if the file cannot be opened
+void roc_trace_stop(void);                // drains every ring and closes the file
+unsigned long long roc_trace_dropped(void);   // records lost to full rings
+
+void roc_trace_emit(int event, int node_a, int node_b, int link, int amount);
+
+#ifdef ROC_TRACE
+#define ROC_TRACE_EVENT(event, node_a, node_b, link, amount) \
+    roc_trace_emit((event), (node_a), (node_b), (link), (amount))
+#else
+// Arguments stay referenced (unevaluated) so disabled builds stay warning-free
+#define ROC_TRACE_EVENT(event, node_a, node_b, link, amount) \
+    ((void)sizeof((event) + (node_a) + (node_b) + (link) + (amount)))
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef ROC_TRANSFER_H
+#define ROC_TRANSFER_H
+
+#include "roc.h"
+#include "roc_heap.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define TRANSFER_DEFAULT_THREADS 2
+#define TRANSFER_MAX_PIECES 1024   // cut-through chunks grow beyond this many
+
+// Submission flags
+#define TRANSFER_PRERESERVED 0x1   // caller already reserved pkt->amount at the source
+#define TRANSFER_CUT_THROUGH 0x2   // chunks move through all hops at once
+#define TRANSFER_LEASED      0x4   // source units belong to a timed lease: never reserve or release
+
+typedef enum {
+    TRANSFER_PENDING,
+    TRANSFER_RUNNING,
+    TRANSFER_COMPLETED,
+    TRANSFER_FAILED
+} TransferStatus;
+
+struct RTransfer;
+typedef void (*TransferCallback)(struct RTransfer* transfer, void* arg);
+
+// =====================
+// Transfer pieces
+// =====================
+// The unit the engine moves along the path. Store-and-forward transfers
+// have one piece holding the whole packet, which crosses each hop chunk by
+// chunk. Cut-through transfers have one piece per chunk, and the pieces
+// follow each other through the hops.
+typedef struct RTransferPiece {
+    struct RTransfer* transfer;
+    RNode* current;          // node this piece has reached
+    int hop;                 // next path index to cross, -1 when delivered
+    int size;
+    int stage;               // which event comes next (see roc_transfer.c)
+    int remaining;           // units still to cross the current hop
+    int sending;             // units in the chunk being granted/sent
+    int holding;             // owns path[hop]'s transmit queue
+    struct RTransferPiece* park_prev;   // engine->parked list while queued on a link
+    struct RTransferPiece* park_next;
+} RTransferPiece;
+
+// =====================
+// Transfer handle
+// =====================
+typedef struct RTransfer {
+    RPacket pkt;
+    RNode* current;          // node the head of the packet has reached
+    RLink** path;            // find_path_* layout, walked from plen-1 down to 0
+    int plen;
+    RoutePolicy policy;
+    int flags;
+    int chunk;               // units per link grant, 0 = whole packet
+
+    RTransferPiece* pieces;
+    int piece_count;
+    atomic_int pieces_left;
+    atomic_int failed;
+
+    TransferStatus status;
+    TransferCallback callback;
+    void* callback_arg;
+
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    atomic_int refs;         // one for the caller, one while in the engine
+    struct RTransferEngine* engine;
+} RTransfer;
+
+// =====================
+// Transfer engine
+// =====================
+// A few engine threads drive every in-flight transfer from a timer queue:
+// each hop is an event due when the previous hop's simulated time elapses,
+// so no thread ever sleeps on behalf of a single transfer. On every hop the
+// packet queues chunk by chunk for the link (roc_linkq.h) at its priority.
+// Pieces waiting in a link queue are parked on the engine so that destroying
+// it can withdraw them; every transfer still in flight then fails.
+typedef struct RTransferEngine {
+    RHeap timers;            // key = due time (us), data = RTransferPiece*
+    RTransferPiece* parked;  // waiting for a link grant
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    pthread_t* threads;
+    int thread_count;
+    int running;
+
+    atomic_int in_flight;
+} RTransferEngine;
+
+RTransferEngine* create_transfer_engine(int threads);
+void destroy_transfer_engine(RTransferEngine* engine);   // pending transfers fail
+
+// Start moving pkt along a precomputed path, chunk units at a time (0 = whole
+// packet), store-and-forward unless TRANSFER_CUT_THROUGH is set. Returns NULL if the source cannot be reserved; otherwise the
+// callback (if any) fires exactly once.
+RTransfer* transfer_submit(RTransferEngine* engine, RNode* src, RLink** path, int plen,
+                           RPacket* pkt, RoutePolicy policy, int chunk, int flags,
+                           TransferCallback callback, void* arg);
+
+TransferStatus transfer_poll(RTransfer* transfer);
+TransferStatus transfer_wait(RTransfer* transfer);
+void transfer_release(RTransfer* transfer);   // drop the caller's reference
+
+int transfer_in_flight(RTransferEngine* engine);
+
+#endif
@@ -22,7 +22,10 @@ typedef struct {
     int priority;           // Workflow-level priority
     WorkflowStatus status;
 
+    RCompletionHook* hooks;
+
     pthread_mutex_t lock;
+    pthread_cond_t done;    // broadcast when the run finishes
 } RWorkflow;
 
 // Workflow operations
@@ -33,4 +36,8 @@ int workflow_add_task(RWorkflow* wf, RTask* task);
 int workflow_run(RWorkflow* wf, RTaskScheduler* sched);  // enqueue all tasks
 WorkflowStatus workflow_status(RWorkflow* wf);
 
+// Both return at once for a workflow that is not running
+WorkflowStatus workflow_wait(RWorkflow* wf);
+int workflow_on_complete(RWorkflow* wf, CompletionFn fn, void* arg);   // fn(wf, arg)
+
 #endif
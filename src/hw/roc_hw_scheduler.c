@@ -1,4 +1,5 @@
 #include "hw/roc_hw_scheduler.h"
+#include "roc_log.h"
 #include <hw/hw_utils.h>
 #include <windows.h>
 #include <psapi.h>
@@ -94,7 +95,7 @@ static DWORD WINAPI hw_task_runner(LPVOID arg) {
 
     SetThreadPriority(GetCurrentThread(), winprio);
 
-    printf("Task starting on core %d (priority=%d, quantum=%llu ms)\n",
+    ROC_INFO("Task starting on core %d (priority=%d, quantum=%llu ms)\n",
            task->assigned_core, task->priority, task->quantum_ms);
 
     // Initialize quantum
@@ -124,7 +125,7 @@ static DWORD WINAPI hw_task_runner(LPVOID arg) {
                     task->target_core = -1;
                     SetThreadAffinityMask(GetCurrentThread(), 1ULL << task->assigned_core);
                     LeaveCriticalSection(&sched->lock);
-                    printf(" -> Task migrated to core %d\n", task->assigned_core);
+                    ROC_INFO(" -> Task migrated to core %d\n", task->assigned_core);
                     break; // exit inner loop to re-evaluate
                 }
 
@@ -138,7 +139,7 @@ static DWORD WINAPI hw_task_runner(LPVOID arg) {
         }
     }
 
-    printf("Task finished on core %d (priority=%d)\n",
+    ROC_INFO("Task finished on core %d (priority=%d)\n",
            task->assigned_core, task->priority);
 
     EnterCriticalSection(&sched->lock);
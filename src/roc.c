@@ -1,34 +1,69 @@
 #include "roc.h"
+#include "roc_ch.h"
+#include "roc_clock.h"
+#include "roc_heap.h"
+#include "roc_linkq.h"
+#include "roc_migration.h"
+#include "roc_topology.h"
+#include "roc_trace.h"
+#include "roc_transfer.h"
+#include "roc_log.h"
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
-#include <unistd.h>
 
 // =====================
 // Node functions
 // =====================
-RNode* create_node(const char* name, const char* type, int capacity) {
+// Shared by every node constructor: a detached, online node with no watchers
+static RNode* new_node(const char* name, const char* type, int capacity, int available) {
     RNode* node = (RNode*)malloc(sizeof(RNode));
+    if (!node) return NULL;
     strcpy(node->name, name);
     strcpy(node->type, type);
     node->capacity = capacity;
-    node->available = capacity;
+    node->available = available;
     node->state = 1; // online
     node->links = NULL;
     node->link_count = 0;
+    node->id = -1;
+    node->net = NULL;
+    node->host = -1;
     node->metadata = NULL;
+    atomic_init(&node->watchers, NULL);
     pthread_mutex_init(&node->lock, NULL);
     return node;
 }
 
+RNode* create_node(const char* name, const char* type, int capacity) {
+    return new_node(name, type, capacity, capacity);
+}
+
 void destroy_node(RNode* node) {
+    RNodeWatcher* w = atomic_load(&node->watchers);
+    while (w) {
+        RNodeWatcher* next = w->next;
+        free(w);
+        w = next;
+    }
     pthread_mutex_destroy(&node->lock);
     free(node->links);
     free(node);
 }
 
+// Runs on_reserve watchers; callers take capacity under the node lock and
+// call this after unlocking
+static void notify_reserved(RNode* node) {
+    for (RNodeWatcher* w = atomic_load(&node->watchers); w; w = w->next) {
+        atomic_fetch_add(&w->inflight, 1);
+        if (atomic_load(&w->state) == WATCH_LIVE && w->on_reserve) w->on_reserve(node, w->arg);
+        atomic_fetch_sub(&w->inflight, 1);
+    }
+}
+
 int reserve(RNode* node, int amount) {
     pthread_mutex_lock(&node->lock);
     int success = 0;
@@ -37,7 +72,10 @@ int reserve(RNode* node, int amount) {
         success = 1;
     }
     pthread_mutex_unlock(&node->lock);
-    return success;
+
+    if (!success) return 0;
+    notify_reserved(node);
+    return 1;
 }
 
 void release(RNode* node, int amount) {
@@ -45,6 +83,57 @@ void release(RNode* node, int amount) {
     node->available += amount;
     if (node->available > node->capacity) node->available = node->capacity;
     pthread_mutex_unlock(&node->lock);
+
+    // Outside the node lock: watchers may take their own locks and call back in
+    for (RNodeWatcher* w = atomic_load(&node->watchers); w; w = w->next) {
+        atomic_fetch_add(&w->inflight, 1);
+        if (atomic_load(&w->state) == WATCH_LIVE && w->fn) w->fn(node, w->arg);
+        atomic_fetch_sub(&w->inflight, 1);
+    }
+}
+
+RNodeWatcher* node_watch(RNode* node, NodeWatchFn fn, void* arg) {
+    return node_watch_all(node, fn, NULL, arg);
+}
+
+// Callbacks only read fn, on_reserve and arg after seeing WATCH_LIVE, which
+// is stored after they are filled in
+static void arm_watcher(RNodeWatcher* w, NodeWatchFn on_release, NodeWatchFn on_reserve, void* arg) {
+    w->fn = on_release;
+    w->on_reserve = on_reserve;
+    w->arg = arg;
+    atomic_store(&w->state, WATCH_LIVE);
+}
+
+RNodeWatcher* node_watch_all(RNode* node, NodeWatchFn on_release, NodeWatchFn on_reserve, void* arg) {
+    for (RNodeWatcher* w = atomic_load(&node->watchers); w; w = w->next) {
+        int expected = WATCH_FREE;
+        if (atomic_compare_exchange_strong(&w->state, &expected, WATCH_CLAIMED)) {
+            arm_watcher(w, on_release, on_reserve, arg);
+            return w;
+        }
+    }
+
+    RNodeWatcher* w = (RNodeWatcher*)malloc(sizeof(RNodeWatcher));
+    if (!w) return NULL;
+    atomic_init(&w->state, WATCH_CLAIMED);
+    atomic_init(&w->inflight, 0);
+    arm_watcher(w, on_release, on_reserve, arg);
+
+    RNodeWatcher* head = atomic_load(&node->watchers);
+    do {
+        w->next = head;
+    } while (!atomic_compare_exchange_weak(&node->watchers, &head, w));
+    return w;
+}
+
+void node_unwatch(RNodeWatcher* w) {
+    if (!w) return;
+    atomic_store(&w->state, WATCH_RETIRING);
+    // A callback that saw the watcher live may still be running
+    while (atomic_load(&w->inflight) > 0)
+        sched_yield();
+    atomic_store(&w->state, WATCH_FREE);
 }
 
 int monitor(RNode* node) {
@@ -82,23 +171,12 @@ RNode* aggregate(RNode** nodes, int count, const char* name, const char* type) {
         pthread_mutex_unlock(&nodes[i]->lock);
     }
 
-    RNode* agg = (RNode*)malloc(sizeof(RNode));
-    strcpy(agg->name, name);
-    strcpy(agg->type, type);
-    agg->capacity = total_capacity;
-    agg->available = total_available;
-    pthread_mutex_init(&agg->lock, NULL);
-
-    // Optionally, store pointers to constituent nodes for migration
-    agg->links = NULL; // not used
-    agg->link_count = 0;
-
-    return agg;
+    return new_node(name, type, total_capacity, total_available);
 }
 
 RNode* slice_node(RNode* node, const char* name, int capacity) {
     if (capacity > node->available) {
-        printf("Cannot slice %d units from %s (only %d available)\n",
+        ROC_WARN("Cannot slice %d units from %s (only %d available)\n",
                capacity, node->name, node->available);
         return NULL;
     }
@@ -107,48 +185,65 @@ RNode* slice_node(RNode* node, const char* name, int capacity) {
     if (!reserve(node, capacity)) return NULL;
 
     // Create a new node representing the slice
-    RNode* slice = (RNode*)malloc(sizeof(RNode));
-    strcpy(slice->name, name);
-    strcpy(slice->type, node->type);
-    slice->capacity = capacity;
-    slice->available = capacity;
-    pthread_mutex_init(&slice->lock, NULL);
-
-    printf("Created slice %s with capacity %d\n", slice->name, slice->capacity);
+    RNode* slice = new_node(name, node->type, capacity, capacity);
+    if (!slice) {
+        release(node, capacity);
+        return NULL;
+    }
+
+    ROC_INFO("Created slice %s with capacity %d\n", slice->name, slice->capacity);
     return slice;
 }
 
-int migrate(RPacket* pkt, RNode* from, RNode* to) {
-    if (!reserve(to, pkt->amount)) {
-        printf("Migration failed: target node %s has insufficient capacity.\n", to->name);
-        return 0;
-    }
-
-    printf("Migrating %d units from %s -> %s...\n", pkt->amount, from->name, to->name);
-    usleep(pkt->amount * 50000); // simulate transfer delay
+static void* timed_release_thread(void* arg) {
+    TimedReserveArgs* args = (TimedReserveArgs*)arg;
+    roc_sleep_ms(args->timeout_ms);
+    release(args->node, args->amount);
+    free(args);
+    return NULL;
+}
 
-    release(from, pkt->amount);
-    printf("Migration complete.\n");
-    return 1;
+// Give amount back to node after timeout_ms on a detached thread
+static void release_after(RNode* node, int amount, int timeout_ms) {
+    TimedReserveArgs* args = malloc(sizeof(TimedReserveArgs));
+    args->node = node;
+    args->amount = amount;
+    args->timeout_ms = timeout_ms;
+    roc_thread_spawn(NULL, timed_release_thread, args);
 }
 
-int migrate_timed(RNode* from, RNode* to, int amount, int timeout_ms) {
-    int reserved = reserve_timed(from, amount, timeout_ms);
-    if (!reserved) {
-        printf("Migration failed: not enough resources on %s\n", from->name);
+// One migration on a short-lived engine, latency-routed over the nodes'
+// network; *moved gets the units that reached the target
+static int migrate_once(RNode* from, RNode* to, int amount, int* moved) {
+    *moved = 0;
+    RNetwork* net = from->net;
+    if (!net || to->net != net) {
+        ROC_WARN("Migration failed: %s and %s are not on the same network.\n", from->name, to->name);
         return 0;
     }
 
-    printf("Migrating %d units from %s -> %s (timed %d ms)...\n",
-           amount, from->name, to->name, timeout_ms);
+    RController* ctrl = create_controller(net, POLICY_LATENCY);
+    RMigrationEngine* engine = create_migration_engine(ctrl, 1);
+    RMigration* m = migration_submit(engine, from, to, amount, 0, NULL, NULL, NULL);
+    int ok = m && migration_wait(m) == MIGRATION_COMPLETED;
+    if (m) *moved = migration_moved(m);
+    migration_release(m);
+    destroy_migration_engine(engine);
+    destroy_controller(ctrl);
+    return ok;
+}
 
-    // Simulate transfer delay proportional to amount
-    usleep(amount * 50000); // arbitrary transfer time for demo
-    release(from, amount);
-    reserve(to, amount); // immediately add to destination
+int migrate(RPacket* pkt, RNode* from, RNode* to) {
+    int moved;
+    return migrate_once(from, to, pkt->amount, &moved);
+}
 
-    printf("Migration complete.\n");
-    return 1;
+int migrate_timed(RNode* from, RNode* to, int amount, int timeout_ms) {
+    int moved;
+    int ok = migrate_once(from, to, amount, &moved);
+    // The target holds what arrived on a lease, like reserve_timed
+    if (moved > 0) release_after(to, moved, timeout_ms);
+    return ok;
 }
 
 NodeStatus status(RNode* node) {
@@ -173,7 +268,13 @@ RLink* create_link(RNetwork* net, RNode* n1, RNode* n2, int bandwidth, int laten
     link->latency = latency;
     link->permissions = 0xFFFFFFFF; // default: all allowed
     link->enabled = 1;
+    link->net = net;
+    link->txq = create_link_queue();
+    atomic_init(&link->load, 0);
+    link->retired = NULL;
 
+    pthread_rwlock_wrlock(&net->lock);
+    link->id = net->next_link_id++;
     net->links = realloc(net->links, (net->link_count + 1) * sizeof(RLink*));
     net->links[net->link_count++] = link;
 
@@ -183,17 +284,59 @@ RLink* create_link(RNetwork* net, RNode* n1, RNode* n2, int bandwidth, int laten
 
     n2->links = realloc(n2->links, (n2->link_count + 1) * sizeof(RLink*));
     n2->links[n2->link_count++] = link;
+    pthread_rwlock_unlock(&net->lock);
 
+    network_changed(net);
     return link;
 }
 
 void destroy_link(RLink* link) {
+    destroy_link_queue(link->txq);
     free(link);
 }
 
+// Drop a link from a node's adjacency so routing never follows a freed link
+static void detach_link(RNode* node, RLink* link) {
+    for (int i = 0; i < node->link_count; i++) {
+        if (node->links[i] == link) {
+            for (int j = i; j < node->link_count - 1; j++)
+                node->links[j] = node->links[j + 1];
+            node->link_count--;
+            return;
+        }
+    }
+}
+
+// Removed links stay allocated until destroy_network: topology snapshots,
+// in-flight transfers and the contraction hierarchy may still point at
+// them. A retired link is disabled so a stale route fails its hop check.
+// Called with net->lock held for writing.
+static void retire_link(RNetwork* net, RLink* link) {
+    link->enabled = 0;
+    link->retired = net->retired_links;
+    net->retired_links = link;
+}
+
+// Attribute writes hold net->lock so topology snapshots and the CH rebuild
+// copy a consistent link; link_changed() then notifies outside the lock
+static void link_write_lock(RLink* link) {
+    if (link->net) pthread_rwlock_wrlock(&link->net->lock);
+}
+
+static void link_write_unlock(RLink* link) {
+    if (link->net) pthread_rwlock_unlock(&link->net->lock);
+}
+
+static void link_changed(RLink* link) {
+    if (link->net) network_changed(link->net);
+}
+
 void link_perm(RLink* link, unsigned int permissions) {
     if (!link) return;
+    link_write_lock(link);
     link->permissions = permissions;
+    link_write_unlock(link);
+    link_changed(link);
 }
 
 unsigned int get_link_permissions(RLink* link) {
@@ -203,7 +346,10 @@ unsigned int get_link_permissions(RLink* link) {
 
 void set_link_bandwidth(RLink* link, int bandwidth) {
     if (!link) return;
+    link_write_lock(link);
     link->bandwidth = bandwidth;
+    link_write_unlock(link);
+    link_changed(link);
 }
 
 int get_link_bandwidth(RLink* link) {
@@ -211,7 +357,10 @@ int get_link_bandwidth(RLink* link) {
 }
 
 void set_link_latency(RLink* link, int latency) {
+    link_write_lock(link);
     link->latency = latency;
+    link_write_unlock(link);
+    link_changed(link);
 }
 
 int get_link_latency(RLink* link) {
@@ -219,17 +368,27 @@ int get_link_latency(RLink* link) {
 }
 
 void disable_link(RLink* link) {
+    link_write_lock(link);
     link->enabled = 0;
+    link_write_unlock(link);
+    link_changed(link);
 }
 
 void enable_link(RLink* link) {
+    link_write_lock(link);
     link->enabled = 1;
+    link_write_unlock(link);
+    link_changed(link);
 }
 
 int is_link_enabled(RLink* link) {
     return link->enabled;
 }
 
+int get_link_load(RLink* link) {
+    return atomic_load_explicit(&link->load, memory_order_relaxed);
+}
+
 // =====================
 // Network functions
 // =====================
@@ -239,15 +398,36 @@ RNetwork* create_network() {
     net->node_count = 0;
     net->links = NULL;
     net->link_count = 0;
+    net->next_link_id = 0;
+    net->retired_links = NULL;
+    pthread_rwlock_init(&net->lock, NULL);
+    atomic_init(&net->version, 0);
+    net->ch = NULL;
+    net->topology = NULL;
+    pthread_rwlock_init(&net->topology_lock, NULL);
     return net;
 }
 
+void network_changed(RNetwork* net) {
+    atomic_fetch_add(&net->version, 1);
+    if (net->ch) ch_invalidate(net->ch);
+}
+
+// Structural edits hold net->lock for writing so background readers
+// (the contraction hierarchy rebuild, topology snapshots) never see the
+// arrays mid-realloc; they notify after unlocking
 void add_node(RNetwork* net, RNode* node) {
+    pthread_rwlock_wrlock(&net->lock);
     net->nodes = realloc(net->nodes, (net->node_count + 1) * sizeof(RNode*));
+    node->id = net->node_count;
+    node->net = net;
     net->nodes[net->node_count++] = node;
+    pthread_rwlock_unlock(&net->lock);
+    network_changed(net);
 }
 
 int remove_node(RNetwork* net, RNode* node) {
+    pthread_rwlock_wrlock(&net->lock);
     int idx = -1;
     for (int i = 0; i < net->node_count; i++) {
         if (net->nodes[i] == node) {
@@ -255,12 +435,17 @@ int remove_node(RNetwork* net, RNode* node) {
             break;
         }
     }
-    if (idx == -1) return 0;
+    if (idx == -1) {
+        pthread_rwlock_unlock(&net->lock);
+        return 0;
+    }
 
     // Remove links involving this node
     for (int i = 0; i < net->link_count;) {
         if (net->links[i]->a == node || net->links[i]->b == node) {
-            destroy_link(net->links[i]);
+            RLink* l = net->links[i];
+            detach_link((l->a == node) ? l->b : l->a, l);
+            retire_link(net, l);
             for (int j = i; j < net->link_count - 1; j++) {
                 net->links[j] = net->links[j + 1];
             }
@@ -273,8 +458,18 @@ int remove_node(RNetwork* net, RNode* node) {
     // Remove node from list
     for (int i = idx; i < net->node_count - 1; i++) {
         net->nodes[i] = net->nodes[i + 1];
+        net->nodes[i]->id = i;
     }
     net->node_count--;
+
+    free(node->links);
+    node->links = NULL;
+    node->link_count = 0;
+    node->id = -1;
+    node->net = NULL;
+    pthread_rwlock_unlock(&net->lock);
+
+    network_changed(net);
     return 1;
 }
 
@@ -323,28 +518,43 @@ int connect_nodes(RNetwork* net, const char* name1, const char* name2, int bandw
 }
 
 int disconnect_nodes(RNetwork* net, const char* name1, const char* name2) {
+    pthread_rwlock_wrlock(&net->lock);
     for (int i = 0; i < net->link_count; i++) {
         RLink* l = net->links[i];
         if ((strcmp(l->a->name, name1) == 0 && strcmp(l->b->name, name2) == 0) ||
             (strcmp(l->a->name, name2) == 0 && strcmp(l->b->name, name1) == 0)) {
-            destroy_link(l);
+            detach_link(l->a, l);
+            detach_link(l->b, l);
+            retire_link(net, l);
             for (int j = i; j < net->link_count - 1; j++) {
                 net->links[j] = net->links[j + 1];
             }
             net->link_count--;
+            pthread_rwlock_unlock(&net->lock);
+            network_changed(net);
             return 1;
         }
     }
+    pthread_rwlock_unlock(&net->lock);
     return 0;
 }
 
 void destroy_network(RNetwork* net) {
+    if (net->ch) destroy_contraction_hierarchy(net->ch);
     for (int i = 0; i < net->node_count; i++)
         destroy_node(net->nodes[i]);
     for (int i = 0; i < net->link_count; i++)
         destroy_link(net->links[i]);
+    while (net->retired_links) {
+        RLink* next = net->retired_links->retired;
+        destroy_link(net->retired_links);
+        net->retired_links = next;
+    }
     free(net->nodes);
     free(net->links);
+    topology_release(net->topology);
+    pthread_rwlock_destroy(&net->topology_lock);
+    pthread_rwlock_destroy(&net->lock);
     free(net);
 }
 
@@ -354,46 +564,270 @@ void destroy_network(RNetwork* net) {
 RController* create_controller(RNetwork* net, RoutePolicy policy) {
     RController* ctrl = (RController*)malloc(sizeof(RController));
     ctrl->network = net;
-    ctrl->policy = policy;
-    pthread_mutex_init(&ctrl->lock, NULL);
+    atomic_init(&ctrl->policy, policy);
+    ctrl->engine = NULL;
+    atomic_init(&ctrl->chunk_size, 0);
+    atomic_init(&ctrl->cut_through, 0);
+    pthread_rwlock_init(&ctrl->lock, NULL);
     return ctrl;
 }
 
 void destroy_controller(RController* ctrl) {
-    pthread_mutex_destroy(&ctrl->lock);
+    destroy_transfer_engine(ctrl->engine);
+    pthread_rwlock_destroy(&ctrl->lock);
     free(ctrl);
 }
 
 void set_policy(RController* ctrl, RoutePolicy policy) {
-    pthread_mutex_lock(&ctrl->lock);
-    ctrl->policy = policy;
-    pthread_mutex_unlock(&ctrl->lock);
+    atomic_store(&ctrl->policy, policy);
+}
+
+void set_chunk_size(RController* ctrl, int units) {
+    atomic_store(&ctrl->chunk_size, units > 0 ? units : 0);
+}
+
+void set_cut_through(RController* ctrl, int enabled) {
+    atomic_store(&ctrl->cut_through, enabled != 0);
+}
+
+// Submission flags implied by the controller's transfer mode
+static int controller_flags(RController* ctrl) {
+    return atomic_load(&ctrl->cut_through) ? TRANSFER_CUT_THROUGH : 0;
+}
+
+// Current topology snapshot (retained); shared with every controller of the network
+static RTopology* controller_topology(RController* ctrl) {
+    return topology_current(ctrl->network);
+}
+
+static int controller_find_path(RController* ctrl, RoutePolicy policy, RNode* src, RNode* dst,
+                                int amount, RLink** path, int* plen) {
+    if (policy == POLICY_LATENCY && ctrl->network->ch) {
+        int found = find_path_ch(ctrl->network->ch, src, dst, path, plen);
+        if (found >= 0) return found;   // stale hierarchy: use the snapshot
+    }
+
+    RTopology* topo = controller_topology(ctrl);
+    int found = topology_find_path(topo, policy, src, dst, amount, path, plen);
+    topology_release(topo);
+    return found;
+}
+
+static int transfer_path(RNode* src, RLink** path, int plen, RPacket* pkt, RoutePolicy policy, int chunk,
+                         int flags);
+
+int controller_route(RController* ctrl, RNode* src, RNode* dst, int amount, RLink** path, int* plen) {
+    if (src == dst) return 0;
+    return controller_find_path(ctrl, atomic_load(&ctrl->policy), src, dst, amount, path, plen);
+}
+
+// Compute the route on a snapshot, then transfer holding only node locks.
+// flags may carry TRANSFER_LEASED when the caller already holds the source.
+static int controller_send(RController* ctrl, RNode* src, RNode* dst, RPacket* pkt, int flags) {
+    if (src == dst) {
+        ROC_WARN("Source and destination are the same.\n");
+        return 0;
+    }
+
+    RoutePolicy policy = atomic_load(&ctrl->policy);
+    RLink* path[MAX_PATH_LEN];
+    int plen = 0;
+    if (!controller_find_path(ctrl, policy, src, dst, pkt->amount, path, &plen)) {
+        ROC_WARN("No route from %s to %s under current policy.\n", src->name, dst->name);
+        return 0;
+    }
+
+    int chunk = atomic_load(&ctrl->chunk_size);
+    if (!atomic_load(&ctrl->cut_through) || chunk <= 0)
+        return transfer_path(src, path, plen, pkt, policy, chunk, flags);
+
+    // Cut-through needs every hop active at once: let the engine pipeline it
+    if (!ctrl->engine && !controller_start_engine(ctrl, TRANSFER_DEFAULT_THREADS)) return 0;
+    RTransfer* t = transfer_submit(ctrl->engine, src, path, plen, pkt, policy, chunk,
+                                   TRANSFER_CUT_THROUGH | flags, NULL, NULL);
+    if (!t) {
+        ROC_WARN("Not enough resources at %s\n", src->name);
+        return 0;
+    }
+    int ok = transfer_wait(t) == TRANSFER_COMPLETED;
+    transfer_release(t);
+    return ok;
 }
 
 int send_packet(RController* ctrl, RNode* src, RNode* dst, int amount) {
-    pthread_mutex_lock(&ctrl->lock);
-    RPacket pkt = { .src = src, .dst = dst, .amount = amount, .type = 0, .priority = 0 };
-    int result = route_packet(ctrl->network, src, dst, &pkt, ctrl->policy);
-    pthread_mutex_unlock(&ctrl->lock);
-    return result;
+    return send_packet_priority(ctrl, src, dst, amount, 0);
 }
 
-int send_packet_timed(RController* ctrl, RNode* src, RNode* dst, int amount, int timeout_ms) {
-    pthread_mutex_lock(&ctrl->lock);
+int send_packet_priority(RController* ctrl, RNode* src, RNode* dst, int amount, int priority) {
+    RPacket pkt = { .src = src, .dst = dst, .amount = amount, .type = 0, .priority = priority };
+    return controller_send(ctrl, src, dst, &pkt, 0);
+}
 
-    RPacket pkt = { .amount = amount };
+int send_packet_timed(RController* ctrl, RNode* src, RNode* dst, int amount, int timeout_ms) {
+    RPacket pkt = { .src = src, .dst = dst, .amount = amount };
     int reserved = reserve_timed(src, amount, timeout_ms);
     if (!reserved) {
-        printf("Failed to reserve %d units on %s\n", amount, src->name);
-        pthread_mutex_unlock(&ctrl->lock);
+        ROC_WARN("Failed to reserve %d units on %s\n", amount, src->name);
         return 0;
     }
 
-    // Route packet normally
-    int result = route_packet(ctrl->network, src, dst, &pkt, ctrl->policy);
+    // The packet travels on the lease; its timer gives the units back
+    return controller_send(ctrl, src, dst, &pkt, TRANSFER_LEASED);
+}
 
-    pthread_mutex_unlock(&ctrl->lock);
-    return result;
+// =====================
+// Batched sends
+// =====================
+typedef struct {
+    int src, dst;     // topology indices
+    int priority;
+    int index;        // position in the caller's array
+} BatchEntry;
+
+static int compare_batch_entry(const void* a, const void* b) {
+    const BatchEntry* x = (const BatchEntry*)a;
+    const BatchEntry* y = (const BatchEntry*)b;
+    if (x->src != y->src) return x->src - y->src;
+    if (x->dst != y->dst) return x->dst - y->dst;
+    if (x->priority != y->priority) return (x->priority > y->priority) ? -1 : 1;
+    return x->index - y->index;
+}
+
+int send_packets_batch(RController* ctrl, RPacket* pkts, int n) {
+    if (n <= 0) return 0;
+    if (!ctrl->engine && !controller_start_engine(ctrl, TRANSFER_DEFAULT_THREADS)) return 0;
+
+    RoutePolicy policy = atomic_load(&ctrl->policy);
+    RTopology* topo = controller_topology(ctrl);
+
+    BatchEntry* entries = malloc(n * sizeof(BatchEntry));
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        int s = topology_index(topo, pkts[i].src);
+        int d = topology_index(topo, pkts[i].dst);
+        if (s < 0 || d < 0 || s == d || pkts[i].amount < 0) continue;
+        entries[m].src = s;
+        entries[m].dst = d;
+        entries[m].priority = pkts[i].priority;
+        entries[m].index = i;
+        m++;
+    }
+    qsort(entries, m, sizeof(BatchEntry), compare_batch_entry);
+
+    RLink** prev = malloc((topo->node_count ? topo->node_count : 1) * sizeof(RLink*));
+    char* admitted = calloc(m ? m : 1, 1);
+    RTransfer** transfers = malloc((m ? m : 1) * sizeof(RTransfer*));
+    int* carried = malloc((m ? m : 1) * sizeof(int));   // packets riding on each transfer
+    int transfer_count = 0;
+    RLink* path[MAX_PATH_LEN];
+
+    for (int g = 0; g < m; ) {
+        int s = entries[g].src;
+        int end = g, single = 1;
+        while (end < m && entries[end].src == s) {
+            if (entries[end].dst != entries[g].dst) single = 0;
+            end++;
+        }
+
+        // One search per source: a full tree unless every packet shares a destination
+        topology_search(topo, policy, s, single ? entries[g].dst : -1, prev);
+
+        // Admit routable packets in order under a single lock of the source
+        RNode* node = topo->nodes[s];
+        int rejected = 0, taken = 0;
+        pthread_mutex_lock(&node->lock);
+        for (int i = g; i < end; i++) {
+            if (!prev[entries[i].dst]) continue;
+            int amount = pkts[entries[i].index].amount;
+            if (node->available >= amount) {
+                node->available -= amount;
+                admitted[i] = 1;
+                taken = 1;
+            } else {
+                rejected++;
+            }
+        }
+        pthread_mutex_unlock(&node->lock);
+        if (taken) notify_reserved(node);
+        if (rejected)
+            ROC_WARN("Batch: %d packet(s) from %s rejected, insufficient capacity.\n", rejected, node->name);
+
+        // Coalesce each (src, dst, priority) run into a single transfer
+        for (int i = g; i < end; ) {
+            int d = entries[i].dst;
+            int j = i, total = 0, count = 0, first = -1;
+            for (; j < end && entries[j].dst == d && entries[j].priority == entries[i].priority; j++) {
+                if (!admitted[j]) continue;
+                if (first < 0) first = entries[j].index;
+                total += pkts[entries[j].index].amount;
+                count++;
+            }
+
+            // Fastest completion depends on the coalesced size, so it routes per pair
+            int plen = 0;
+            int routed = prev[d] && ((policy == POLICY_FASTEST_COMPLETION)
+                                     ? topology_fastest_path(topo, s, d, total, path, &plen, NULL)
+                                     : topology_path(topo, prev, s, d, path, &plen));
+            if (!routed) {
+                ROC_WARN("No route from %s to %s under current policy.\n", node->name, topo->nodes[d]->name);
+                if (count) release(node, total);
+            } else if (count) {
+                RPacket pkt = pkts[first];
+                pkt.src = node;
+                pkt.dst = topo->nodes[d];
+                pkt.amount = total;
+                transfers[transfer_count] = transfer_submit(ctrl->engine, node, path, plen, &pkt, policy,
+                                                            atomic_load(&ctrl->chunk_size),
+                                                            TRANSFER_PRERESERVED | controller_flags(ctrl),
+                                                            NULL, NULL);
+                carried[transfer_count++] = count;
+            }
+            i = j;
+        }
+        g = end;
+    }
+    topology_release(topo);
+
+    int delivered = 0;
+    for (int k = 0; k < transfer_count; k++) {
+        if (transfer_wait(transfers[k]) == TRANSFER_COMPLETED) delivered += carried[k];
+        transfer_release(transfers[k]);
+    }
+
+    free(entries);
+    free(prev);
+    free(admitted);
+    free(transfers);
+    free(carried);
+    return delivered;
+}
+
+int controller_start_engine(RController* ctrl, int threads) {
+    pthread_rwlock_wrlock(&ctrl->lock);
+    if (!ctrl->engine) ctrl->engine = create_transfer_engine(threads);
+    int ok = ctrl->engine != NULL;
+    pthread_rwlock_unlock(&ctrl->lock);
+    return ok;
+}
+
+RTransfer* send_packet_async(RController* ctrl, RNode* src, RNode* dst, int amount,
+                             TransferCallback callback, void* arg) {
+    return send_packet_async_priority(ctrl, src, dst, amount, 0, callback, arg);
+}
+
+RTransfer* send_packet_async_priority(RController* ctrl, RNode* src, RNode* dst, int amount, int priority,
+                                      TransferCallback callback, void* arg) {
+    if (src == dst) return NULL;
+    if (!ctrl->engine && !controller_start_engine(ctrl, TRANSFER_DEFAULT_THREADS)) return NULL;
+
+    RoutePolicy policy = atomic_load(&ctrl->policy);
+    RLink* path[MAX_PATH_LEN];
+    int plen = 0;
+    if (!controller_find_path(ctrl, policy, src, dst, amount, path, &plen)) return NULL;
+
+    RPacket pkt = { .src = src, .dst = dst, .amount = amount, .type = 0, .priority = priority };
+    return transfer_submit(ctrl->engine, src, path, plen, &pkt, policy,
+                           atomic_load(&ctrl->chunk_size), controller_flags(ctrl), callback, arg);
 }
 
 // =====================
@@ -530,13 +964,84 @@ int find_path_widest(RNetwork* net, RNode* src, RNode* dst, RLink** path, int* p
     return 1;
 }
 
+// Dijkstra over live link backlog on the network's cached snapshot; loads
+// are read straight off the links
+int find_path_least_loaded(RNetwork* net, RNode* src, RNode* dst, RLink** path, int* plen) {
+    RTopology* topo = topology_current(net);
+    int found = topology_find_path(topo, POLICY_LEAST_LOADED, src, dst, 0, path, plen);
+    topology_release(topo);
+    return found;
+}
+
+// Exact size-aware search: sum(latency) + amount / bottleneck bandwidth
+int find_path_fastest(RNetwork* net, RNode* src, RNode* dst, int amount, RLink** path, int* plen) {
+    RTopology* topo = topology_current(net);
+    int found = topology_find_path(topo, POLICY_FASTEST_COMPLETION, src, dst, amount, path, plen);
+    topology_release(topo);
+    return found;
+}
+
+// Dijkstra over summed link latency
+int find_path_latency(RNetwork* net, RNode* src, RNode* dst, RLink** path, int* plen) {
+    int n = net->node_count;
+    if (src->id < 0 || dst->id < 0 || src->id >= n || dst->id >= n) return 0;
+
+    long long* dist = malloc(n * sizeof(long long));
+    RLink** prev_link = malloc(n * sizeof(RLink*));
+    for (int i = 0; i < n; i++) dist[i] = LLONG_MAX, prev_link[i] = NULL;
+
+    RHeap heap;
+    heap_init(&heap);
+    dist[src->id] = 0;
+    heap_push(&heap, 0, src);
+
+    RHeapItem it;
+    while (heap_pop(&heap, &it)) {
+        RNode* cur = (RNode*)it.data;
+        if (it.key > dist[cur->id]) continue; // stale entry
+        if (cur == dst) break;
+
+        for (int i = 0; i < cur->link_count; i++) {
+            RLink* l = cur->links[i];
+            if (!l->enabled) continue;
+            RNode* next = (l->a == cur) ? l->b : l->a;
+            if (next->id < 0) continue;
+
+            long long nd = it.key + l->latency;
+            if (nd < dist[next->id]) {
+                dist[next->id] = nd;
+                prev_link[next->id] = l;
+                heap_push(&heap, nd, next);
+            }
+        }
+    }
+    heap_free(&heap);
+
+    int found = dist[dst->id] != LLONG_MAX;
+    if (found) {
+        int plen_local = 0;
+        RNode* current = dst;
+        while (current != src && plen_local < MAX_PATH_LEN) {
+            RLink* l = prev_link[current->id];
+            path[plen_local++] = l;
+            current = (l->a == current) ? l->b : l->a;
+        }
+        found = (current == src);
+        *plen = plen_local;
+    }
+
+    free(dist);
+    free(prev_link);
+    return found;
+}
+
 int route_packet(RNetwork* net, RNode* src, RNode* dst, RPacket* pkt, RoutePolicy policy) {
     if (src == dst) {
-        printf("Source and destination are the same.\n");
+        ROC_WARN("Source and destination are the same.\n");
         return 0;
     }
 
-    RLink* path[256];
+    RLink* path[MAX_PATH_LEN];
     int plen = 0;
     int found = 0;
 
@@ -544,73 +1049,87 @@ int route_packet(RNetwork* net, RNode* src, RNode* dst, RPacket* pkt, RoutePolic
         found = find_path_shortest(net, src, dst, path, &plen);
     } else if (policy == POLICY_WIDEST) {
         found = find_path_widest(net, src, dst, path, &plen);
+    } else if (policy == POLICY_LATENCY) {
+        found = net->ch ? find_path_ch(net->ch, src, dst, path, &plen) : -1;
+        if (found < 0) found = find_path_latency(net, src, dst, path, &plen);
+    } else if (policy == POLICY_LEAST_LOADED) {
+        found = find_path_least_loaded(net, src, dst, path, &plen);
+    } else if (policy == POLICY_FASTEST_COMPLETION) {
+        found = find_path_fastest(net, src, dst, pkt->amount, path, &plen);
     }
 
     if (!found) {
-        printf("No route from %s to %s under current policy.\n", src->name, dst->name);
+        ROC_WARN("No route from %s to %s under current policy.\n", src->name, dst->name);
         return 0;
     }
 
-    if (!reserve(src, pkt->amount)) {
-        printf("Not enough resources at %s\n", src->name);
-        return 0;
-    }
+    return transfer_path(src, path, plen, pkt, policy, 0, 0);
+}
 
-    // Transfer packet along path
+// Walk the path hop by hop (store-and-forward) without touching node capacity.
+// Each hop queues for the link per chunk, so urgent packets can cut in.
+static int cross_path(RNode* src, RLink** path, int plen, RPacket* pkt, RoutePolicy policy, int chunk) {
     RNode* current = src;
     for (int i = plen - 1; i >= 0; i--) {
         RLink* l = path[i];
 
         // Check if link is enabled
         if (!l->enabled) {
-            printf("Link [%s -> %s] is disabled.\n", l->a->name, l->b->name);
-            release(src, pkt->amount);
+            ROC_WARN("Link [%s -> %s] is disabled.\n", l->a->name, l->b->name);
             return 0;
         }
 
         // Policy/permission check
         if ((l->permissions & (1 << policy)) == 0) {
-            printf("Link [%s -> %s] forbidden under this policy.\n", l->a->name, l->b->name);
-            release(src, pkt->amount);
+            ROC_WARN("Link [%s -> %s] forbidden under this policy.\n", l->a->name, l->b->name);
             return 0;
         }
 
         RNode* next = (l->a == current) ? l->b : l->a;
-        printf("[%s -> %s] Transferring %d units...\n", current->name, next->name, pkt->amount);
-        usleep((pkt->amount * 1000000) / l->bandwidth + l->latency * 1000);
-        printf("[%s] Received %d units!\n", next->name, pkt->amount);
+        ROC_TRACE_EVENT(TRACE_HOP_START, current->id, next->id, l->id, pkt->amount);
+        atomic_fetch_add_explicit(&l->load, pkt->amount, memory_order_relaxed);
+        int remaining = pkt->amount;
+        do {
+            int piece = (chunk > 0 && remaining > chunk) ? chunk : remaining;
+            linkq_acquire_wait(l->txq, pkt->priority, piece);
+            roc_sleep_us(((long long)piece * 1000000LL) / l->bandwidth);
+            linkq_release(l->txq);
+            remaining -= piece;
+        } while (remaining > 0);
+        atomic_fetch_sub_explicit(&l->load, pkt->amount, memory_order_relaxed);
+        roc_sleep_us(l->latency * 1000LL);
+        ROC_TRACE_EVENT(TRACE_HOP_END, current->id, next->id, l->id, pkt->amount);
 
         current = next;
     }
-
-    release(src, pkt->amount);
     return 1;
 }
 
+int carry_packet(RNode* src, RLink** path, int plen, RPacket* pkt, RoutePolicy policy, int chunk) {
+    return cross_path(src, path, plen, pkt, policy, chunk);
+}
+
+// Reserve at the source for the duration of the transfer, unless a lease
+// (TRANSFER_LEASED) already holds it
+static int transfer_path(RNode* src, RLink** path, int plen, RPacket* pkt, RoutePolicy policy, int chunk,
+                         int flags) {
+    int leased = flags & TRANSFER_LEASED;
+    if (!leased && !reserve(src, pkt->amount)) {
+        ROC_WARN("Not enough resources at %s\n", src->name);
+        return 0;
+    }
+
+    int ok = cross_path(src, path, plen, pkt, policy, chunk);
+    if (!leased) release(src, pkt->amount);
+    return ok;
+}
+
 // =====================
 // Timing stuff
 // =====================
 
-static void* timed_release_thread(void* arg) {
-    TimedReserveArgs* args = (TimedReserveArgs*)arg;
-    usleep(args->timeout_ms * 1000); // sleep in microseconds
-    release(args->node, args->amount);
-    free(args);
-    return NULL;
-}
-
 int reserve_timed(RNode* node, int amount, int timeout_ms) {
     if (!reserve(node, amount)) return 0;
-
-    // Start a detached thread to auto-release
-    pthread_t tid;
-    TimedReserveArgs* args = malloc(sizeof(TimedReserveArgs));
-    args->node = node;
-    args->amount = amount;
-    args->timeout_ms = timeout_ms;
-
-    pthread_create(&tid, NULL, timed_release_thread, args);
-    pthread_detach(tid);
-
+    release_after(node, amount, timeout_ms);
     return 1;
 }
@@ -1,4 +1,5 @@
 #include "roc_bundle.h"
+#include "roc_clock.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,12 +10,17 @@ RBundle* create_bundle(const char* name, int priority) {
     bundle->item_count = 0;
     bundle->priority = priority;
     bundle->status = BUNDLE_PENDING;
+    bundle->pending = 0;
+    bundle->hooks = NULL;
     pthread_mutex_init(&bundle->lock, NULL);
+    pthread_cond_init(&bundle->done, NULL);
     return bundle;
 }
 
 void destroy_bundle(RBundle* bundle) {
+    completion_hooks_free(bundle->hooks);
     pthread_mutex_destroy(&bundle->lock);
+    pthread_cond_destroy(&bundle->done);
     free(bundle);
 }
 
@@ -43,9 +49,8 @@ int bundle_add_task(RBundle* bundle, RTask* task) {
     return bundle_add_item(bundle, (void*)task, BUNDLE_ITEM_TASK);
 }
 
-// Helper to update bundle status
-static void update_bundle_status(RBundle* bundle) {
-    pthread_mutex_lock(&bundle->lock);
+// Derive the bundle status from its items; caller holds bundle->lock
+static void compute_bundle_status(RBundle* bundle) {
     int all_completed = 1;
     int any_failed = 0;
 
@@ -74,33 +79,67 @@ static void update_bundle_status(RBundle* bundle) {
     if (any_failed) bundle->status = BUNDLE_FAILED;
     else if (all_completed) bundle->status = BUNDLE_COMPLETED;
     else bundle->status = BUNDLE_RUNNING;
+}
 
+// Helper to update bundle status
+static void update_bundle_status(RBundle* bundle) {
+    pthread_mutex_lock(&bundle->lock);
+    compute_bundle_status(bundle);
     pthread_mutex_unlock(&bundle->lock);
 }
 
+// Completion callback on each item of a running bundle
+static void bundle_item_done(void* item, void* arg) {
+    (void)item;
+    RBundle* bundle = (RBundle*)arg;
+    RCompletionHook* hooks = NULL;
+
+    pthread_mutex_lock(&bundle->lock);
+    if (--bundle->pending == 0) {
+        compute_bundle_status(bundle);
+        hooks = bundle->hooks;
+        bundle->hooks = NULL;
+        roc_cond_broadcast(&bundle->done);
+    }
+    pthread_mutex_unlock(&bundle->lock);
+    completion_hooks_run(hooks, bundle);
+}
+
+// Start one item; returns 0 if its completion cannot be tracked
+static int bundle_start_item(RBundle* bundle, BundleItem* bi, RTaskScheduler* sched) {
+    switch (bi->type) {
+        case BUNDLE_ITEM_JOB:
+            job_run((RJob*)bi->item, sched);
+            return job_on_complete((RJob*)bi->item, bundle_item_done, bundle);
+        case BUNDLE_ITEM_WORKFLOW:
+            workflow_run((RWorkflow*)bi->item, sched);
+            return workflow_on_complete((RWorkflow*)bi->item, bundle_item_done, bundle);
+        case BUNDLE_ITEM_TASK:
+            if (!task_on_complete((RTask*)bi->item, bundle_item_done, bundle)) return 0;
+            if (!scheduler_add_task(sched, (RTask*)bi->item))
+                task_finish((RTask*)bi->item, TASK_FAILED);
+            return 1;
+    }
+    return 0;
+}
+
 int bundle_run(RBundle* bundle, RTaskScheduler* sched) {
     pthread_mutex_lock(&bundle->lock);
-    if (bundle->item_count == 0) {
+    if (bundle->item_count == 0 || bundle->pending > 0) {
         pthread_mutex_unlock(&bundle->lock);
         return 0;
     }
     bundle->status = BUNDLE_RUNNING;
+    // Held by this call until every item has been started
+    bundle->pending = bundle->item_count + 1;
+    int count = bundle->item_count;
     pthread_mutex_unlock(&bundle->lock);
 
-    for (int i = 0; i < bundle->item_count; i++) {
-        BundleItem* bi = &bundle->items[i];
-        switch (bi->type) {
-            case BUNDLE_ITEM_JOB:
-                job_run((RJob*)bi->item, sched);
-                break;
-            case BUNDLE_ITEM_WORKFLOW:
-                workflow_run((RWorkflow*)bi->item, sched);
-                break;
-            case BUNDLE_ITEM_TASK:
-                scheduler_add_task(sched, (RTask*)bi->item);
-                break;
-        }
+    for (int i = 0; i < count; i++) {
+        if (!bundle_start_item(bundle, &bundle->items[i], sched))
+            bundle_item_done(NULL, bundle);
     }
+    bundle_item_done(NULL, bundle);
     return 1;
 }
 
@@ -111,3 +150,23 @@ BundleStatus bundle_status(RBundle* bundle) {
     pthread_mutex_unlock(&bundle->lock);
     return s;
 }
+
+BundleStatus bundle_wait(RBundle* bundle) {
+    pthread_mutex_lock(&bundle->lock);
+    while (bundle->pending > 0)
+        roc_cond_wait(&bundle->done, &bundle->lock);
+    pthread_mutex_unlock(&bundle->lock);
+    return bundle_status(bundle);
+}
+
+int bundle_on_complete(RBundle* bundle, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&bundle->lock);
+    if (bundle->pending > 0) {
+        int ok = completion_hook_add(&bundle->hooks, fn, arg);
+        pthread_mutex_unlock(&bundle->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&bundle->lock);
+    fn(bundle, arg);
+    return 1;
+}
@@ -1,5 +1,5 @@
-#include <windows.h>
 #include "roc_bundle_queue.h"
+#include "roc_log.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -56,12 +56,9 @@ int process_bundle_queue(RBundleQueue* queue, RTaskScheduler* sched) {
         bundle_run(bundle, sched);
 
         // Wait for bundle to complete
-        while (bundle_status(bundle) != BUNDLE_COMPLETED &&
-               bundle_status(bundle) != BUNDLE_FAILED) {
-            Sleep(50);
-        }
-        printf("[BundleQueue] Bundle '%s' finished with status %d\n",
-               bundle->name, bundle_status(bundle));
+        BundleStatus s = bundle_wait(bundle);
+        ROC_INFO("[BundleQueue] Bundle '%s' finished with status %d\n",
+               bundle->name, s);
     }
     return 1;
 }
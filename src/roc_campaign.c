@@ -1,7 +1,9 @@
 #include "roc_campaign.h"
 #include <stdlib.h>
 #include <stdio.h>
-#include <unistd.h>
+#include <string.h>
+#include "roc_clock.h"
+#include "roc_log.h"
 
 RCampaign* create_campaign(const char* name, int priority) {
     RCampaign* campaign = (RCampaign*)malloc(sizeof(RCampaign));
@@ -9,12 +11,17 @@ RCampaign* create_campaign(const char* name, int priority) {
     campaign->bundle_count = 0;
     campaign->priority = priority;
     campaign->status = CAMPAIGN_PENDING;
+    campaign->running = 0;
+    campaign->hooks = NULL;
     pthread_mutex_init(&campaign->lock, NULL);
+    pthread_cond_init(&campaign->done, NULL);
     return campaign;
 }
 
 void destroy_campaign(RCampaign* campaign) {
+    completion_hooks_free(campaign->hooks);
     pthread_mutex_destroy(&campaign->lock);
+    pthread_cond_destroy(&campaign->done);
     free(campaign);
 }
 
@@ -29,9 +36,8 @@ int campaign_add_bundle(RCampaign* campaign, RBundle* bundle) {
     return 1;
 }
 
-// Helper to update campaign status
-static void update_campaign_status(RCampaign* campaign) {
-    pthread_mutex_lock(&campaign->lock);
+// Derive the campaign status from its bundles; caller holds campaign->lock
+static void compute_campaign_status(RCampaign* campaign) {
     int all_completed = 1;
     int any_failed = 0;
 
@@ -44,30 +50,42 @@ static void update_campaign_status(RCampaign* campaign) {
     if (any_failed) campaign->status = CAMPAIGN_FAILED;
     else if (all_completed) campaign->status = CAMPAIGN_COMPLETED;
     else campaign->status = CAMPAIGN_RUNNING;
+}
 
+// Helper to update campaign status
+static void update_campaign_status(RCampaign* campaign) {
+    pthread_mutex_lock(&campaign->lock);
+    compute_campaign_status(campaign);
     pthread_mutex_unlock(&campaign->lock);
 }
 
 int campaign_run(RCampaign* campaign, RTaskScheduler* sched) {
     pthread_mutex_lock(&campaign->lock);
-    if (campaign->bundle_count == 0) {
+    if (campaign->bundle_count == 0 || campaign->running) {
         pthread_mutex_unlock(&campaign->lock);
         return 0;
     }
     campaign->status = CAMPAIGN_RUNNING;
+    campaign->running = 1;
     pthread_mutex_unlock(&campaign->lock);
 
     for (int i = 0; i < campaign->bundle_count; i++) {
         bundle_run(campaign->bundles[i], sched);
 
         // Wait for bundle completion
-        while (bundle_status(campaign->bundles[i]) != BUNDLE_COMPLETED &&
-               bundle_status(campaign->bundles[i]) != BUNDLE_FAILED) {
-            usleep(50000);
-        }
-        printf("[Campaign] Bundle '%s' finished with status %d\n",
-               campaign->bundles[i]->name, bundle_status(campaign->bundles[i]));
+        BundleStatus s = bundle_wait(campaign->bundles[i]);
+        ROC_INFO("[Campaign] Bundle '%s' finished with status %d\n",
+               campaign->bundles[i]->name, s);
     }
+
+    pthread_mutex_lock(&campaign->lock);
+    compute_campaign_status(campaign);
+    campaign->running = 0;
+    RCompletionHook* hooks = campaign->hooks;
+    campaign->hooks = NULL;
+    roc_cond_broadcast(&campaign->done);
+    pthread_mutex_unlock(&campaign->lock);
+    completion_hooks_run(hooks, campaign);
     return 1;
 }
 
@@ -78,3 +96,23 @@ CampaignStatus campaign_status(RCampaign* campaign) {
     pthread_mutex_unlock(&campaign->lock);
     return s;
 }
+
+CampaignStatus campaign_wait(RCampaign* campaign) {
+    pthread_mutex_lock(&campaign->lock);
+    while (campaign->running)
+        roc_cond_wait(&campaign->done, &campaign->lock);
+    pthread_mutex_unlock(&campaign->lock);
+    return campaign_status(campaign);
+}
+
+int campaign_on_complete(RCampaign* campaign, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&campaign->lock);
+    if (campaign->running) {
+        int ok = completion_hook_add(&campaign->hooks, fn, arg);
+        pthread_mutex_unlock(&campaign->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&campaign->lock);
+    fn(campaign, arg);
+    return 1;
+}
@@ -1,7 +1,7 @@
 #include "roc_campaign_queue.h"
 #include <stdlib.h>
 #include <stdio.h>
-#include <unistd.h>
+#include "roc_log.h"
 
 RCampaignQueue* create_campaign_queue() {
     RCampaignQueue* queue = (RCampaignQueue*)malloc(sizeof(RCampaignQueue));
@@ -58,12 +58,9 @@ int process_campaign_queue(RCampaignQueue* queue, RTaskScheduler* sched) {
         campaign_run(campaign, sched);
 
         // Wait for completion
-        while (campaign_status(campaign) != CAMPAIGN_COMPLETED &&
-               campaign_status(campaign) != CAMPAIGN_FAILED) {
-            usleep(50000);
-        }
-        printf("[CampaignQueue] Campaign '%s' finished with status %d\n",
-               campaign->name, campaign_status(campaign));
+        CampaignStatus s = campaign_wait(campaign);
+        ROC_INFO("[CampaignQueue] Campaign '%s' finished with status %d\n",
+               campaign->name, s);
     }
     return 1;
 }
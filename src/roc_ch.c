@@ -0,0 +1,592 @@
+#include "roc_ch.h"
+#include "roc_heap.h"
+#include "roc_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+#define CH_WITNESS_SETTLE_LIMIT 200   // bound on local searches during contraction
+
+// =====================
+// Internal graph types
+// =====================
+typedef struct {
+    int a, b;          // endpoint node indices
+    long long w;       // summed latency
+    RLink* link;       // original link, NULL for shortcuts
+    int c1, c2;        // shortcut children (a-mid, mid-b), -1 for originals
+    int mid;           // contracted node bypassed by a shortcut
+} CHEdge;
+
+struct CHGraph {
+    unsigned long version;   // net->version the graph was built from
+    int node_count;
+    RNode** nodes;     // nodes[i]->id == i at build time
+
+    CHEdge* edges;
+    int edge_count;
+    int shortcut_count;
+
+    // Upward adjacency in CSR form: edges to higher-ranked neighbours
+    int* up_off;
+    int* up_to;
+    long long* up_w;
+    int* up_edge;
+};
+
+typedef struct {
+    int* items;
+    int count;
+    int capacity;
+} IntVec;
+
+static void intvec_push(IntVec* v, int x) {
+    if (v->count == v->capacity) {
+        v->capacity = v->capacity ? v->capacity * 2 : 4;
+        v->items = realloc(v->items, v->capacity * sizeof(int));
+    }
+    v->items[v->count++] = x;
+}
+
+// =====================
+// Build state
+// =====================
+typedef struct {
+    int n;
+    CHEdge* edges;
+    int edge_count;
+    int edge_capacity;
+    IntVec* adj;          // edge ids per node (originals + shortcuts)
+    char* contracted;
+    int* deleted_neighbors;
+
+    // witness search scratch
+    long long* dist;
+    int* touched;
+    int touched_count;
+    RHeap heap;
+} CHBuild;
+
+static int build_add_edge(CHBuild* b, int u, int v, long long w, RLink* link, int c1, int c2, int mid) {
+    if (b->edge_count == b->edge_capacity) {
+        b->edge_capacity = b->edge_capacity ? b->edge_capacity * 2 : 64;
+        b->edges = realloc(b->edges, b->edge_capacity * sizeof(CHEdge));
+    }
+    int id = b->edge_count++;
+    CHEdge* e = &b->edges[id];
+    e->a = u; e->b = v; e->w = w;
+    e->link = link; e->c1 = c1; e->c2 = c2; e->mid = mid;
+    intvec_push(&b->adj[u], id);
+    intvec_push(&b->adj[v], id);
+    return id;
+}
+
+static int edge_other(const CHEdge* e, int x) {
+    return (e->a == x) ? e->b : e->a;
+}
+
+// Local Dijkstra from src over uncontracted nodes, skipping `avoid`.
+// Leaves distances in b->dist (LLONG_MAX = unreached); caller resets.
+static void witness_search(CHBuild* b, int src, int avoid, long long limit) {
+    RHeap* heap = &b->heap;
+    heap_clear(heap);
+    b->dist[src] = 0;
+    b->touched[b->touched_count++] = src;
+    heap_push(heap, 0, (void*)(intptr_t)src);
+
+    int settled = 0;
+    RHeapItem it;
+    while (heap_pop(heap, &it)) {
+        int u = (int)(intptr_t)it.data;
+        if (it.key > b->dist[u]) continue;
+        if (it.key > limit || ++settled > CH_WITNESS_SETTLE_LIMIT) break;
+
+        for (int i = 0; i < b->adj[u].count; i++) {
+            CHEdge* e = &b->edges[b->adj[u].items[i]];
+            int x = edge_other(e, u);
+            if (x == avoid || b->contracted[x]) continue;
+
+            long long nd = it.key + e->w;
+            if (nd < b->dist[x]) {
+                if (b->dist[x] == LLONG_MAX) b->touched[b->touched_count++] = x;
+                b->dist[x] = nd;
+                heap_push(heap, nd, (void*)(intptr_t)x);
+            }
+        }
+    }
+}
+
+static void witness_reset(CHBuild* b) {
+    for (int i = 0; i < b->touched_count; i++) b->dist[b->touched[i]] = LLONG_MAX;
+    b->touched_count = 0;
+}
+
+// Collect the cheapest edge to every uncontracted neighbour of v
+static int collect_neighbors(CHBuild* b, int v, int* nbr, long long* nw, int* ne) {
+    int count = 0;
+    for (int i = 0; i < b->adj[v].count; i++) {
+        int eid = b->adj[v].items[i];
+        CHEdge* e = &b->edges[eid];
+        int x = edge_other(e, v);
+        if (x == v || b->contracted[x]) continue;
+
+        int k;
+        for (k = 0; k < count; k++) if (nbr[k] == x) break;
+        if (k == count) {
+            nbr[count] = x; nw[count] = e->w; ne[count] = eid;
+            count++;
+        } else if (e->w < nw[k]) {
+            nw[k] = e->w; ne[k] = eid;
+        }
+    }
+    return count;
+}
+
+// Contract v (or just count the shortcuts it would need when simulate=1)
+static int contract_node(CHBuild* b, int v, int simulate, int* out_degree) {
+    int deg_max = b->adj[v].count;
+    int* nbr = malloc((deg_max + 1) * sizeof(int));
+    long long* nw = malloc((deg_max + 1) * sizeof(long long));
+    int* ne = malloc((deg_max + 1) * sizeof(int));
+
+    int count = collect_neighbors(b, v, nbr, nw, ne);
+    if (out_degree) *out_degree = count;
+
+    int shortcuts = 0;
+    for (int i = 0; i < count; i++) {
+        long long limit = 0;
+        for (int j = i + 1; j < count; j++)
+            if (nw[i] + nw[j] > limit) limit = nw[i] + nw[j];
+        if (i + 1 >= count) break;
+
+        witness_search(b, nbr[i], v, limit);
+        for (int j = i + 1; j < count; j++) {
+            long long via = nw[i] + nw[j];
+            if (b->dist[nbr[j]] <= via) continue; // witness path exists
+            shortcuts++;
+            if (!simulate)
+                build_add_edge(b, nbr[i], nbr[j], via, NULL, ne[i], ne[j], v);
+        }
+        witness_reset(b);
+    }
+
+    free(nbr); free(nw); free(ne);
+    return shortcuts;
+}
+
+static long long node_priority(CHBuild* b, int v) {
+    int degree = 0;
+    int shortcuts = contract_node(b, v, 1, &degree);
+    return (long long)(shortcuts - degree) + b->deleted_neighbors[v];
+}
+
+static void free_graph(CHGraph* g) {
+    if (!g) return;
+    free(g->nodes);
+    free(g->edges);
+    free(g->up_off);
+    free(g->up_to);
+    free(g->up_w);
+    free(g->up_edge);
+    free(g);
+}
+
+// An enabled link as the network looked when the build started
+typedef struct {
+    int a, b;
+    long long w;
+    RLink* link;
+} CHInputEdge;
+
+// The build runs off the editing thread, so it copies what it needs under
+// net->lock and never touches the network's arrays afterwards. The version
+// is read under the same lock: edits bump it after unlocking, so a copy is
+// never tagged newer than what it holds.
+static CHGraph* build_graph(RNetwork* net) {
+    pthread_rwlock_rdlock(&net->lock);
+    unsigned long version = atomic_load(&net->version);
+    int n = net->node_count;
+    RNode** nodes = malloc((n ? n : 1) * sizeof(RNode*));
+    CHInputEdge* input = malloc((net->link_count ? net->link_count : 1) * sizeof(CHInputEdge));
+    int input_count = 0;
+    if (nodes && input) {
+        memcpy(nodes, net->nodes, n * sizeof(RNode*));
+        for (int i = 0; i < net->link_count; i++) {
+            RLink* l = net->links[i];
+            if (!l->enabled || l->a == l->b) continue;
+            if (l->a->id < 0 || l->b->id < 0 || l->a->id >= n || l->b->id >= n) continue;
+            input[input_count++] = (CHInputEdge){ l->a->id, l->b->id, l->latency, l };
+        }
+    }
+    pthread_rwlock_unlock(&net->lock);
+    if (!nodes || !input) {
+        free(nodes);
+        free(input);
+        return NULL;
+    }
+
+    CHBuild b;
+    memset(&b, 0, sizeof(b));
+    b.n = n;
+    b.adj = calloc(n ? n : 1, sizeof(IntVec));
+    b.contracted = calloc(n ? n : 1, 1);
+    b.deleted_neighbors = calloc(n ? n : 1, sizeof(int));
+    b.dist = malloc((n ? n : 1) * sizeof(long long));
+    b.touched = malloc((n ? n : 1) * sizeof(int));
+    for (int i = 0; i < n; i++) b.dist[i] = LLONG_MAX;
+
+    for (int i = 0; i < input_count; i++)
+        build_add_edge(&b, input[i].a, input[i].b, input[i].w, input[i].link, -1, -1, -1);
+    free(input);
+
+    // Node ordering with lazy priority updates
+    int* rank = malloc((n ? n : 1) * sizeof(int));
+    RHeap order;
+    heap_init(&order);
+    for (int v = 0; v < n; v++) heap_push(&order, node_priority(&b, v), (void*)(intptr_t)v);
+
+    int next_rank = 0;
+    RHeapItem it;
+    while (heap_pop(&order, &it)) {
+        int v = (int)(intptr_t)it.data;
+        long long prio = node_priority(&b, v);
+        RHeapItem* top = heap_peek(&order);
+        if (top && prio > top->key) {
+            heap_push(&order, prio, (void*)(intptr_t)v);
+            continue;
+        }
+
+        int degree = 0;
+        contract_node(&b, v, 0, &degree);
+        b.contracted[v] = 1;
+        rank[v] = next_rank++;
+
+        // Neighbours lose their edges to v so later searches stay local
+        for (int i = 0; i < b.adj[v].count; i++) {
+            int x = edge_other(&b.edges[b.adj[v].items[i]], v);
+            if (b.contracted[x]) continue;
+            b.deleted_neighbors[x]++;
+
+            IntVec* xa = &b.adj[x];
+            int keep = 0;
+            for (int k = 0; k < xa->count; k++)
+                if (!b.contracted[edge_other(&b.edges[xa->items[k]], x)]) xa->items[keep++] = xa->items[k];
+            xa->count = keep;
+        }
+    }
+    heap_free(&order);
+    heap_free(&b.heap);
+
+    // Freeze into an upward CSR graph
+    CHGraph* g = calloc(1, sizeof(CHGraph));
+    g->version = version;
+    g->node_count = n;
+    g->nodes = nodes;
+    g->edges = b.edges;
+    g->edge_count = b.edge_count;
+    for (int i = 0; i < b.edge_count; i++) if (!b.edges[i].link) g->shortcut_count++;
+
+    g->up_off = calloc(n + 1, sizeof(int));
+    for (int i = 0; i < b.edge_count; i++) {
+        CHEdge* e = &b.edges[i];
+        int low = (rank[e->a] < rank[e->b]) ? e->a : e->b;
+        g->up_off[low + 1]++;
+    }
+    for (int v = 0; v < n; v++) g->up_off[v + 1] += g->up_off[v];
+
+    int m = b.edge_count ? b.edge_count : 1;
+    g->up_to = malloc(m * sizeof(int));
+    g->up_w = malloc(m * sizeof(long long));
+    g->up_edge = malloc(m * sizeof(int));
+    int* fill = malloc((n ? n : 1) * sizeof(int));
+    for (int v = 0; v < n; v++) fill[v] = g->up_off[v];
+    for (int i = 0; i < b.edge_count; i++) {
+        CHEdge* e = &b.edges[i];
+        int low = (rank[e->a] < rank[e->b]) ? e->a : e->b;
+        int slot = fill[low]++;
+        g->up_to[slot] = edge_other(e, low);
+        g->up_w[slot] = e->w;
+        g->up_edge[slot] = i;
+    }
+
+    free(fill);
+    free(rank);
+    for (int v = 0; v < n; v++) free(b.adj[v].items);
+    free(b.adj);
+    free(b.contracted);
+    free(b.deleted_neighbors);
+    free(b.dist);
+    free(b.touched);
+    return g;
+}
+
+// =====================
+// Per-thread query scratch
+// =====================
+typedef struct {
+    int n;
+    unsigned int gen;
+    unsigned int* stamp[2];
+    long long* dist[2];
+    int* pred[2];        // CH edge used to reach each node
+} CHScratch;
+
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+static void scratch_free(void* p) {
+    CHScratch* s = (CHScratch*)p;
+    if (!s) return;
+    for (int d = 0; d < 2; d++) {
+        free(s->stamp[d]);
+        free(s->dist[d]);
+        free(s->pred[d]);
+    }
+    free(s);
+}
+
+static void scratch_key_init(void) {
+    pthread_key_create(&scratch_key, scratch_free);
+}
+
+// Scratch arrays are reused across queries; a generation stamp replaces
+// clearing, so a query only touches the nodes it actually visits.
+static CHScratch* scratch_get(int n) {
+    pthread_once(&scratch_once, scratch_key_init);
+    CHScratch* s = pthread_getspecific(scratch_key);
+    if (!s) {
+        s = calloc(1, sizeof(CHScratch));
+        pthread_setspecific(scratch_key, s);
+    }
+    if (s->n < n) {
+        for (int d = 0; d < 2; d++) {
+            free(s->stamp[d]); free(s->dist[d]); free(s->pred[d]);
+            s->stamp[d] = calloc(n, sizeof(unsigned int));
+            s->dist[d] = malloc(n * sizeof(long long));
+            s->pred[d] = malloc(n * sizeof(int));
+        }
+        s->n = n;
+        s->gen = 0;
+    }
+    if (++s->gen == 0) {
+        for (int d = 0; d < 2; d++) memset(s->stamp[d], 0, s->n * sizeof(unsigned int));
+        s->gen = 1;
+    }
+    return s;
+}
+
+// =====================
+// Path unpacking
+// =====================
+static int unpack_edge(const CHGraph* g, int eid, int from, RLink** out, int* len) {
+    const CHEdge* e = &g->edges[eid];
+    if (e->link) {
+        if (*len >= MAX_PATH_LEN) return 0;
+        out[(*len)++] = e->link;
+        return 1;
+    }
+    const CHEdge* first = &g->edges[e->c1];
+    int a = e->c1, b = e->c2;
+    if (first->a != from && first->b != from) { a = e->c2; b = e->c1; }
+    return unpack_edge(g, a, from, out, len) && unpack_edge(g, b, e->mid, out, len);
+}
+
+static int query(const CHGraph* g, RNode* src, RNode* dst, RLink** path, int* plen) {
+    int s = src->id, t = dst->id;
+    if (s < 0 || t < 0 || s >= g->node_count || t >= g->node_count) return 0;
+    if (g->nodes[s] != src || g->nodes[t] != dst) return 0; // built before these ids
+
+    if (s == t) { *plen = 0; return 1; }
+
+    CHScratch* sc = scratch_get(g->node_count);
+    unsigned int gen = sc->gen;
+    RHeap heap[2];
+    heap_init(&heap[0]);
+    heap_init(&heap[1]);
+
+    int origin[2] = { s, t };
+    for (int d = 0; d < 2; d++) {
+        sc->stamp[d][origin[d]] = gen;
+        sc->dist[d][origin[d]] = 0;
+        sc->pred[d][origin[d]] = -1;
+        heap_push(&heap[d], 0, (void*)(intptr_t)origin[d]);
+    }
+
+    long long best = LLONG_MAX;
+    int meet = -1;
+    int dir = 0;
+    for (;;) {
+        RHeapItem* top0 = heap_peek(&heap[0]);
+        RHeapItem* top1 = heap_peek(&heap[1]);
+        int live0 = top0 && top0->key < best;
+        int live1 = top1 && top1->key < best;
+        if (!live0 && !live1) break;
+        if (!live0) dir = 1;
+        else if (!live1) dir = 0;
+        else dir ^= 1;
+
+        RHeapItem it;
+        heap_pop(&heap[dir], &it);
+        int v = (int)(intptr_t)it.data;
+        if (it.key > sc->dist[dir][v]) continue;
+
+        int other = dir ^ 1;
+        if (sc->stamp[other][v] == gen && it.key + sc->dist[other][v] < best) {
+            best = it.key + sc->dist[other][v];
+            meet = v;
+        }
+
+        for (int i = g->up_off[v]; i < g->up_off[v + 1]; i++) {
+            int x = g->up_to[i];
+            long long nd = it.key + g->up_w[i];
+            if (sc->stamp[dir][x] != gen || nd < sc->dist[dir][x]) {
+                sc->stamp[dir][x] = gen;
+                sc->dist[dir][x] = nd;
+                sc->pred[dir][x] = g->up_edge[i];
+                heap_push(&heap[dir], nd, (void*)(intptr_t)x);
+            }
+        }
+    }
+    heap_free(&heap[0]);
+    heap_free(&heap[1]);
+
+    if (meet < 0) return 0;
+
+    // Forward half: collect CH edges meet -> src, then unpack in travel order
+    int fwd[MAX_PATH_LEN];
+    int fwd_from[MAX_PATH_LEN];
+    int fcount = 0;
+    for (int v = meet; v != s; ) {
+        if (fcount >= MAX_PATH_LEN) return 0;
+        int eid = sc->pred[0][v];
+        int prev = edge_other(&g->edges[eid], v);
+        fwd[fcount] = eid;
+        fwd_from[fcount] = prev;
+        fcount++;
+        v = prev;
+    }
+
+    RLink* hops[MAX_PATH_LEN];
+    int len = 0;
+    for (int i = fcount - 1; i >= 0; i--)
+        if (!unpack_edge(g, fwd[i], fwd_from[i], hops, &len)) return 0;
+
+    for (int v = meet; v != t; ) {
+        int eid = sc->pred[1][v];
+        if (!unpack_edge(g, eid, v, hops, &len)) return 0;
+        v = edge_other(&g->edges[eid], v);
+    }
+
+    // find_path_* layout: path[0] is the hop into dst
+    for (int i = 0; i < len; i++) path[i] = hops[len - 1 - i];
+    *plen = len;
+    return 1;
+}
+
+// =====================
+// Background rebuild
+// =====================
+static void* ch_rebuild_thread(void* arg) {
+    RContractionHierarchy* ch = (RContractionHierarchy*)arg;
+
+    pthread_mutex_lock(&ch->lock);
+    while (ch->running) {
+        while (ch->running && !ch->dirty)
+            pthread_cond_wait(&ch->cond, &ch->lock);
+        if (!ch->running) break;
+        ch->dirty = 0;
+        pthread_mutex_unlock(&ch->lock);
+
+        ch_rebuild(ch);
+
+        pthread_mutex_lock(&ch->lock);
+    }
+    pthread_mutex_unlock(&ch->lock);
+    return NULL;
+}
+
+// =====================
+// Public API
+// =====================
+RContractionHierarchy* create_contraction_hierarchy(RNetwork* net) {
+    RContractionHierarchy* ch = (RContractionHierarchy*)malloc(sizeof(RContractionHierarchy));
+    ch->network = net;
+    ch->graph = NULL;
+    ch->dirty = 0;
+    ch->running = 1;
+    pthread_rwlock_init(&ch->graph_lock, NULL);
+    pthread_mutex_init(&ch->lock, NULL);
+    pthread_cond_init(&ch->cond, NULL);
+
+    ch_rebuild(ch);
+    net->ch = ch;
+
+    if (pthread_create(&ch->thread, NULL, ch_rebuild_thread, ch) != 0) {
+        ROC_ERROR("[CH] Failed to start rebuild thread; hierarchy will not auto-refresh.\n");
+        ch->running = 0;
+    }
+    return ch;
+}
+
+void destroy_contraction_hierarchy(RContractionHierarchy* ch) {
+    if (!ch) return;
+    if (ch->network && ch->network->ch == ch) ch->network->ch = NULL;
+
+    pthread_mutex_lock(&ch->lock);
+    int was_running = ch->running;
+    ch->running = 0;
+    pthread_cond_signal(&ch->cond);
+    pthread_mutex_unlock(&ch->lock);
+    if (was_running) pthread_join(ch->thread, NULL);
+
+    free_graph(ch->graph);
+    pthread_rwlock_destroy(&ch->graph_lock);
+    pthread_mutex_destroy(&ch->lock);
+    pthread_cond_destroy(&ch->cond);
+    free(ch);
+}
+
+int ch_rebuild(RContractionHierarchy* ch) {
+    CHGraph* g = build_graph(ch->network);
+    if (!g) return 0;
+
+    // Never replace a graph with one built from an older topology
+    pthread_rwlock_wrlock(&ch->graph_lock);
+    CHGraph* old = ch->graph;
+    if (old && (long)(g->version - old->version) < 0) {
+        old = g;
+    } else {
+        ch->graph = g;
+    }
+    pthread_rwlock_unlock(&ch->graph_lock);
+
+    free_graph(old);
+    return 1;
+}
+
+void ch_invalidate(RContractionHierarchy* ch) {
+    pthread_mutex_lock(&ch->lock);
+    ch->dirty = 1;
+    pthread_cond_signal(&ch->cond);
+    pthread_mutex_unlock(&ch->lock);
+}
+
+int ch_shortcut_count(RContractionHierarchy* ch) {
+    pthread_rwlock_rdlock(&ch->graph_lock);
+    int count = ch->graph ? ch->graph->shortcut_count : 0;
+    pthread_rwlock_unlock(&ch->graph_lock);
+    return count;
+}
+
+int find_path_ch(RContractionHierarchy* ch, RNode* src, RNode* dst, RLink** path, int* plen) {
+    pthread_rwlock_rdlock(&ch->graph_lock);
+    CHGraph* g = ch->graph;
+    // A graph older than the network may route over links that have since
+    // been disabled or removed, so let the caller search the live topology
+    int found = (g && g->version == atomic_load(&ch->network->version))
+              ? query(g, src, dst, path, plen) : -1;
+    pthread_rwlock_unlock(&ch->graph_lock);
+    return found;
+}
@@ -0,0 +1,341 @@
+#include "roc_clock.h"
+#include "roc_heap.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// =====================
+// Simulator state
+// =====================
+struct SimWaiter;
+
+typedef struct {
+    struct SimWaiter* waiter;
+    int cancelled;            // waiter was signalled before the event fired
+} SimEvent;
+
+typedef struct SimWaiter {
+    pthread_cond_t wake;
+    int woken;
+    int timed_out;
+    pthread_cond_t* cond;     // condition waited on, NULL for plain sleeps
+    SimEvent* event;          // pending timeout, NULL if none
+    struct SimWaiter* prev;
+    struct SimWaiter* next;
+} SimWaiter;
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int sim_virtual;
+static atomic_llong sim_now;
+static int sim_running;               // participants not blocked in the clock
+static RHeap sim_events;              // key = due time, data = SimEvent*
+static SimWaiter* waiters_head;       // condition waiters, FIFO
+static SimWaiter* waiters_tail;
+
+static _Thread_local int tls_registered;
+
+// =====================
+// Internal helpers (sim_lock held)
+// =====================
+static void unlink_waiter(SimWaiter* w) {
+    if (w->prev) w->prev->next = w->next; else waiters_head = w->next;
+    if (w->next) w->next->prev = w->prev; else waiters_tail = w->prev;
+    w->prev = w->next = NULL;
+}
+
+static void wake_waiter(SimWaiter* w, int timed_out) {
+    if (w->cond) unlink_waiter(w);
+    if (w->event) {
+        w->event->cancelled = 1;
+        w->event = NULL;
+    }
+    w->woken = 1;
+    w->timed_out = timed_out;
+    sim_running++;
+    pthread_cond_signal(&w->wake);
+}
+
+// Once every participant is blocked, jump to the earliest event and
+// release exactly one waiter; it runs until it blocks again.
+static void sim_advance(void) {
+    RHeapItem it;
+    while (sim_running <= 0 && heap_pop(&sim_events, &it)) {
+        SimEvent* ev = (SimEvent*)it.data;
+        if (ev->cancelled) {
+            free(ev);
+            continue;
+        }
+        SimWaiter* w = ev->waiter;
+        w->event = NULL;
+        free(ev);
+
+        if (it.key > atomic_load(&sim_now)) atomic_store(&sim_now, it.key);
+        wake_waiter(w, 1);
+    }
+}
+
+// Block the calling thread inside the simulator; returns 1 on timeout
+static int sim_block(pthread_cond_t* cond, long long deadline) {
+    SimWaiter w;
+    pthread_cond_init(&w.wake, NULL);
+    w.woken = 0;
+    w.timed_out = 0;
+    w.cond = cond;
+    w.event = NULL;
+    w.prev = w.next = NULL;
+
+    // Threads the clock does not know about count only while they wait
+    int temporary = !tls_registered;
+    if (temporary) sim_running++;
+
+    if (cond) {
+        w.prev = waiters_tail;
+        if (waiters_tail) waiters_tail->next = &w; else waiters_head = &w;
+        waiters_tail = &w;
+    }
+    if (deadline >= 0) {
+        SimEvent* ev = (SimEvent*)malloc(sizeof(SimEvent));
+        ev->waiter = &w;
+        ev->cancelled = 0;
+        w.event = ev;
+        heap_push(&sim_events, deadline, ev);
+    }
+
+    sim_running--;
+    sim_advance();
+    while (!w.woken)
+        pthread_cond_wait(&w.wake, &sim_lock);
+
+    if (temporary) {
+        sim_running--;
+        sim_advance();
+    }
+    pthread_cond_destroy(&w.wake);
+    return w.timed_out;
+}
+
+static void sim_wake_cond(pthread_cond_t* cond, int all) {
+    SimWaiter* w = waiters_head;
+    while (w) {
+        SimWaiter* next = w->next;
+        if (w->cond == cond) {
+            wake_waiter(w, 0);
+            if (!all) break;
+        }
+        w = next;
+    }
+}
+
+static long long real_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// =====================
+// Mode control
+// =====================
+void roc_clock_use_virtual(void) {
+    pthread_mutex_lock(&sim_lock);
+    if (!atomic_load(&sim_virtual)) {
+        atomic_store(&sim_now, 0);
+        atomic_store(&sim_virtual, 1);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    roc_clock_thread_enter();
+}
+
+void roc_clock_use_real(void) {
+    pthread_mutex_lock(&sim_lock);
+    atomic_store(&sim_virtual, 0);
+
+    // Nobody will advance virtual time any more: let every waiter go
+    RHeapItem it;
+    while (heap_pop(&sim_events, &it)) {
+        SimEvent* ev = (SimEvent*)it.data;
+        if (!ev->cancelled) {
+            ev->waiter->event = NULL;
+            wake_waiter(ev->waiter, 1);
+        }
+        free(ev);
+    }
+    while (waiters_head) wake_waiter(waiters_head, 0);
+    pthread_mutex_unlock(&sim_lock);
+}
+
+int roc_clock_is_virtual(void) {
+    return atomic_load(&sim_virtual);
+}
+
+// =====================
+// Time and sleeping
+// =====================
+long long roc_now_us(void) {
+    if (atomic_load(&sim_virtual)) return atomic_load(&sim_now);
+    return real_now_us();
+}
+
+long long roc_now_ms(void) {
+    return roc_now_us() / 1000;
+}
+
+void roc_sleep_us(long long us) {
+    if (us <= 0) return;
+
+    if (atomic_load(&sim_virtual)) {
+        pthread_mutex_lock(&sim_lock);
+        sim_block(NULL, atomic_load(&sim_now) + us);
+        pthread_mutex_unlock(&sim_lock);
+        return;
+    }
+
+#ifdef _WIN32
+    Sleep((DWORD)((us + 999) / 1000));
+#else
+    struct timespec ts = { (time_t)(us / 1000000LL), (long)((us % 1000000LL) * 1000) };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+#endif
+}
+
+void roc_sleep_ms(long long ms) {
+    roc_sleep_us(ms * 1000LL);
+}
+
+// =====================
+// Condition variables
+// =====================
+void roc_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    if (!atomic_load(&sim_virtual)) {
+        pthread_cond_wait(cond, mutex);
+        return;
+    }
+
+    // Register before dropping the caller's mutex so no signal is lost
+    pthread_mutex_lock(&sim_lock);
+    pthread_mutex_unlock(mutex);
+    sim_block(cond, -1);
+    pthread_mutex_unlock(&sim_lock);
+    pthread_mutex_lock(mutex);
+}
+
+int roc_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, long long deadline_us) {
+    if (!atomic_load(&sim_virtual)) {
+        long long remaining = deadline_us - real_now_us();
+        if (remaining < 0) remaining = 0;
+
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        long long abs_ns = (long long)ts.tv_nsec + (remaining % 1000000LL) * 1000LL;
+        ts.tv_sec += (time_t)(remaining / 1000000LL + abs_ns / 1000000000LL);
+        ts.tv_nsec = (long)(abs_ns % 1000000000LL);
+        return pthread_cond_timedwait(cond, mutex, &ts);
+    }
+
+    pthread_mutex_lock(&sim_lock);
+    pthread_mutex_unlock(mutex);
+    int timed_out = sim_block(cond, deadline_us);
+    pthread_mutex_unlock(&sim_lock);
+    pthread_mutex_lock(mutex);
+    return timed_out ? ETIMEDOUT : 0;
+}
+
+void roc_cond_signal(pthread_cond_t* cond) {
+    if (atomic_load(&sim_virtual)) {
+        pthread_mutex_lock(&sim_lock);
+        sim_wake_cond(cond, 0);
+        pthread_mutex_unlock(&sim_lock);
+    }
+    pthread_cond_signal(cond);
+}
+
+void roc_cond_broadcast(pthread_cond_t* cond) {
+    if (atomic_load(&sim_virtual)) {
+        pthread_mutex_lock(&sim_lock);
+        sim_wake_cond(cond, 1);
+        pthread_mutex_unlock(&sim_lock);
+    }
+    pthread_cond_broadcast(cond);
+}
+
+// =====================
+// Participating threads
+// =====================
+typedef struct {
+    void* (*func)(void*);
+    void* arg;
+} SpawnArgs;
+
+static void* spawn_trampoline(void* p) {
+    SpawnArgs args = *(SpawnArgs*)p;
+    free(p);
+
+    tls_registered = 1;   // already counted by the spawner
+    void* result = args.func(args.arg);
+    roc_clock_thread_leave();
+    return result;
+}
+
+int roc_thread_spawn(pthread_t* out, void* (*func)(void*), void* arg) {
+    SpawnArgs* args = (SpawnArgs*)malloc(sizeof(SpawnArgs));
+    args->func = func;
+    args->arg = arg;
+
+    // Count the thread before it exists so time cannot run ahead of it
+    pthread_mutex_lock(&sim_lock);
+    sim_running++;
+    pthread_mutex_unlock(&sim_lock);
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, spawn_trampoline, args) != 0) {
+        pthread_mutex_lock(&sim_lock);
+        sim_running--;
+        sim_advance();
+        pthread_mutex_unlock(&sim_lock);
+        free(args);
+        return 0;
+    }
+
+    if (out) *out = tid;
+    else pthread_detach(tid);
+    return 1;
+}
+
+int roc_thread_join(pthread_t thread) {
+    int registered = tls_registered;
+    if (registered) {
+        pthread_mutex_lock(&sim_lock);
+        sim_running--;
+        sim_advance();
+        pthread_mutex_unlock(&sim_lock);
+    }
+
+    int rc = pthread_join(thread, NULL);
+
+    if (registered) {
+        pthread_mutex_lock(&sim_lock);
+        sim_running++;
+        pthread_mutex_unlock(&sim_lock);
+    }
+    return rc == 0;
+}
+
+void roc_clock_thread_enter(void) {
+    if (tls_registered) return;
+    tls_registered = 1;
+    pthread_mutex_lock(&sim_lock);
+    sim_running++;
+    pthread_mutex_unlock(&sim_lock);
+}
+
+void roc_clock_thread_leave(void) {
+    if (!tls_registered) return;
+    tls_registered = 0;
+    pthread_mutex_lock(&sim_lock);
+    sim_running--;
+    sim_advance();
+    pthread_mutex_unlock(&sim_lock);
+}
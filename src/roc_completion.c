@@ -0,0 +1,31 @@
+#include "roc_completion.h"
+#include <stdlib.h>
+
+int completion_hook_add(RCompletionHook** list, CompletionFn fn, void* arg) {
+    RCompletionHook* hook = (RCompletionHook*)malloc(sizeof(RCompletionHook));
+    if (!hook) return 0;
+    hook->fn = fn;
+    hook->arg = arg;
+    hook->next = NULL;
+
+    while (*list) list = &(*list)->next;
+    *list = hook;
+    return 1;
+}
+
+void completion_hooks_run(RCompletionHook* list, void* source) {
+    while (list) {
+        RCompletionHook* next = list->next;
+        list->fn(source, list->arg);
+        free(list);
+        list = next;
+    }
+}
+
+void completion_hooks_free(RCompletionHook* list) {
+    while (list) {
+        RCompletionHook* next = list->next;
+        free(list);
+        list = next;
+    }
+}
@@ -0,0 +1,90 @@
+#include "roc_deque.h"
+#include <stdlib.h>
+
+// Follows Lê, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (PPoPP 2013).
+
+static RDequeArray* new_array(long size) {
+    RDequeArray* a = (RDequeArray*)malloc(sizeof(RDequeArray) + size * sizeof(_Atomic(void*)));
+    a->size = size;
+    a->retired = NULL;
+    return a;
+}
+
+void deque_init(RDeque* d, long initial_size) {
+    long size = 16;
+    while (size < initial_size) size <<= 1;
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    atomic_init(&d->array, new_array(size));
+}
+
+void deque_free(RDeque* d) {
+    RDequeArray* a = atomic_load(&d->array);
+    while (a) {
+        RDequeArray* older = a->retired;
+        free(a);
+        a = older;
+    }
+    atomic_store(&d->array, NULL);
+}
+
+static RDequeArray* grow(RDeque* d, RDequeArray* a, long top, long bottom) {
+    RDequeArray* bigger = new_array(a->size * 2);
+    for (long i = top; i < bottom; i++) {
+        void* item = atomic_load_explicit(&a->items[i & (a->size - 1)], memory_order_relaxed);
+        atomic_store_explicit(&bigger->items[i & (bigger->size - 1)], item, memory_order_relaxed);
+    }
+    bigger->retired = a;
+    atomic_store_explicit(&d->array, bigger, memory_order_release);
+    return bigger;
+}
+
+void deque_push(RDeque* d, void* item) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    RDequeArray* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    if (b - t > a->size - 1) a = grow(d, a, t, b);
+
+    atomic_store_explicit(&a->items[b & (a->size - 1)], item, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+}
+
+void* deque_take(RDeque* d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    RDequeArray* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        // Empty: undo the reservation
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return ROC_DEQUE_EMPTY;
+    }
+
+    void* item = atomic_load_explicit(&a->items[b & (a->size - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Last item: race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed))
+            item = ROC_DEQUE_EMPTY;
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return item;
+}
+
+void* deque_steal(RDeque* d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return ROC_DEQUE_EMPTY;
+
+    RDequeArray* a = atomic_load_explicit(&d->array, memory_order_acquire);
+    void* item = atomic_load_explicit(&a->items[t & (a->size - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+        return ROC_DEQUE_ABORT;
+    return item;
+}
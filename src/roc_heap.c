@@ -0,0 +1,122 @@
+#include "roc_heap.h"
+#include <stdlib.h>
+
+// =====================
+// Internal helpers
+// =====================
+static int item_less(const RHeapItem* a, const RHeapItem* b) {
+    if (a->key != b->key) return a->key < b->key;
+    return a->seq < b->seq;
+}
+
+static void sift_up(RHeap* heap, int i) {
+    RHeapItem item = heap->items[i];
+    while (i > 0) {
+        int parent = (i - 1) / ROC_HEAP_ARITY;
+        if (!item_less(&item, &heap->items[parent])) break;
+        heap->items[i] = heap->items[parent];
+        i = parent;
+    }
+    heap->items[i] = item;
+}
+
+static void sift_down(RHeap* heap, int i) {
+    RHeapItem item = heap->items[i];
+    for (;;) {
+        int first = i * ROC_HEAP_ARITY + 1;
+        if (first >= heap->count) break;
+
+        int best = first;
+        int last = first + ROC_HEAP_ARITY;
+        if (last > heap->count) last = heap->count;
+        for (int c = first + 1; c < last; c++) {
+            if (item_less(&heap->items[c], &heap->items[best])) best = c;
+        }
+
+        if (!item_less(&heap->items[best], &item)) break;
+        heap->items[i] = heap->items[best];
+        i = best;
+    }
+    heap->items[i] = item;
+}
+
+// =====================
+// Heap operations
+// =====================
+void heap_init(RHeap* heap) {
+    heap->items = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+    heap->next_seq = 0;
+}
+
+void heap_free(RHeap* heap) {
+    free(heap->items);
+    heap_init(heap);
+}
+
+void heap_clear(RHeap* heap) {
+    heap->count = 0;
+}
+
+static int reserve_slot(RHeap* heap) {
+    if (heap->count < heap->capacity) return 1;
+    int cap = heap->capacity ? heap->capacity * 2 : 16;
+    RHeapItem* items = realloc(heap->items, cap * sizeof(RHeapItem));
+    if (!items) return 0;
+    heap->items = items;
+    heap->capacity = cap;
+    return 1;
+}
+
+int heap_push(RHeap* heap, long long key, void* data) {
+    if (!reserve_slot(heap)) return 0;
+
+    RHeapItem* it = &heap->items[heap->count];
+    it->key = key;
+    it->seq = heap->next_seq++;
+    it->data = data;
+    sift_up(heap, heap->count++);
+    return 1;
+}
+
+int heap_push_item(RHeap* heap, const RHeapItem* item) {
+    if (!reserve_slot(heap)) return 0;
+    heap->items[heap->count] = *item;
+    sift_up(heap, heap->count++);
+    return 1;
+}
+
+int heap_pop(RHeap* heap, RHeapItem* out) {
+    if (heap->count == 0) return 0;
+    if (out) *out = heap->items[0];
+
+    heap->count--;
+    if (heap->count > 0) {
+        heap->items[0] = heap->items[heap->count];
+        sift_down(heap, 0);
+    }
+    return 1;
+}
+
+int heap_remove(RHeap* heap, void* data) {
+    int i = 0;
+    while (i < heap->count && heap->items[i].data != data) i++;
+    if (i == heap->count) return 0;
+
+    heap->count--;
+    if (i < heap->count) {
+        heap->items[i] = heap->items[heap->count];
+        sift_up(heap, i);
+        sift_down(heap, i);
+    }
+    return 1;
+}
+
+RHeapItem* heap_peek(RHeap* heap) {
+    return heap->count ? &heap->items[0] : NULL;
+}
+
+int heap_size(RHeap* heap) {
+    return heap->count;
+}
@@ -1,4 +1,5 @@
 #include "roc_job.h"
+#include "roc_clock.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,12 +10,19 @@ RJob* create_job(const char* name, int priority) {
     job->task_count = 0;
     job->priority = priority;
     job->status = JOB_PENDING;
+    job->gang = 0;
+    job->owner = -1;
+    job->pending = 0;
+    job->hooks = NULL;
     pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->done, NULL);
     return job;
 }
 
 void destroy_job(RJob* job) {
+    completion_hooks_free(job->hooks);
     pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->done);
     free(job);
 }
 
@@ -29,9 +37,20 @@ int job_add_task(RJob* job, RTask* task) {
     return 1;
 }
 
-// Helper to update job status
-static void update_job_status(RJob* job) {
+void job_set_gang(RJob* job, int gang) {
     pthread_mutex_lock(&job->lock);
+    job->gang = gang;
+    pthread_mutex_unlock(&job->lock);
+}
+
+void job_set_owner(RJob* job, int owner) {
+    pthread_mutex_lock(&job->lock);
+    job->owner = owner;
+    pthread_mutex_unlock(&job->lock);
+}
+
+// Derive the job status from its tasks; caller holds job->lock
+static void compute_job_status(RJob* job) {
     int all_completed = 1;
     int any_failed = 0;
 
@@ -44,22 +63,71 @@ static void update_job_status(RJob* job) {
     if (any_failed) job->status = JOB_FAILED;
     else if (all_completed) job->status = JOB_COMPLETED;
     else job->status = JOB_RUNNING;
+}
 
+// Helper to update job status
+static void update_job_status(RJob* job) {
+    pthread_mutex_lock(&job->lock);
+    compute_job_status(job);
     pthread_mutex_unlock(&job->lock);
 }
 
+// Completion callback on each task of a running job
+static void job_task_done(void* task, void* arg) {
+    (void)task;
+    RJob* job = (RJob*)arg;
+    RCompletionHook* hooks = NULL;
+
+    pthread_mutex_lock(&job->lock);
+    if (--job->pending == 0) {
+        compute_job_status(job);
+        hooks = job->hooks;
+        job->hooks = NULL;
+        roc_cond_broadcast(&job->done);
+    }
+    pthread_mutex_unlock(&job->lock);
+    completion_hooks_run(hooks, job);
+}
+
 int job_run(RJob* job, RTaskScheduler* sched) {
     pthread_mutex_lock(&job->lock);
-    if (job->task_count == 0) {
+    if (job->task_count == 0 || job->pending > 0) {
         pthread_mutex_unlock(&job->lock);
         return 0;
     }
 
     job->status = JOB_RUNNING;
+    job->pending = job->task_count;
+    int count = job->task_count;
+    int gang = job->gang;
+    RTask* tasks[MAX_TASKS_PER_JOB];
+    for (int i = 0; i < count; i++) {
+        tasks[i] = job->tasks[i];
+        if (job->owner >= 0) tasks[i]->owner = job->owner;
+    }
     pthread_mutex_unlock(&job->lock);
 
-    for (int i = 0; i < job->task_count; i++) {
-        scheduler_add_task(sched, job->tasks[i]);
+    // Once the last task is watched the job may finish and be freed
+    int watched = 1;
+    for (int i = 0; i < count; i++) {
+        if (!task_on_complete(tasks[i], job_task_done, job)) {
+            task_finish(tasks[i], TASK_FAILED);
+            job_task_done(tasks[i], job);
+            watched = 0;
+        }
+    }
+
+    if (gang) {
+        // A gang missing a task cannot start at all
+        if (!watched || !scheduler_add_gang(sched, tasks, count)) {
+            for (int i = 0; i < count; i++)
+                if (task_status(tasks[i]) == TASK_PENDING) task_finish(tasks[i], TASK_FAILED);
+        }
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (task_status(tasks[i]) == TASK_PENDING && !scheduler_add_task(sched, tasks[i]))
+            task_finish(tasks[i], TASK_FAILED);
     }
 
     // Return 1: successfully enqueued
@@ -73,3 +141,23 @@ JobStatus job_status(RJob* job) {
     pthread_mutex_unlock(&job->lock);
     return s;
 }
+
+JobStatus job_wait(RJob* job) {
+    pthread_mutex_lock(&job->lock);
+    while (job->pending > 0)
+        roc_cond_wait(&job->done, &job->lock);
+    pthread_mutex_unlock(&job->lock);
+    return job_status(job);
+}
+
+int job_on_complete(RJob* job, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&job->lock);
+    if (job->pending > 0) {
+        int ok = completion_hook_add(&job->hooks, fn, arg);
+        pthread_mutex_unlock(&job->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&job->lock);
+    fn(job, arg);
+    return 1;
+}
@@ -0,0 +1,153 @@
+#include "roc_linkq.h"
+#include "roc_clock.h"
+#include <stdlib.h>
+
+typedef struct {
+    LinkGrantFn grant;
+    void* arg;
+    long long tag;
+} LinkWaiter;
+
+// =====================
+// Internal helpers
+// =====================
+static int clamp_class(int priority) {
+    if (priority < 0) return 0;
+    if (priority >= LINKQ_CLASSES) return LINKQ_CLASSES - 1;
+    return priority;
+}
+
+// Self-clocked fair queueing: a chunk finishes size/weight after the later of
+// the chunk in service and its class's previous chunk
+static long long wfq_tag(RLinkQueue* q, int priority, int size) {
+    int c = clamp_class(priority);
+    long long start = q->vtime > q->last_finish[c] ? q->vtime : q->last_finish[c];
+    long long tag = start + ((long long)size * 1000LL) / (c + 1);
+    q->last_finish[c] = tag;
+    return tag;
+}
+
+// =====================
+// Queue API
+// =====================
+RLinkQueue* create_link_queue(void) {
+    RLinkQueue* q = (RLinkQueue*)malloc(sizeof(RLinkQueue));
+    pthread_mutex_init(&q->lock, NULL);
+    q->mode = LINKQ_STRICT;
+    q->busy = 0;
+    heap_init(&q->waiting);
+    q->vtime = 0;
+    for (int i = 0; i < LINKQ_CLASSES; i++) q->last_finish[i] = 0;
+    return q;
+}
+
+void destroy_link_queue(RLinkQueue* q) {
+    if (!q) return;
+    RHeapItem it;
+    while (heap_pop(&q->waiting, &it)) free(it.data);
+    heap_free(&q->waiting);
+    pthread_mutex_destroy(&q->lock);
+    free(q);
+}
+
+void linkq_set_mode(RLinkQueue* q, LinkQueueMode mode) {
+    pthread_mutex_lock(&q->lock);
+    q->mode = mode;
+    pthread_mutex_unlock(&q->lock);
+}
+
+int linkq_acquire(RLinkQueue* q, int priority, int size, LinkGrantFn grant, void* arg) {
+    pthread_mutex_lock(&q->lock);
+    long long tag = (q->mode == LINKQ_WFQ) ? wfq_tag(q, priority, size) : -(long long)priority;
+
+    if (!q->busy) {
+        q->busy = 1;
+        if (q->mode == LINKQ_WFQ) q->vtime = tag;
+        pthread_mutex_unlock(&q->lock);
+        return 1;
+    }
+
+    LinkWaiter* w = (LinkWaiter*)malloc(sizeof(LinkWaiter));
+    w->grant = grant;
+    w->arg = arg;
+    w->tag = tag;
+    heap_push(&q->waiting, tag, w);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+void linkq_release(RLinkQueue* q) {
+    RHeapItem it;
+
+    pthread_mutex_lock(&q->lock);
+    if (!heap_pop(&q->waiting, &it)) {
+        q->busy = 0;
+        pthread_mutex_unlock(&q->lock);
+        return;
+    }
+    LinkWaiter* w = (LinkWaiter*)it.data;
+    if (q->mode == LINKQ_WFQ) q->vtime = w->tag;
+    pthread_mutex_unlock(&q->lock);
+
+    // The wire stays busy: ownership passes straight to the waiter
+    w->grant(w->arg);
+    free(w);
+}
+
+int linkq_cancel(RLinkQueue* q, LinkGrantFn grant, void* arg) {
+    pthread_mutex_lock(&q->lock);
+    LinkWaiter* found = NULL;
+    for (int i = 0; i < q->waiting.count; i++) {
+        LinkWaiter* w = (LinkWaiter*)q->waiting.items[i].data;
+        if (w->grant == grant && w->arg == arg) {
+            found = w;
+            break;
+        }
+    }
+    if (found) heap_remove(&q->waiting, found);
+    pthread_mutex_unlock(&q->lock);
+
+    free(found);
+    return found != NULL;
+}
+
+int linkq_waiting(RLinkQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    int n = heap_size(&q->waiting);
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+// =====================
+// Blocking acquire
+// =====================
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int granted;
+} SyncGrant;
+
+static void sync_grant(void* arg) {
+    SyncGrant* g = (SyncGrant*)arg;
+    pthread_mutex_lock(&g->lock);
+    g->granted = 1;
+    roc_cond_signal(&g->cond);
+    pthread_mutex_unlock(&g->lock);
+}
+
+void linkq_acquire_wait(RLinkQueue* q, int priority, int size) {
+    SyncGrant g;
+    pthread_mutex_init(&g.lock, NULL);
+    pthread_cond_init(&g.cond, NULL);
+    g.granted = 0;
+
+    if (!linkq_acquire(q, priority, size, sync_grant, &g)) {
+        pthread_mutex_lock(&g.lock);
+        while (!g.granted)
+            roc_cond_wait(&g.cond, &g.lock);
+        pthread_mutex_unlock(&g.lock);
+    }
+
+    pthread_mutex_destroy(&g.lock);
+    pthread_cond_destroy(&g.cond);
+}
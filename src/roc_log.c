@@ -0,0 +1,153 @@
+#include "roc_log.h"
+#include "roc_mpsc.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+typedef struct {
+    RMpscNode node;          // first member: a popped node is the record
+    char msg[ROC_LOG_MSG_MAX];
+} LogRecord;
+
+atomic_int roc_log_runtime_level = ROC_LEVEL_WARN;
+
+static const char* level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+static RMpscQueue queue;
+static atomic_long pending;           // pushed but not yet written
+static _Atomic(FILE*) output;
+
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+static pthread_t writer;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+static atomic_int sleeping;           // writer is (about to be) parked on wake_cond
+static int writer_running;
+static atomic_int writer_stopped;     // after exit: write synchronously
+
+// =====================
+// Writer thread
+// =====================
+static FILE* current_output(void) {
+    FILE* out = atomic_load(&output);
+    return out ? out : stdout;
+}
+
+static void drain(void) {
+    FILE* out = current_output();
+    long written = 0;
+    RMpscNode* n;
+    while ((n = mpsc_pop(&queue)) != NULL) {
+        LogRecord* r = (LogRecord*)n;
+        fputs(r->msg, out);
+        free(r);
+        written++;
+    }
+    if (written) {
+        fflush(out);
+        atomic_fetch_sub(&pending, written);
+    }
+}
+
+// Plain pthread on wall-clock time: the writer is not part of the simulation
+static void* writer_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&wake_lock);
+    for (;;) {
+        pthread_mutex_unlock(&wake_lock);
+        drain();
+        pthread_mutex_lock(&wake_lock);
+
+        if (atomic_load(&pending) == 0) {
+            pthread_cond_broadcast(&idle_cond);
+            if (!writer_running) break;
+
+            // Publish the flag before the final check; producers read it after pushing
+            atomic_store(&sleeping, 1);
+            if (atomic_load(&pending) == 0)
+                pthread_cond_wait(&wake_cond, &wake_lock);
+            atomic_store(&sleeping, 0);
+        }
+    }
+    pthread_mutex_unlock(&wake_lock);
+    return NULL;
+}
+
+static void stop_writer(void) {
+    pthread_mutex_lock(&wake_lock);
+    writer_running = 0;
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+    pthread_join(writer, NULL);
+    atomic_store(&writer_stopped, 1);
+    drain();   // records that raced with the shutdown
+}
+
+static void start_writer(void) {
+    mpsc_init(&queue);
+    writer_running = 1;
+    if (pthread_create(&writer, NULL, writer_thread, NULL) != 0) {
+        atomic_store(&writer_stopped, 1);
+        return;
+    }
+    atexit(stop_writer);
+}
+
+// =====================
+// Logging API
+// =====================
+void roc_log_write(int level, const char* fmt, ...) {
+    if (level < atomic_load(&roc_log_runtime_level) || level < ROC_LEVEL_DEBUG || level >= ROC_LEVEL_OFF)
+        return;
+    pthread_once(&start_once, start_writer);
+
+    LogRecord* r = (LogRecord*)malloc(sizeof(LogRecord));
+    int n = snprintf(r->msg, sizeof(r->msg), "[%s] ", level_names[level]);
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(r->msg + n, sizeof(r->msg) - n, fmt, ap);
+    va_end(ap);
+
+    if (atomic_load(&writer_stopped)) {
+        fputs(r->msg, current_output());
+        free(r);
+        return;
+    }
+
+    atomic_fetch_add(&pending, 1);
+    mpsc_push(&queue, &r->node);
+    if (atomic_load(&sleeping)) {
+        pthread_mutex_lock(&wake_lock);
+        pthread_cond_signal(&wake_cond);
+        pthread_mutex_unlock(&wake_lock);
+    }
+}
+
+void roc_log_set_level(int level) {
+    atomic_store(&roc_log_runtime_level, level);
+}
+
+int roc_log_level(void) {
+    return atomic_load(&roc_log_runtime_level);
+}
+
+void roc_log_set_output(FILE* out) {
+    roc_log_flush();
+    atomic_store(&output, out);
+}
+
+void roc_log_flush(void) {
+    if (atomic_load(&writer_stopped)) {
+        fflush(current_output());
+        return;
+    }
+    pthread_mutex_lock(&wake_lock);
+    while (atomic_load(&pending) > 0 && !atomic_load(&writer_stopped)) {
+        pthread_cond_signal(&wake_cond);
+        pthread_cond_wait(&idle_cond, &wake_lock);
+    }
+    pthread_mutex_unlock(&wake_lock);
+}
@@ -0,0 +1,237 @@
+#include "roc_migration.h"
+#include "roc_clock.h"
+#include "roc_trace.h"
+#include "roc_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// =====================
+// Internal helpers
+// =====================
+static void migration_unref(RMigration* m) {
+    if (atomic_fetch_sub(&m->refs, 1) != 1) return;
+    pthread_mutex_destroy(&m->lock);
+    pthread_cond_destroy(&m->done);
+    free(m);
+}
+
+static double throughput(int moved, long long started_us, long long now_us) {
+    long long elapsed = now_us - started_us;
+    return elapsed > 0 ? (double)moved * 1000000.0 / (double)elapsed : 0.0;
+}
+
+static void finish(RMigration* m, MigrationStatus status) {
+    pthread_mutex_lock(&m->lock);
+    m->status = status;
+    m->finished_us = roc_now_us();
+    roc_cond_broadcast(&m->done);
+    pthread_mutex_unlock(&m->lock);
+
+    if (m->on_done) m->on_done(m, m->arg);
+    migration_unref(m);
+}
+
+// Claim on the target, carry, then free on the source. A chunk that cannot
+// cross is re-routed once before the migration gives up.
+static int move_chunk(RMigrationEngine* engine, RMigration* m, int size, RLink** path, int* plen) {
+    if (!reserve(m->to, size)) {
+        ROC_WARN("[Migration] %s has no room for %d more units\n", m->to->name, size);
+        return 0;
+    }
+
+    RoutePolicy policy = atomic_load(&engine->ctrl->policy);
+    // Bulk traffic: lowest link priority, so urgent packets overtake it
+    RPacket pkt = { .src = m->from, .dst = m->to, .amount = size, .type = 0, .priority = 0 };
+    int ok = carry_packet(m->from, path, *plen, &pkt, policy, 0);
+    if (!ok && controller_route(engine->ctrl, m->from, m->to, size, path, plen))
+        ok = carry_packet(m->from, path, *plen, &pkt, policy, 0);
+
+    if (!ok) {
+        release(m->to, size);
+        return 0;
+    }
+    release(m->from, size);
+    return 1;
+}
+
+static void run_migration(RMigrationEngine* engine, RMigration* m) {
+    RLink* path[MAX_PATH_LEN];
+    int plen = 0;
+    if (!controller_route(engine->ctrl, m->from, m->to, m->amount, path, &plen)) {
+        ROC_WARN("[Migration] No route from %s to %s\n", m->from->name, m->to->name);
+        finish(m, MIGRATION_FAILED);
+        return;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    m->status = MIGRATION_RUNNING;
+    m->started_us = roc_now_us();
+    pthread_mutex_unlock(&m->lock);
+    ROC_TRACE_EVENT(TRACE_MIGRATE_START, m->from->id, m->to->id, -1, m->amount);
+
+    while (m->moved < m->amount) {
+        int size = m->amount - m->moved;
+        if (size > m->chunk) size = m->chunk;
+        if (!move_chunk(engine, m, size, path, &plen)) {
+            finish(m, MIGRATION_FAILED);
+            return;
+        }
+
+        pthread_mutex_lock(&m->lock);
+        m->moved += size;
+        int moved = m->moved;
+        pthread_mutex_unlock(&m->lock);
+        atomic_fetch_add(&engine->total_moved, size);
+        ROC_TRACE_EVENT(TRACE_MIGRATE_CHUNK, m->from->id, m->to->id, -1, size);
+
+        if (m->on_progress)
+            m->on_progress(m, moved, m->amount, throughput(moved, m->started_us, roc_now_us()), m->arg);
+    }
+    ROC_TRACE_EVENT(TRACE_MIGRATE_END, m->from->id, m->to->id, -1, m->amount);
+    finish(m, MIGRATION_COMPLETED);
+}
+
+static void* migration_thread(void* arg) {
+    RMigrationEngine* engine = (RMigrationEngine*)arg;
+
+    // Once the engine stops, queued migrations are failed here rather than
+    // by destroy, so their callbacks still run on an engine thread
+    pthread_mutex_lock(&engine->lock);
+    for (;;) {
+        RMigration* m = engine->head;
+        if (!m) {
+            if (!engine->running) break;
+            roc_cond_wait(&engine->cond, &engine->lock);
+            continue;
+        }
+        engine->head = m->next;
+        if (!engine->head) engine->tail = NULL;
+        int running = engine->running;
+        pthread_mutex_unlock(&engine->lock);
+
+        if (running) run_migration(engine, m);
+        else finish(m, MIGRATION_FAILED);
+
+        pthread_mutex_lock(&engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return NULL;
+}
+
+// =====================
+// Engine API
+// =====================
+RMigrationEngine* create_migration_engine(RController* ctrl, int max_concurrent) {
+    if (max_concurrent <= 0) max_concurrent = MIGRATION_DEFAULT_CONCURRENCY;
+
+    RMigrationEngine* engine = (RMigrationEngine*)malloc(sizeof(RMigrationEngine));
+    engine->ctrl = ctrl;
+    engine->head = engine->tail = NULL;
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->cond, NULL);
+    atomic_init(&engine->total_moved, 0);
+    engine->running = 1;
+    engine->thread_count = 0;
+    engine->threads = malloc(max_concurrent * sizeof(pthread_t));
+
+    for (int i = 0; i < max_concurrent; i++) {
+        if (roc_thread_spawn(&engine->threads[engine->thread_count], migration_thread, engine))
+            engine->thread_count++;
+    }
+    return engine;
+}
+
+void destroy_migration_engine(RMigrationEngine* engine) {
+    if (!engine) return;
+
+    // Running migrations finish their current work; queued ones never start
+    pthread_mutex_lock(&engine->lock);
+    engine->running = 0;
+    roc_cond_broadcast(&engine->cond);
+    pthread_mutex_unlock(&engine->lock);
+
+    for (int i = 0; i < engine->thread_count; i++)
+        roc_thread_join(engine->threads[i]);
+
+    // Only left over when no engine thread could be started
+    while (engine->head) {
+        RMigration* next = engine->head->next;
+        finish(engine->head, MIGRATION_FAILED);
+        engine->head = next;
+    }
+
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->cond);
+    free(engine->threads);
+    free(engine);
+}
+
+RMigration* migration_submit(RMigrationEngine* engine, RNode* from, RNode* to, int amount, int chunk,
+                             MigrationProgressFn on_progress, MigrationDoneFn on_done, void* arg) {
+    if (from == to || amount <= 0) return NULL;
+
+    if (chunk <= 0) chunk = atomic_load(&engine->ctrl->chunk_size);
+    if (chunk <= 0) chunk = MIGRATION_DEFAULT_CHUNK;
+
+    RMigration* m = (RMigration*)malloc(sizeof(RMigration));
+    m->from = from;
+    m->to = to;
+    m->amount = amount;
+    m->chunk = chunk;
+    m->moved = 0;
+    m->status = MIGRATION_PENDING;
+    m->started_us = 0;
+    m->finished_us = 0;
+    m->on_progress = on_progress;
+    m->on_done = on_done;
+    m->arg = arg;
+    m->next = NULL;
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->done, NULL);
+    atomic_init(&m->refs, 2);
+
+    pthread_mutex_lock(&engine->lock);
+    if (engine->tail) engine->tail->next = m; else engine->head = m;
+    engine->tail = m;
+    roc_cond_signal(&engine->cond);
+    pthread_mutex_unlock(&engine->lock);
+    return m;
+}
+
+MigrationStatus migration_poll(RMigration* m) {
+    pthread_mutex_lock(&m->lock);
+    MigrationStatus s = m->status;
+    pthread_mutex_unlock(&m->lock);
+    return s;
+}
+
+MigrationStatus migration_wait(RMigration* m) {
+    pthread_mutex_lock(&m->lock);
+    while (m->status == MIGRATION_PENDING || m->status == MIGRATION_RUNNING)
+        roc_cond_wait(&m->done, &m->lock);
+    MigrationStatus s = m->status;
+    pthread_mutex_unlock(&m->lock);
+    return s;
+}
+
+int migration_moved(RMigration* m) {
+    pthread_mutex_lock(&m->lock);
+    int moved = m->moved;
+    pthread_mutex_unlock(&m->lock);
+    return moved;
+}
+
+double migration_throughput(RMigration* m) {
+    pthread_mutex_lock(&m->lock);
+    int moved = m->moved;
+    long long started = m->started_us;
+    long long end = (m->status == MIGRATION_COMPLETED || m->status == MIGRATION_FAILED)
+                    ? m->finished_us : roc_now_us();
+    MigrationStatus s = m->status;
+    pthread_mutex_unlock(&m->lock);
+    return (s == MIGRATION_PENDING) ? 0.0 : throughput(moved, started, end);
+}
+
+void migration_release(RMigration* m) {
+    if (m) migration_unref(m);
+}
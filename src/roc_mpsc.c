@@ -0,0 +1,51 @@
+#include "roc_mpsc.h"
+#include <stddef.h>
+
+void mpsc_init(RMpscQueue* q) {
+    atomic_init(&q->stub.next, NULL);
+    atomic_init(&q->head, &q->stub);
+    q->tail = &q->stub;
+}
+
+int mpsc_push(RMpscQueue* q, RMpscNode* node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    RMpscNode* prev = atomic_exchange(&q->head, node);
+    // Until this store lands the consumer cannot see node (or anything after it)
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+    return prev == &q->stub;
+}
+
+RMpscNode* mpsc_pop(RMpscQueue* q) {
+    RMpscNode* tail = q->tail;
+    RMpscNode* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    // Step over the stub
+    if (tail == &q->stub) {
+        if (!next) return NULL;
+        q->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+
+    // tail is the last linked node; a producer may be mid-push behind it
+    if (tail != atomic_load_explicit(&q->head, memory_order_acquire)) return NULL;
+
+    // Re-insert the stub so tail can be handed out
+    mpsc_push(q, &q->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+// Nothing queued after the stub and nobody swapped in a new head
+int mpsc_empty(RMpscQueue* q) {
+    return q->tail == &q->stub && atomic_load(&q->head) == &q->stub;
+}
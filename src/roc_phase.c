@@ -1,9 +1,9 @@
 #include "roc_phase.h"
-#include "roc_phase.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <windows.h> // for Sleep
+#include "roc_clock.h"
+#include "roc_log.h"
 
 RPhase* create_phase(const char* name, int priority) {
     RPhase* phase = (RPhase*)malloc(sizeof(RPhase));
@@ -11,10 +11,16 @@ RPhase* create_phase(const char* name, int priority) {
     phase->stage_count = 0;
     phase->priority = priority;
     phase->status = PHASE_PENDING;
+    phase->hooks = NULL;
+    pthread_mutex_init(&phase->lock, NULL);
+    pthread_cond_init(&phase->done, NULL);
     return phase;
 }
 
 void destroy_phase(RPhase* phase) {
+    completion_hooks_free(phase->hooks);
+    pthread_mutex_destroy(&phase->lock);
+    pthread_cond_destroy(&phase->done);
     free(phase);
 }
 
@@ -37,39 +43,64 @@ int phase_add_stage(RPhase* phase, RStage* stage) {
     return 1;
 }
 
-static void* run_phase_thread(void* arg) {
-    struct { RPhase* phase; RTaskScheduler* sched; }* data = arg;
-    RPhase* phase = data->phase;
-    RTaskScheduler* sched = data->sched;
-    free(data);
-
-    phase->status = PHASE_RUNNING;
-
-    for (int i = 0; i < phase->stage_count; i++) {
-        stage_run(phase->stages[i], sched);
-        while (stage_status(phase->stages[i]) != STAGE_COMPLETED) {
-            Sleep(50);
-        }
-    }
-
-    phase->status = PHASE_COMPLETED;
-    printf("[Phase] Phase '%s' completed\n", phase->name);
-    return NULL;
+// Publish the final status, then wake waiters and run callbacks
+static void finish_phase(RPhase* phase, PhaseStatus status) {
+    pthread_mutex_lock(&phase->lock);
+    phase->status = status;
+    RCompletionHook* hooks = phase->hooks;
+    phase->hooks = NULL;
+    roc_cond_broadcast(&phase->done);
+    pthread_mutex_unlock(&phase->lock);
+    completion_hooks_run(hooks, phase);
 }
 
 int phase_run(RPhase* phase, RTaskScheduler* sched) {
     if (!phase || !sched) return -1;
+
+    pthread_mutex_lock(&phase->lock);
+    if (phase->status == PHASE_RUNNING) {
+        pthread_mutex_unlock(&phase->lock);
+        return -1;
+    }
     phase->status = PHASE_RUNNING;
+    pthread_mutex_unlock(&phase->lock);
+
     for (int i = 0; i < phase->stage_count; i++) {
         stage_run(phase->stages[i], sched);
-        while (stage_status(phase->stages[i]) != STAGE_COMPLETED) {
-            Sleep(50); // wait
+        if (stage_wait(phase->stages[i]) != STAGE_COMPLETED) {
+            ROC_WARN("[Phase] Phase '%s' failed at stage '%s'\n", phase->name, phase->stages[i]->name);
+            finish_phase(phase, PHASE_FAILED);
+            return -1;
         }
     }
-    phase->status = PHASE_COMPLETED;
+    finish_phase(phase, PHASE_COMPLETED);
     return 0;
 }
 
 PhaseStatus phase_status(RPhase* phase) {
-    return phase->status;
+    pthread_mutex_lock(&phase->lock);
+    PhaseStatus s = phase->status;
+    pthread_mutex_unlock(&phase->lock);
+    return s;
+}
+
+PhaseStatus phase_wait(RPhase* phase) {
+    pthread_mutex_lock(&phase->lock);
+    while (phase->status == PHASE_RUNNING)
+        roc_cond_wait(&phase->done, &phase->lock);
+    PhaseStatus s = phase->status;
+    pthread_mutex_unlock(&phase->lock);
+    return s;
+}
+
+int phase_on_complete(RPhase* phase, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&phase->lock);
+    if (phase->status == PHASE_RUNNING) {
+        int ok = completion_hook_add(&phase->hooks, fn, arg);
+        pthread_mutex_unlock(&phase->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&phase->lock);
+    fn(phase, arg);
+    return 1;
 }
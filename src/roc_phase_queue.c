@@ -3,7 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h> // for usleep
+#include "roc_log.h"
 
 RPhaseQueue* create_phase_queue(const char* name) {
     RPhaseQueue* queue = (RPhaseQueue*)malloc(sizeof(RPhaseQueue));
@@ -30,16 +30,14 @@ int phase_queue_add(RPhaseQueue* queue, RPhase* phase) {
 
 int phase_queue_run(RPhaseQueue* queue, RTaskScheduler* sched) {
     if (!queue || !sched) return -1;
-    printf("=== Running phases in queue '%s' ===\n", queue->name);
+    ROC_INFO("=== Running phases in queue '%s' ===\n", queue->name);
     for (int i = 0; i < queue->phase_count; i++) {
-        printf("[PhaseQueue] Starting phase '%s'\n", queue->phases[i]->name);
+        ROC_INFO("[PhaseQueue] Starting phase '%s'\n", queue->phases[i]->name);
         phase_run(queue->phases[i], sched);
-        while (phase_status(queue->phases[i]) != PHASE_COMPLETED) {
-            usleep(50000);
-        }
-        printf("[PhaseQueue] Phase '%s' completed\n", queue->phases[i]->name);
+        phase_wait(queue->phases[i]);
+        ROC_INFO("[PhaseQueue] Phase '%s' completed\n", queue->phases[i]->name);
     }
-    printf("[PhaseQueue] All phases in queue '%s' completed\n", queue->name);
+    ROC_INFO("[PhaseQueue] All phases in queue '%s' completed\n", queue->name);
     return 0;
 }
 
@@ -2,7 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#include "roc_clock.h"
+#include "roc_log.h"
 
 // Create a new pipe
 RPipe* create_pipe(const char* name, int priority) {
@@ -11,13 +12,17 @@ RPipe* create_pipe(const char* name, int priority) {
     pipe->task_count = 0;
     pipe->priority = priority;
     pipe->status = PIPE_PENDING;
+    pipe->hooks = NULL;
     pthread_mutex_init(&pipe->lock, NULL);
+    pthread_cond_init(&pipe->done, NULL);
     return pipe;
 }
 
 // Destroy a pipe
 void destroy_pipe(RPipe* pipe) {
+    completion_hooks_free(pipe->hooks);
     pthread_mutex_destroy(&pipe->lock);
+    pthread_cond_destroy(&pipe->done);
     free(pipe);
 }
 
@@ -33,43 +38,49 @@ int pipe_add_task(RPipe* pipe, RTask* task) {
     return 1;
 }
 
+// Publish the final status, then wake waiters and run callbacks
+static void finish_pipe(RPipe* pipe, PipeStatus status) {
+    pthread_mutex_lock(&pipe->lock);
+    pipe->status = status;
+    RCompletionHook* hooks = pipe->hooks;
+    pipe->hooks = NULL;
+    roc_cond_broadcast(&pipe->done);
+    pthread_mutex_unlock(&pipe->lock);
+    completion_hooks_run(hooks, pipe);
+}
+
 // Internal thread function to run tasks sequentially
 static void* run_pipe_thread(void* arg) {
     RPipe* pipe = (RPipe*)arg;
 
-    pthread_mutex_lock(&pipe->lock);
-    pipe->status = PIPE_RUNNING;
-    pthread_mutex_unlock(&pipe->lock);
-
     for (int i = 0; i < pipe->task_count; i++) {
-        if (!run_task(pipe->tasks[i])) {
-            pthread_mutex_lock(&pipe->lock);
-            pipe->status = PIPE_FAILED;
-            pthread_mutex_unlock(&pipe->lock);
-            return NULL;
-        }
-
         // Wait for the task to complete before continuing
-        while (task_status(pipe->tasks[i]) != TASK_COMPLETED) {
-            usleep(50000);
+        if (!run_task(pipe->tasks[i]) || task_wait(pipe->tasks[i]) != TASK_COMPLETED) {
+            ROC_WARN("[Pipe] Pipe '%s' failed at task '%s'\n", pipe->name, pipe->tasks[i]->name);
+            finish_pipe(pipe, PIPE_FAILED);
+            return NULL;
         }
     }
 
-    pthread_mutex_lock(&pipe->lock);
-    pipe->status = PIPE_COMPLETED;
-    pthread_mutex_unlock(&pipe->lock);
-
-    printf("[Pipe] Pipe '%s' completed\n", pipe->name);
+    ROC_INFO("[Pipe] Pipe '%s' completed\n", pipe->name);
+    finish_pipe(pipe, PIPE_COMPLETED);
     return NULL;
 }
 
 // Run the pipe asynchronously
 int pipe_run(RPipe* pipe, RTaskScheduler* sched) {
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, run_pipe_thread, pipe) != 0)
+    pthread_mutex_lock(&pipe->lock);
+    if (pipe->status == PIPE_RUNNING) {
+        pthread_mutex_unlock(&pipe->lock);
         return 0;
+    }
+    pipe->status = PIPE_RUNNING;
+    pthread_mutex_unlock(&pipe->lock);
 
-    pthread_detach(thread);
+    if (!roc_thread_spawn(NULL, run_pipe_thread, pipe)) { // detached
+        finish_pipe(pipe, PIPE_FAILED);
+        return 0;
+    }
     return 1;
 }
 
@@ -80,3 +91,24 @@ PipeStatus pipe_status(RPipe* pipe) {
     pthread_mutex_unlock(&pipe->lock);
     return s;
 }
+
+PipeStatus pipe_wait(RPipe* pipe) {
+    pthread_mutex_lock(&pipe->lock);
+    while (pipe->status == PIPE_RUNNING)
+        roc_cond_wait(&pipe->done, &pipe->lock);
+    PipeStatus s = pipe->status;
+    pthread_mutex_unlock(&pipe->lock);
+    return s;
+}
+
+int pipe_on_complete(RPipe* pipe, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&pipe->lock);
+    if (pipe->status == PIPE_RUNNING) {
+        int ok = completion_hook_add(&pipe->hooks, fn, arg);
+        pthread_mutex_unlock(&pipe->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&pipe->lock);
+    fn(pipe, arg);
+    return 1;
+}
@@ -3,7 +3,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#include "roc_clock.h"
+#include "roc_log.h"
 #include <pthread.h>
 
 // =====================
@@ -47,10 +48,8 @@ void run_pipe_queue_priority(RPipeQueue* queue, RTaskScheduler* sched) {
 
     for (int i = 0; i < queue->pipe_count; i++) {
         pipe_run(queue->pipes[i], sched);
-        while (pipe_status(queue->pipes[i]) != PIPE_COMPLETED) {
-            usleep(50000);
-        }
-        printf("[Queue] Pipe '%s' completed\n", queue->pipes[i]->name);
+        pipe_wait(queue->pipes[i]);
+        ROC_INFO("[Queue] Pipe '%s' completed\n", queue->pipes[i]->name);
     }
 }
 
@@ -68,16 +67,14 @@ static void* run_pipe_queue_thread(void* arg) {
         pipe_run(queue->pipes[i], NULL); // NULL scheduler will just enqueue tasks in the default way
 
         // Wait for pipe to complete
-        while (pipe_status(queue->pipes[i]) != PIPE_COMPLETED) {
-            usleep(50000);
-        }
+        pipe_wait(queue->pipes[i]);
     }
 
     pthread_mutex_lock(&queue->lock);
     queue->status = PIPEQUEUE_COMPLETED;
     pthread_mutex_unlock(&queue->lock);
 
-    printf("[Main] All pipes in queue '%s' completed\n", queue->name);
+    ROC_INFO("[Main] All pipes in queue '%s' completed\n", queue->name);
     return NULL;
 }
 
@@ -85,12 +82,7 @@ static void* run_pipe_queue_thread(void* arg) {
 // Public execution functions
 // =====================
 int pipe_queue_run(RPipeQueue* queue, RTaskScheduler* sched) {
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, run_pipe_queue_thread, queue) != 0) {
-        return 0;
-    }
-    pthread_detach(thread);
-    return 1;
+    return roc_thread_spawn(NULL, run_pipe_queue_thread, queue); // detached
 }
 
 PipeQueueStatus pipe_queue_status(RPipeQueue* queue) {
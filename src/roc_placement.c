@@ -0,0 +1,542 @@
+#include "roc_placement.h"
+#include "roc_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+typedef struct PlaceEntry {
+    RNode* node;
+    int type;            // index in RPlacement::types
+    int avail;           // key: units believed free, less pending
+    int pending;         // units chosen by placements not yet reserved
+    unsigned prio;       // treap heap order
+    int left, right;     // entry indices, -1 = none
+    int min_id;          // smallest entry index in the subtree
+    int in_tree;         // 0 while set aside by a group search
+    int host_next;       // next entry on the same host; itself when alone
+    RMpscNode stale;
+    atomic_int queued;   // on the stale queue
+} PlaceEntry;
+
+typedef struct PlaceIndex {
+    char type[20];
+    int root;
+    int max_capacity;
+} PlaceIndex;
+
+// =====================
+// Treap keyed by (avail, index)
+// =====================
+static int key_less(PlaceEntry* E, int a, int b) {
+    return E[a].avail < E[b].avail || (E[a].avail == E[b].avail && a < b);
+}
+
+static void pull(PlaceEntry* E, int t) {
+    int m = t;
+    if (E[t].left >= 0 && E[E[t].left].min_id < m) m = E[E[t].left].min_id;
+    if (E[t].right >= 0 && E[E[t].right].min_id < m) m = E[E[t].right].min_id;
+    E[t].min_id = m;
+}
+
+// l gets the keys below e's, r the rest
+static void split(PlaceEntry* E, int t, int e, int* l, int* r) {
+    if (t < 0) {
+        *l = *r = -1;
+    } else if (key_less(E, t, e)) {
+        split(E, E[t].right, e, &E[t].right, r);
+        *l = t;
+        pull(E, t);
+    } else {
+        split(E, E[t].left, e, l, &E[t].left);
+        *r = t;
+        pull(E, t);
+    }
+}
+
+static int merge(PlaceEntry* E, int a, int b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (E[a].prio > E[b].prio) {
+        E[a].right = merge(E, E[a].right, b);
+        pull(E, a);
+        return a;
+    }
+    E[b].left = merge(E, a, E[b].left);
+    pull(E, b);
+    return b;
+}
+
+static int erase(PlaceEntry* E, int t, int e) {
+    if (t == e) return merge(E, E[t].left, E[t].right);
+    if (key_less(E, e, t)) E[t].left = erase(E, E[t].left, e);
+    else E[t].right = erase(E, E[t].right, e);
+    pull(E, t);
+    return t;
+}
+
+static void tree_insert(RPlacement* p, int e) {
+    PlaceEntry* E = p->entries;
+    int* root = &p->types[E[e].type].root;
+    int l, r;
+    split(E, *root, e, &l, &r);
+    E[e].left = E[e].right = -1;
+    E[e].min_id = e;
+    E[e].in_tree = 1;
+    *root = merge(E, merge(E, l, e), r);
+}
+
+static void tree_remove(RPlacement* p, int e) {
+    int* root = &p->types[p->entries[e].type].root;
+    *root = erase(p->entries, *root, e);
+    p->entries[e].in_tree = 0;
+}
+
+// Smallest key that fits
+static int best_fit(PlaceEntry* E, int t, int need) {
+    int best = -1;
+    while (t >= 0) {
+        if (E[t].avail >= need) {
+            best = t;
+            t = E[t].left;
+        } else {
+            t = E[t].right;
+        }
+    }
+    return best;
+}
+
+// Most available; the lowest index among equals, as for the other policies
+static int worst_fit(PlaceEntry* E, int t, int need) {
+    if (t < 0) return -1;
+    int top = t;
+    while (E[top].right >= 0) top = E[top].right;
+    return E[top].avail >= need ? best_fit(E, t, E[top].avail) : -1;
+}
+
+// A fitting node and everything to its right fit: take that subtree's
+// smallest index and keep looking left for a smaller one
+static int first_fit(PlaceEntry* E, int t, int need) {
+    int best = -1;
+    while (t >= 0) {
+        if (E[t].avail >= need) {
+            int m = t;
+            if (E[t].right >= 0 && E[E[t].right].min_id < m) m = E[E[t].right].min_id;
+            if (best < 0 || m < best) best = m;
+            t = E[t].left;
+        } else {
+            t = E[t].right;
+        }
+    }
+    return best;
+}
+
+// =====================
+// Internal helpers
+// =====================
+// Caller holds p->lock for everything below
+static int prefer_by(RPlacement* p, PlacementPolicy policy, int a, int b) {
+    if (b < 0) return 1;
+    PlaceEntry* E = p->entries;
+    switch (policy) {
+        case PLACE_WORST_FIT: return E[a].avail > E[b].avail || (E[a].avail == E[b].avail && a < b);
+        case PLACE_FIRST_FIT: return a < b;
+        default:              return key_less(E, a, b);
+    }
+}
+
+static int prefer(RPlacement* p, int a, int b) {
+    return prefer_by(p, p->policy, a, b);
+}
+
+static int lookup_type(RPlacement* p, PlacementPolicy policy, int type, int need) {
+    int root = p->types[type].root;
+    switch (policy) {
+        case PLACE_WORST_FIT: return worst_fit(p->entries, root, need);
+        case PLACE_FIRST_FIT: return first_fit(p->entries, root, need);
+        default:              return best_fit(p->entries, root, need);
+    }
+}
+
+// An empty type matches every index; the policy picks among their answers
+static int lookup_by(RPlacement* p, PlacementPolicy policy, const char* type, int need) {
+    int best = -1;
+    for (int t = 0; t < p->type_count; t++) {
+        if (type[0] && strcmp(p->types[t].type, type) != 0) continue;
+        int e = lookup_type(p, policy, t, need);
+        if (e >= 0 && prefer_by(p, policy, e, best)) best = e;
+    }
+    return best;
+}
+
+static int lookup(RPlacement* p, const char* type, int need) {
+    return lookup_by(p, p->policy, type, need);
+}
+
+static void set_avail(RPlacement* p, int e, int avail) {
+    PlaceEntry* E = p->entries;
+    if (E[e].avail == avail) return;
+    if (!E[e].in_tree) {
+        E[e].avail = avail;
+        return;
+    }
+    tree_remove(p, e);
+    E[e].avail = avail;
+    tree_insert(p, e);
+}
+
+// Re-read the node; 0 if the index had it wrong
+static int refresh(RPlacement* p, int e) {
+    PlaceEntry* E = p->entries;
+    int actual = monitor(E[e].node) - E[e].pending;
+    if (actual == E[e].avail) return 1;
+    set_avail(p, e, actual);
+    return 0;
+}
+
+static void refresh_stale(RPlacement* p) {
+    RMpscNode* n;
+    while ((n = mpsc_pop(&p->stale)) != NULL) {
+        PlaceEntry* e = (PlaceEntry*)((char*)n - offsetof(PlaceEntry, stale));
+        // Cleared first: a release from here on queues the node again
+        atomic_store(&e->queued, 0);
+        refresh(p, (int)(e - p->entries));
+    }
+}
+
+static void take(RPlacement* p, int e, int amount) {
+    p->entries[e].pending += amount;
+    set_avail(p, e, p->entries[e].avail - amount);
+}
+
+static void untake(RPlacement* p, int e, int amount) {
+    p->entries[e].pending -= amount;
+    set_avail(p, e, p->entries[e].avail + amount);
+}
+
+static int type_matches(RPlacement* p, int e, const char* type) {
+    return !type[0] || strcmp(p->types[p->entries[e].type].type, type) == 0;
+}
+
+static int place_one(RPlacement* p, TaskResourceReq* r) {
+    for (int probe = 0; probe < PLACEMENT_MAX_PROBES; probe++) {
+        int e = lookup(p, r->type, r->amount);
+        if (e < 0) return -1;
+        if (!refresh(p, e)) continue;
+        take(p, e, r->amount);
+        return e;
+    }
+    return -1;
+}
+
+// Best node for r among those on e's host, by the policy
+static int place_on_host(RPlacement* p, int e, TaskResourceReq* r) {
+    int best = -1;
+    int i = e;
+    do {
+        if (type_matches(p, i, r->type)) {
+            refresh(p, i);
+            if (p->entries[i].avail >= r->amount && prefer(p, i, best)) best = i;
+        }
+        i = p->entries[i].host_next;
+    } while (i != e);
+    if (best >= 0) take(p, best, r->amount);
+    return best;
+}
+
+static int needs_node(TaskResourceReq* r) {
+    return !r->node || r->placed;
+}
+
+// Place every unbound member of group g on the host of e; undone on failure
+static int fill_host(RPlacement* p, RTask* task, int g, int e, int* chosen) {
+    for (int i = 0; i < task->resource_count; i++) {
+        TaskResourceReq* r = &task->resources[i];
+        if (r->group != g || !needs_node(r)) continue;
+        chosen[i] = place_on_host(p, e, r);
+        if (chosen[i] >= 0) continue;
+
+        for (int j = 0; j < i; j++) {
+            TaskResourceReq* q = &task->resources[j];
+            if (q->group == g && needs_node(q) && chosen[j] >= 0) {
+                untake(p, chosen[j], q->amount);
+                chosen[j] = -1;
+            }
+        }
+        return 0;
+    }
+    return 1;
+}
+
+// The next unbound member of group g after requirement i, wrapping around
+static int next_member(RTask* task, int g, int i) {
+    for (int k = 1; k <= task->resource_count; k++) {
+        int j = (i + k) % task->resource_count;
+        if (task->resources[j].group == g && needs_node(&task->resources[j])) return j;
+    }
+    return i;
+}
+
+// A bound member fixes the host. Otherwise each probe asks the index for a
+// host that fits one member, taking the members in turn so that every type
+// gets to filter out hosts where it is short; failed candidates are set aside.
+// Under best- and first-fit the policy's candidates are often hosts another
+// member has already filled, so every other probe takes the emptiest node.
+static int place_group(RPlacement* p, RTask* task, int g, int first, int* chosen) {
+    for (int i = 0; i < task->resource_count; i++) {
+        TaskResourceReq* r = &task->resources[i];
+        if (r->group != g || needs_node(r)) continue;
+        if (r->node->id < 0 || r->node->id >= p->entry_count || p->entries[r->node->id].node != r->node)
+            return 0;
+        return fill_host(p, task, g, r->node->id, chosen);
+    }
+
+    int set_aside[PLACEMENT_MAX_PROBES];
+    int aside = 0;
+    int ok = 0;
+    int anchor = first;
+    for (int probe = 0; probe < PLACEMENT_MAX_PROBES && !ok; probe++) {
+        TaskResourceReq* r = &task->resources[anchor];
+        int e = lookup_by(p, probe % 2 ? PLACE_WORST_FIT : p->policy, r->type, r->amount);
+        if (e < 0) break;
+        if (!refresh(p, e)) continue;
+        ok = fill_host(p, task, g, e, chosen);
+        if (!ok) {
+            tree_remove(p, e);
+            set_aside[aside++] = e;
+            anchor = next_member(task, g, anchor);
+        }
+    }
+    while (aside > 0) tree_insert(p, set_aside[--aside]);
+    return ok;
+}
+
+// Choose a node for every requirement that needs one; chosen[i] is the
+// entry taken for requirement i, or -1. On failure nothing stays taken.
+static int bind(RPlacement* p, RTask* task, int* chosen) {
+    int n = task->resource_count;
+    for (int i = 0; i < n; i++) chosen[i] = -1;
+
+    int ok = 1;
+    for (int i = 0; i < n && ok; i++) {
+        TaskResourceReq* r = &task->resources[i];
+        if (!needs_node(r) || chosen[i] >= 0) continue;
+        if (r->group) {
+            int done = 0;   // an earlier member already placed the group
+            for (int j = 0; j < i && !done; j++)
+                done = task->resources[j].group == r->group && needs_node(&task->resources[j]);
+            if (!done) ok = place_group(p, task, r->group, i, chosen);
+        } else {
+            chosen[i] = place_one(p, r);
+            ok = chosen[i] >= 0;
+        }
+    }
+
+    if (!ok) {
+        for (int i = 0; i < n; i++)
+            if (chosen[i] >= 0) untake(p, chosen[i], task->resources[i].amount);
+        return 0;
+    }
+    pthread_mutex_lock(&task->lock);
+    for (int i = 0; i < n; i++) {
+        if (chosen[i] < 0) continue;
+        task->resources[i].node = p->entries[chosen[i]].node;
+        task->resources[i].placed = 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return 1;
+}
+
+// Watchers only queue the node; the index is fixed under the lock later
+static void node_changed(RNode* node, void* arg) {
+    RPlacement* p = (RPlacement*)arg;
+    if (node->id >= 0 && node->id < p->entry_count && p->entries[node->id].node == node) {
+        PlaceEntry* e = &p->entries[node->id];
+        if (!atomic_exchange(&e->queued, 1)) mpsc_push(&p->stale, &e->stale);
+    }
+}
+
+static void node_released(RNode* node, void* arg) {
+    RPlacement* p = (RPlacement*)arg;
+    node_changed(node, arg);
+    if (p->on_release) p->on_release(node, p->release_arg);
+}
+
+typedef struct {
+    int host;
+    int entry;
+} HostKey;
+
+static int by_host(const void* a, const void* b) {
+    const HostKey* x = (const HostKey*)a;
+    const HostKey* y = (const HostKey*)b;
+    if (x->host != y->host) return (x->host > y->host) - (x->host < y->host);
+    return (x->entry > y->entry) - (x->entry < y->entry);
+}
+
+// Ring the entries of each host together; a node without a host rings alone
+static int link_hosts(RPlacement* p) {
+    HostKey* order = (HostKey*)malloc((p->entry_count + 1) * sizeof(HostKey));
+    if (!order) return 0;
+    for (int i = 0; i < p->entry_count; i++) {
+        order[i].host = p->entries[i].node->host;
+        order[i].entry = i;
+    }
+    qsort(order, p->entry_count, sizeof(HostKey), by_host);
+
+    for (int i = 0; i < p->entry_count;) {
+        int j = i + 1;
+        int host = order[i].host;
+        while (host >= 0 && j < p->entry_count && order[j].host == host) j++;
+        for (int k = i; k < j; k++)
+            p->entries[order[k].entry].host_next = order[k + 1 < j ? k + 1 : i].entry;
+        i = j;
+    }
+    free(order);
+    return 1;
+}
+
+static int index_for(RPlacement* p, const char* type) {
+    for (int t = 0; t < p->type_count; t++)
+        if (strcmp(p->types[t].type, type) == 0) return t;
+
+    PlaceIndex* types = realloc(p->types, (p->type_count + 1) * sizeof(PlaceIndex));
+    if (!types) return -1;
+    p->types = types;
+    PlaceIndex* idx = &types[p->type_count];
+    snprintf(idx->type, sizeof(idx->type), "%s", type);
+    idx->root = -1;
+    idx->max_capacity = 0;
+    return p->type_count++;
+}
+
+// =====================
+// Placement API
+// =====================
+RPlacement* create_placement(RNetwork* net, PlacementPolicy policy) {
+    RPlacement* p = (RPlacement*)calloc(1, sizeof(RPlacement));
+    if (!p) return NULL;
+    p->net = net;
+    p->policy = policy;
+    p->entry_count = net->node_count;
+    p->entries = (PlaceEntry*)calloc(p->entry_count + 1, sizeof(PlaceEntry));
+    p->watches = (RNodeWatcher**)calloc(p->entry_count + 1, sizeof(RNodeWatcher*));
+    mpsc_init(&p->stale);
+    pthread_mutex_init(&p->lock, NULL);
+    if (!p->entries || !p->watches) {
+        destroy_placement(p);
+        return NULL;
+    }
+
+    unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < p->entry_count; i++) {
+        PlaceEntry* e = &p->entries[i];
+        e->node = net->nodes[i];
+        e->type = index_for(p, e->node->type);
+        if (e->type < 0) {
+            destroy_placement(p);
+            return NULL;
+        }
+        e->avail = monitor(e->node);
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        e->prio = (unsigned)(seed >> 32);
+        atomic_init(&e->queued, 0);
+        tree_insert(p, i);
+        if (e->node->capacity > p->types[e->type].max_capacity)
+            p->types[e->type].max_capacity = e->node->capacity;
+    }
+    if (!link_hosts(p)) {
+        destroy_placement(p);
+        return NULL;
+    }
+    for (int i = 0; i < p->entry_count; i++) {
+        p->watches[i] = node_watch_all(p->entries[i].node, node_released, node_changed, p);
+        if (!p->watches[i]) {
+            destroy_placement(p);
+            return NULL;
+        }
+    }
+    return p;
+}
+
+void destroy_placement(RPlacement* p) {
+    if (!p) return;
+    if (p->watches) {
+        for (int i = 0; i < p->entry_count; i++)
+            if (p->watches[i]) node_unwatch(p->watches[i]);
+    }
+    free(p->watches);
+    free(p->entries);
+    free(p->types);
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+}
+
+void placement_set_policy(RPlacement* p, PlacementPolicy policy) {
+    pthread_mutex_lock(&p->lock);
+    p->policy = policy;
+    pthread_mutex_unlock(&p->lock);
+}
+
+void placement_set_listener(RPlacement* p, NodeWatchFn fn, void* arg) {
+    pthread_mutex_lock(&p->lock);
+    p->release_arg = arg;
+    p->on_release = fn;
+    pthread_mutex_unlock(&p->lock);
+}
+
+int placement_can_ever_fit(RPlacement* p, RTask* task) {
+    for (int i = 0; i < task->resource_count; i++) {
+        TaskResourceReq* r = &task->resources[i];
+        if (!needs_node(r)) continue;
+        int fits = 0;
+        for (int t = 0; t < p->type_count && !fits; t++)
+            fits = (!r->type[0] || strcmp(p->types[t].type, r->type) == 0) && p->types[t].max_capacity >= r->amount;
+        if (!fits) return 0;
+    }
+    return 1;
+}
+
+// Nodes are chosen under the lock and reserved after it: release() on a
+// failed reservation may call the listener, which can take other locks.
+// Until then the chosen units count as pending, so concurrent placements
+// steer around them.
+static int place_and_reserve(RPlacement* p, RTask* task) {
+    int n = task->resource_count;
+    int* chosen = (int*)malloc((n + 1) * sizeof(int));
+    if (!chosen) return 0;
+
+    pthread_mutex_lock(&p->lock);
+    refresh_stale(p);
+    int ok = bind(p, task, chosen);
+    pthread_mutex_unlock(&p->lock);
+    if (!ok) {
+        free(chosen);
+        return 0;
+    }
+
+    ok = try_allocate_task(task);
+
+    pthread_mutex_lock(&p->lock);
+    for (int i = 0; i < n; i++) {
+        if (chosen[i] < 0) continue;
+        p->entries[chosen[i]].pending -= task->resources[i].amount;
+        refresh(p, chosen[i]);
+    }
+    pthread_mutex_unlock(&p->lock);
+    free(chosen);
+    return ok;
+}
+
+int placement_try_allocate(RPlacement* p, RTask* task) {
+    return place_and_reserve(p, task);
+}
+
+int placement_allocate(RPlacement* p, RTask* task) {
+    if (place_and_reserve(p, task)) return 1;
+    ROC_WARN("[Placement] No nodes for task '%s'.\n", task->name);
+    task_finish(task, TASK_FAILED);
+    return 0;
+}
@@ -0,0 +1,419 @@
+#ifndef _WIN32
+#define _GNU_SOURCE          // pthread_setaffinity_np
+#endif
+#include "roc_pool.h"
+#include "roc_clock.h"
+#include "roc_log.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#define POOL_INITIAL_CAPACITY 64
+#define STEAL_ATTEMPTS 2     // passes over the victims per band before giving up
+
+static _Thread_local RPoolWorker* current_worker;
+
+// =====================
+// Internal helpers
+// =====================
+int roc_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// Same thresholds as the hardware scheduler's thread priorities
+int worker_pool_band(int priority) {
+    if (priority >= 10) return 0;
+    if (priority > 0) return 1;
+    if (priority == 0) return 2;
+    return 3;
+}
+
+static void pin_to_cpu(int cpu) {
+#if defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), 1ULL << cpu);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        ROC_WARN("[Pool] Could not pin worker to CPU %d\n", cpu);
+#else
+    (void)cpu;
+#endif
+}
+
+static int ring_push(RPoolRing* r, RPoolJob* job) {
+    if (r->count == r->capacity) {
+        int capacity = r->capacity ? r->capacity * 2 : POOL_INITIAL_CAPACITY;
+        RPoolJob** jobs = (RPoolJob**)malloc(capacity * sizeof(RPoolJob*));
+        if (!jobs) return 0;
+        for (int i = 0; i < r->count; i++)
+            jobs[i] = r->jobs[(r->head + i) % r->capacity];
+        free(r->jobs);
+        r->jobs = jobs;
+        r->head = 0;
+        r->capacity = capacity;
+    }
+    r->jobs[(r->head + r->count) % r->capacity] = job;
+    r->count++;
+    return 1;
+}
+
+static RPoolJob* ring_pop(RPoolRing* r) {
+    if (r->count == 0) return NULL;
+    RPoolJob* job = r->jobs[r->head];
+    r->head = (r->head + 1) % r->capacity;
+    r->count--;
+    return job;
+}
+
+static long pending_jobs(RWorkerPool* pool) {
+    long n = 0;
+    for (int b = 0; b < ROC_POOL_BANDS; b++)
+        n += atomic_load(&pool->queued[b]);
+    return n;
+}
+
+// Caller holds pool->lock. A parked worker is preferred over the timekeeper.
+static void wake_worker(RWorkerPool* pool) {
+    if (pool->parked > 0) roc_cond_signal(&pool->work);
+    else if (pool->timekeeper) roc_cond_signal(&pool->timer);
+}
+
+// Caller holds pool->lock
+static int inject(RWorkerPool* pool, RPoolJob* job) {
+    if (!ring_push(&pool->inject[job->band], job)) return 0;
+    atomic_fetch_add(&pool->injected, 1);
+    atomic_fetch_add(&pool->queued[job->band], 1);
+    wake_worker(pool);
+    return 1;
+}
+
+// Caller holds pool->lock and has just changed the delayed heap
+static void update_next_due(RWorkerPool* pool) {
+    RHeapItem* top = heap_peek(&pool->delayed);
+    atomic_store(&pool->next_due, top ? top->key : LLONG_MAX);
+}
+
+// Move every delayed job whose deadline has passed onto the injection queues
+static void promote_due(RWorkerPool* pool) {
+    if (heap_size(&pool->delayed) == 0) return;
+    long long now = roc_now_us();
+    RHeapItem* top;
+    while ((top = heap_peek(&pool->delayed)) != NULL && top->key <= now) {
+        RHeapItem it;
+        heap_pop(&pool->delayed, &it);
+        inject(pool, (RPoolJob*)it.data);
+    }
+    update_next_due(pool);
+}
+
+// =====================
+// Finding work
+// =====================
+static unsigned next_random(RPoolWorker* w) {
+    unsigned x = w->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return w->rng = x;
+}
+
+static RPoolJob* steal_band(RPoolWorker* w, int band) {
+    RWorkerPool* pool = w->pool;
+    int n = pool->thread_count;
+    int self = (int)(w - pool->workers);
+
+    for (int pass = 0; pass < STEAL_ATTEMPTS; pass++) {
+        int contended = 0;
+        int start = (int)(next_random(w) % (unsigned)n);
+        for (int i = 0; i < n; i++) {
+            int v = (start + i) % n;
+            if (v == self) continue;
+            void* item = deque_steal(&pool->workers[v].local[band]);
+            if (item == ROC_DEQUE_ABORT) contended = 1;
+            else if (item != ROC_DEQUE_EMPTY) return (RPoolJob*)item;
+        }
+        if (!contended) break;
+    }
+    return NULL;
+}
+
+static RPoolJob* take_injected(RWorkerPool* pool, int band) {
+    if (atomic_load_explicit(&pool->injected, memory_order_relaxed) == 0) return NULL;
+    pthread_mutex_lock(&pool->lock);
+    RPoolJob* job = ring_pop(&pool->inject[band]);
+    if (job) atomic_fetch_sub(&pool->injected, 1);
+    pthread_mutex_unlock(&pool->lock);
+    return job;
+}
+
+// Highest band first, wherever the job is: own deque, injection queue, victims
+static RPoolJob* find_job(RPoolWorker* w) {
+    RWorkerPool* pool = w->pool;
+    for (int b = 0; b < ROC_POOL_BANDS; b++) {
+        if (atomic_load_explicit(&pool->queued[b], memory_order_relaxed) <= 0) continue;
+
+        RPoolJob* job = (RPoolJob*)deque_take(&w->local[b]);
+        if (!job) job = take_injected(pool, b);
+        if (!job) job = steal_band(w, b);
+        if (job) {
+            atomic_fetch_sub_explicit(&pool->queued[b], 1, memory_order_relaxed);
+            return job;
+        }
+    }
+    return NULL;
+}
+
+// =====================
+// Worker thread
+// =====================
+static void* worker_thread(void* arg) {
+    RPoolWorker* w = (RPoolWorker*)arg;
+    RWorkerPool* pool = w->pool;
+    current_worker = w;
+    if (w->cpu >= 0) pin_to_cpu(w->cpu);
+
+    for (;;) {
+        // Due jobs join the queues even while every worker stays busy
+        if (roc_now_us() >= atomic_load_explicit(&pool->next_due, memory_order_relaxed)) {
+            pthread_mutex_lock(&pool->lock);
+            promote_due(pool);
+            pthread_mutex_unlock(&pool->lock);
+        }
+
+        RPoolJob* job = find_job(w);
+        if (job) {
+            int owned = job->owned;
+            job->fn(job->arg);
+            if (owned) free(job);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        promote_due(pool);
+        // A job counted but not yet visible is being pushed right now
+        if (pending_jobs(pool) > 0) {
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+        if (!atomic_load(&pool->running) && heap_size(&pool->delayed) == 0) {
+            roc_cond_broadcast(&pool->work);
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        // Announce before the final check; lock-free submitters read it after pushing
+        atomic_fetch_add(&pool->sleepers, 1);
+        if (pending_jobs(pool) == 0) {
+            if (!pool->timekeeper && heap_size(&pool->delayed) > 0) {
+                // One parked worker sleeps until the earliest deadline
+                pool->timekeeper = 1;
+                roc_cond_timedwait(&pool->timer, &pool->lock, heap_peek(&pool->delayed)->key);
+                pool->timekeeper = 0;
+            } else {
+                pool->parked++;
+                roc_cond_wait(&pool->work, &pool->lock);
+                pool->parked--;
+            }
+        }
+        atomic_fetch_sub(&pool->sleepers, 1);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    current_worker = NULL;
+    return NULL;
+}
+
+// =====================
+// Pool API
+// =====================
+RWorkerPool* create_worker_pool(int threads, int pin_cpus) {
+    int cpus = roc_cpu_count();
+    if (threads <= 0) threads = cpus;
+
+    RWorkerPool* pool = (RWorkerPool*)calloc(1, sizeof(RWorkerPool));
+    pool->workers = (RPoolWorker*)calloc(threads, sizeof(RPoolWorker));
+    pool->threads = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    for (int b = 0; b < ROC_POOL_BANDS; b++)
+        atomic_init(&pool->queued[b], 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->injected, 0);
+    atomic_init(&pool->running, 1);
+    heap_init(&pool->delayed);
+    atomic_init(&pool->next_due, LLONG_MAX);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->timer, NULL);
+
+    // Workers are set up before any starts: thieves scan every deque
+    for (int i = 0; i < threads; i++) {
+        RPoolWorker* w = &pool->workers[i];
+        for (int b = 0; b < ROC_POOL_BANDS; b++)
+            deque_init(&w->local[b], POOL_INITIAL_CAPACITY);
+        w->pool = pool;
+        w->rng = 2654435761u * (unsigned)(i + 1);
+        w->cpu = pin_cpus ? i % cpus : -1;
+    }
+    pool->worker_count = threads;
+    pool->thread_count = threads;
+
+    for (int i = 0; i < threads; i++) {
+        if (roc_thread_spawn(&pool->threads[i], worker_thread, &pool->workers[i])) continue;
+
+        ROC_ERROR("[Pool] Failed to start worker %d of %d\n", i + 1, threads);
+        pool->thread_count = i;
+        destroy_worker_pool(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void destroy_worker_pool(RWorkerPool* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->running, 0);
+    roc_cond_broadcast(&pool->work);
+    roc_cond_broadcast(&pool->timer);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++)
+        roc_thread_join(pool->threads[i]);
+
+    for (int i = 0; i < pool->worker_count; i++)
+        for (int b = 0; b < ROC_POOL_BANDS; b++)
+            deque_free(&pool->workers[i].local[b]);
+    for (int b = 0; b < ROC_POOL_BANDS; b++)
+        free(pool->inject[b].jobs);
+    RHeapItem it;
+    while (heap_pop(&pool->delayed, &it)) {
+        RPoolJob* job = (RPoolJob*)it.data;
+        if (job->owned) free(job);
+    }
+    heap_free(&pool->delayed);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->timer);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
+static int enqueue(RWorkerPool* pool, RPoolJob* job) {
+    RPoolWorker* w = current_worker;
+    if (w && w->pool == pool) {
+        // Counted first so a parked worker's final check cannot miss it
+        atomic_fetch_add(&pool->queued[job->band], 1);
+        deque_push(&w->local[job->band], job);
+        if (atomic_load(&pool->sleepers) > 0) {
+            pthread_mutex_lock(&pool->lock);
+            wake_worker(pool);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        return 1;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    int ok = inject(pool, job);
+    pthread_mutex_unlock(&pool->lock);
+    return ok;
+}
+
+// Jobs may still be added while destroy drains the pool (e.g. by running jobs)
+int worker_pool_submit_job(RWorkerPool* pool, RPoolJob* job, int priority) {
+    job->band = worker_pool_band(priority);
+    return enqueue(pool, job);
+}
+
+int worker_pool_submit_job_after(RWorkerPool* pool, RPoolJob* job, int priority, long long delay_us) {
+    if (delay_us <= 0) return worker_pool_submit_job(pool, job, priority);
+
+    job->band = worker_pool_band(priority);
+    long long due = roc_now_us() + delay_us;
+
+    pthread_mutex_lock(&pool->lock);
+    if (!heap_push(&pool->delayed, due, job)) {
+        pthread_mutex_unlock(&pool->lock);
+        return 0;
+    }
+    // New earliest deadline: re-arm the timekeeper, or recruit one
+    if (heap_peek(&pool->delayed)->data == job) {
+        update_next_due(pool);
+        if (pool->timekeeper) roc_cond_signal(&pool->timer);
+        else if (pool->parked > 0) roc_cond_signal(&pool->work);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+// A timekeeper sleeping on the withdrawn deadline just wakes early
+int worker_pool_cancel_job(RWorkerPool* pool, RPoolJob* job) {
+    pthread_mutex_lock(&pool->lock);
+    int ok = heap_remove(&pool->delayed, job);
+    if (ok) update_next_due(pool);
+    pthread_mutex_unlock(&pool->lock);
+    return ok;
+}
+
+static RPoolJob* owned_job(RPoolFn fn, void* arg) {
+    RPoolJob* job = (RPoolJob*)malloc(sizeof(RPoolJob));
+    if (!job) return NULL;
+    job->fn = fn;
+    job->arg = arg;
+    job->owned = 1;
+    return job;
+}
+
+int worker_pool_submit(RWorkerPool* pool, RPoolFn fn, void* arg) {
+    RPoolJob* job = owned_job(fn, arg);
+    if (!job) return 0;
+    if (worker_pool_submit_job(pool, job, 0)) return 1;
+    free(job);
+    return 0;
+}
+
+int worker_pool_submit_after(RWorkerPool* pool, long long delay_us, RPoolFn fn, void* arg) {
+    RPoolJob* job = owned_job(fn, arg);
+    if (!job) return 0;
+    if (worker_pool_submit_job_after(pool, job, 0, delay_us)) return 1;
+    free(job);
+    return 0;
+}
+
+int worker_pool_size(RWorkerPool* pool) {
+    return pool->thread_count;
+}
+
+// =====================
+// Default pool
+// =====================
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+static RWorkerPool* default_pool;
+static int default_threads;
+static int default_pin;
+
+static void make_default_pool(void) {
+    default_pool = create_worker_pool(default_threads, default_pin);
+}
+
+RWorkerPool* roc_default_pool(void) {
+    pthread_once(&default_once, make_default_pool);
+    return default_pool;
+}
+
+void roc_set_default_pool_size(int threads, int pin_cpus) {
+    default_threads = threads;
+    default_pin = pin_cpus;
+}
@@ -1,4 +1,6 @@
 #include "roc_program.h"
+#include "roc_clock.h"
+#include "roc_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,15 +17,20 @@ RProgram* create_program(const char* name, int priority) {
     prog->campaign_count = 0;
     prog->priority = priority;
     prog->status = PROGRAM_PENDING;
+    prog->running = 0;
+    prog->hooks = NULL;
 
     pthread_mutex_init(&prog->lock, NULL);
+    pthread_cond_init(&prog->done, NULL);
     return prog;
 }
 
 // Destroy a program
 void destroy_program(RProgram* program) {
     if (!program) return;
+    completion_hooks_free(program->hooks);
     pthread_mutex_destroy(&program->lock);
+    pthread_cond_destroy(&program->done);
     free(program);
 }
 
@@ -42,10 +49,8 @@ int program_add_campaign(RProgram* program, RCampaign* campaign) {
     return 1;
 }
 
-// Update program status
-static void update_program_status(RProgram* program) {
-    pthread_mutex_lock(&program->lock);
-
+// Derive the program status from its campaigns; caller holds program->lock
+static void compute_program_status(RProgram* program) {
     int all_completed = 1;
     int any_failed = 0;
 
@@ -58,7 +63,12 @@ static void update_program_status(RProgram* program) {
     if (any_failed) program->status = PROGRAM_FAILED;
     else if (all_completed) program->status = PROGRAM_COMPLETED;
     else program->status = PROGRAM_RUNNING;
+}
 
+// Update program status
+static void update_program_status(RProgram* program) {
+    pthread_mutex_lock(&program->lock);
+    compute_program_status(program);
     pthread_mutex_unlock(&program->lock);
 }
 
@@ -67,20 +77,29 @@ int program_run(RProgram* program, RTaskScheduler* sched) {
     if (!program || !sched) return 0;
 
     pthread_mutex_lock(&program->lock);
-    if (program->campaign_count == 0) {
+    if (program->campaign_count == 0 || program->running) {
         pthread_mutex_unlock(&program->lock);
         return 0;
     }
 
     program->status = PROGRAM_RUNNING;
+    program->running = 1;
     pthread_mutex_unlock(&program->lock);
 
-    printf("[Program] Starting program '%s'\n", program->name);
+    ROC_INFO("[Program] Starting program '%s'\n", program->name);
 
     for (int i = 0; i < program->campaign_count; i++) {
         campaign_run(program->campaigns[i], sched);
     }
 
+    pthread_mutex_lock(&program->lock);
+    compute_program_status(program);
+    program->running = 0;
+    RCompletionHook* hooks = program->hooks;
+    program->hooks = NULL;
+    roc_cond_broadcast(&program->done);
+    pthread_mutex_unlock(&program->lock);
+    completion_hooks_run(hooks, program);
     return 1;
 }
 
@@ -92,3 +111,25 @@ ProgramStatus program_status(RProgram* program) {
     pthread_mutex_unlock(&program->lock);
     return s;
 }
+
+// Wait for a program run started on another thread
+ProgramStatus program_wait(RProgram* program) {
+    pthread_mutex_lock(&program->lock);
+    while (program->running)
+        roc_cond_wait(&program->done, &program->lock);
+    pthread_mutex_unlock(&program->lock);
+    return program_status(program);
+}
+
+// Register a callback for the end of the current run
+int program_on_complete(RProgram* program, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&program->lock);
+    if (program->running) {
+        int ok = completion_hook_add(&program->hooks, fn, arg);
+        pthread_mutex_unlock(&program->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&program->lock);
+    fn(program, arg);
+    return 1;
+}
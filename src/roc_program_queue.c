@@ -2,7 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#include "roc_log.h"
 
 // Create program queue
 RProgramQueue* create_program_queue(const char* name) {
@@ -37,7 +37,7 @@ int program_queue_add(RProgramQueue* queue, RProgram* prog) {
 // Run queue sequentially
 int program_queue_run(RProgramQueue* queue, RTaskScheduler* sched) {
     if (!queue || !sched) return -1;
-    printf("=== Running programs in queue '%s' ===\n", queue->name);
+    ROC_INFO("=== Running programs in queue '%s' ===\n", queue->name);
 
     for (int i = 0; i < queue->program_count; i++) {
         RProgram* prog = queue->programs[i];
@@ -45,22 +45,20 @@ int program_queue_run(RProgramQueue* queue, RTaskScheduler* sched) {
             program_run(prog, sched);
 
             // Wait until program finishes
-            while (program_status(prog) == PROGRAM_RUNNING) {
-                usleep(50000);
-            }
-            printf("[ProgramQueue] Program '%s' finished with status %d\n",
-                   prog->name, program_status(prog));
+            ProgramStatus s = program_wait(prog);
+            ROC_INFO("[ProgramQueue] Program '%s' finished with status %d\n",
+                   prog->name, s);
         }
     }
 
-    printf("[ProgramQueue] All programs in queue '%s' completed\n", queue->name);
+    ROC_INFO("[ProgramQueue] All programs in queue '%s' completed\n", queue->name);
     return 0;
 }
 
 // Run queue by priority
 int program_queue_run_priority(RProgramQueue* queue, RTaskScheduler* sched) {
     if (!queue || !sched) return -1;
-    printf("=== Running programs in queue '%s' (priority order) ===\n", queue->name);
+    ROC_INFO("=== Running programs in queue '%s' (priority order) ===\n", queue->name);
 
     // Simple bubble sort by priority
     for (int i = 0; i < queue->program_count - 1; i++) {
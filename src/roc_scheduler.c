@@ -1,56 +1,895 @@
 #include "roc_scheduler.h"
 #include "roc_task.h"
+#include "roc_clock.h"
+#include "roc_log.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+// Priorities are clamped so the packing rank fits below them in the key
+#define SCHED_PRIORITY_LIMIT (1LL << 30)
+
+// Per-node demand of one task or gang; the same node may appear in several requirements
+typedef struct {
+    RNode* node;
+    int need;
+    int extra;   // head reservation: units left over at the shadow time
+} NodeDemand;
+
+// Capacity held for the blocked head task or gang
+typedef struct {
+    NodeDemand nodes[SCHED_UNIT_DEMAND];
+    int count;
+    long long shadow_us;   // estimated start of the head task
+} HeadReservation;
 
 // =====================
-// Internal helper: find the highest priority pending task
+// Internal helpers
 // =====================
-static int find_highest_priority(RTaskScheduler* sched) {
-    int idx = -1;
-    int max_priority = -1;
-    for (int i = 0; i < sched->count; i++) {
-        if (sched->queue[i]->status == TASK_PENDING && sched->queue[i]->priority > max_priority) {
-            max_priority = sched->queue[i]->priority;
-            idx = i;
+// Bound requirements only: placement decides where the others go.
+// Returns -1 past SCHED_UNIT_DEMAND distinct nodes.
+static int unit_demand(RTask** tasks, int n, NodeDemand* out) {
+    int count = 0;
+    for (int t = 0; t < n; t++) {
+        for (int i = 0; i < tasks[t]->resource_count; i++) {
+            TaskResourceReq* r = &tasks[t]->resources[i];
+            if (!r->node || r->placed) continue;
+            int j = 0;
+            while (j < count && out[j].node != r->node) j++;
+            if (j == count) {
+                if (count == SCHED_UNIT_DEMAND) return -1;
+                out[count].node = r->node;
+                out[count].need = 0;
+                out[count].extra = 0;
+                count++;
+            }
+            out[j].need += r->amount;
+        }
+    }
+    return count;
+}
+
+// Members of a gang run side by side
+static long long unit_estimate(RTask** tasks, int n) {
+    long long longest = 0;
+    for (int i = 0; i < n; i++) {
+        long long est = task_estimate_us(tasks[i]);
+        if (est > longest) longest = est;
+    }
+    return longest;
+}
+
+// Unbound requirements need an engine with a node big enough for each
+static int placeable(RTaskScheduler* sched, RTask** tasks, int n) {
+    for (int i = 0; i < n; i++) {
+        if (!task_needs_placement(tasks[i])) continue;
+        if (!sched->placement || !placement_can_ever_fit(sched->placement, tasks[i])) return 0;
+    }
+    return 1;
+}
+
+static int try_allocate_member(RTaskScheduler* sched, RTask* task) {
+    if (task_needs_placement(task)) return placement_try_allocate(sched->placement, task);
+    return try_allocate_task(task);
+}
+
+// All or nothing: on failure every member is pending again
+static int try_allocate_unit(RTaskScheduler* sched, RTask** tasks, int n) {
+    for (int i = 0; i < n; i++) {
+        if (!try_allocate_member(sched, tasks[i])) {
+            while (--i >= 0) deallocate_task(tasks[i]);
+            return 0;
         }
     }
-    return idx;
+    return 1;
+}
+
+static long long queue_key(RTaskScheduler* sched, RTask* task) {
+    long long p = task->priority;
+    if (p > SCHED_PRIORITY_LIMIT) p = SCHED_PRIORITY_LIMIT;
+    if (p < -SCHED_PRIORITY_LIMIT) p = -SCHED_PRIORITY_LIMIT;
+
+    long long rank = 0;
+    if (sched->packing == SCHED_PACK_GANGS_FIRST)
+        rank = task->gang ? INT_MAX - (long long)task->gang->units : (long long)INT_MAX + 1;
+    return -p * (1LL << 32) + rank;
 }
 
 // =====================
-// Scheduler thread
+// Owner shares (DRF)
 // =====================
-static void* scheduler_thread(void* arg) {
+// Caller holds sched->lock for everything in this section.
+static int type_index(RTaskScheduler* sched, const char* type) {
+    for (int i = 0; i < sched->type_count; i++)
+        if (strcmp(sched->type_names[i], type) == 0) return i;
+    if (sched->type_count == SCHED_RESOURCE_TYPES) return -1;
+
+    int i = sched->type_count++;
+    snprintf(sched->type_names[i], sizeof(sched->type_names[i]), "%s", type);
+    sched->type_total[i] = 0;
+    return i;
+}
+
+static void compute_share(RTaskScheduler* sched, RSchedOwner* o) {
+    double dominant = 0.0;
+    for (int t = 0; t < sched->type_count; t++) {
+        if (sched->type_total[t] <= 0) continue;
+        double s = (double)o->used[t] / (double)sched->type_total[t];
+        if (s > dominant) dominant = s;
+    }
+    o->share = dominant / o->weight;
+}
+
+// Lower share first; the owner id breaks ties so the order is deterministic
+static int owner_before(RTaskScheduler* sched, int a, int b) {
+    double x = sched->owners[a].share, y = sched->owners[b].share;
+    return x < y || (x == y && a < b);
+}
+
+static void ready_place(RTaskScheduler* sched, int slot, int id) {
+    sched->ready[slot] = id;
+    sched->owners[id].ready_slot = slot;
+}
+
+static void ready_sift_up(RTaskScheduler* sched, int slot) {
+    int id = sched->ready[slot];
+    while (slot > 0) {
+        int parent = (slot - 1) / 2;
+        if (!owner_before(sched, id, sched->ready[parent])) break;
+        ready_place(sched, slot, sched->ready[parent]);
+        slot = parent;
+    }
+    ready_place(sched, slot, id);
+}
+
+static void ready_sift_down(RTaskScheduler* sched, int slot) {
+    int id = sched->ready[slot];
+    for (;;) {
+        int child = 2 * slot + 1;
+        if (child >= sched->ready_count) break;
+        if (child + 1 < sched->ready_count && owner_before(sched, sched->ready[child + 1], sched->ready[child]))
+            child++;
+        if (!owner_before(sched, sched->ready[child], id)) break;
+        ready_place(sched, slot, sched->ready[child]);
+        slot = child;
+    }
+    ready_place(sched, slot, id);
+}
+
+static void ready_insert(RTaskScheduler* sched, int id) {
+    if (sched->owners[id].ready_slot >= 0) return;
+    ready_place(sched, sched->ready_count++, id);
+    ready_sift_up(sched, sched->ready_count - 1);
+}
+
+static void ready_remove(RTaskScheduler* sched, int id) {
+    int slot = sched->owners[id].ready_slot;
+    if (slot < 0) return;
+    sched->owners[id].ready_slot = -1;
+    int last = sched->ready[--sched->ready_count];
+    if (slot == sched->ready_count) return;
+    ready_place(sched, slot, last);
+    ready_sift_up(sched, slot);
+    ready_sift_down(sched, sched->owners[last].ready_slot);
+}
+
+// The owner's share moved; restore its place among the ready owners
+static void owner_changed(RTaskScheduler* sched, int id) {
+    compute_share(sched, &sched->owners[id]);
+    int slot = sched->owners[id].ready_slot;
+    if (slot < 0) return;
+    ready_sift_up(sched, slot);
+    ready_sift_down(sched, sched->owners[id].ready_slot);
+}
+
+// Totals changed: every share moves, so rebuild the ready heap
+static void shares_rebuilt(RTaskScheduler* sched) {
+    for (int i = 0; i < sched->owner_count; i++)
+        compute_share(sched, &sched->owners[i]);
+    for (int slot = sched->ready_count / 2 - 1; slot >= 0; slot--)
+        ready_sift_down(sched, slot);
+}
+
+static int owner_id(int owner) {
+    return (owner < 0 || owner >= SCHED_OWNER_MAX) ? 0 : owner;
+}
+
+// Grow the owner table to include id; 0 when out of memory
+static int ensure_owner(RTaskScheduler* sched, int id) {
+    if (id < sched->owner_count) return 1;
+    int cap = sched->owner_count ? sched->owner_count * 2 : 16;
+    while (cap <= id) cap *= 2;
+    if (cap > SCHED_OWNER_MAX) cap = SCHED_OWNER_MAX;
+
+    RSchedOwner* owners = realloc(sched->owners, cap * sizeof(RSchedOwner));
+    if (!owners) return 0;
+    sched->owners = owners;
+    int* ready = realloc(sched->ready, cap * sizeof(int));
+    if (!ready) return 0;
+    sched->ready = ready;
+
+    for (int i = sched->owner_count; i < cap; i++) {
+        RSchedOwner* o = &owners[i];
+        heap_init(&o->queue);
+        o->weight = 1.0;
+        for (int t = 0; t < SCHED_RESOURCE_TYPES; t++) o->used[t] = 0;
+        o->share = 0.0;
+        o->ready_slot = -1;
+    }
+    sched->owner_count = cap;
+    return 1;
+}
+
+// Without a network, the largest node of each type seen stands in for its total
+static void note_capacity(RTaskScheduler* sched, RTask** tasks, int n) {
+    if (sched->totals_fixed) return;
+    int grew = 0;
+    for (int k = 0; k < n; k++) {
+        for (int i = 0; i < tasks[k]->resource_count; i++) {
+            RNode* node = tasks[k]->resources[i].node;
+            if (!node) continue;
+            int t = type_index(sched, node->type);
+            if (t >= 0 && node->capacity > sched->type_total[t]) {
+                sched->type_total[t] = node->capacity;
+                grew = 1;
+            }
+        }
+    }
+    if (grew) shares_rebuilt(sched);
+}
+
+// Charge (sign 1) or refund (sign -1) a started task to its owner
+static void charge(RTaskScheduler* sched, RTask* task, int sign) {
+    int id = owner_id(task->owner);
+    if (id >= sched->owner_count) return;
+    RSchedOwner* o = &sched->owners[id];
+    for (int i = 0; i < task->resource_count; i++) {
+        RNode* node = task->resources[i].node;
+        int t = node ? type_index(sched, node->type) : -1;
+        if (t >= 0) o->used[t] += sign * task->resources[i].amount;
+    }
+    owner_changed(sched, id);
+}
+
+// Next entry: the earliest deadline, else from the owner with the lowest share
+static int next_entry(RTaskScheduler* sched, RHeapItem* item) {
+    if (heap_pop(&sched->deadlines, item)) return 1;
+    if (sched->ready_count == 0) return 0;
+    int id = sched->ready[0];
+    RSchedOwner* o = &sched->owners[id];
+    heap_pop(&o->queue, item);
+    if (heap_size(&o->queue) == 0) ready_remove(sched, id);
+    return 1;
+}
+
+static int queue_entry(RTaskScheduler* sched, RTask* task, const RHeapItem* item) {
+    if (task->deadline_us)
+        return item ? heap_push_item(&sched->deadlines, item) : heap_push(&sched->deadlines, task->deadline_us, task);
+    int id = owner_id(task->owner);
+    if (!ensure_owner(sched, id)) return 0;
+    RSchedOwner* o = &sched->owners[id];
+    int ok = item ? heap_push_item(&o->queue, item) : heap_push(&o->queue, queue_key(sched, task), task);
+    if (!ok) return 0;
+    ready_insert(sched, id);
+    return 1;
+}
+
+// Detach the gang from its leader before the leader can run (and be freed)
+static RGang* take_gang(RTask* task) {
+    RGang* gang = task->gang;
+    task->gang = NULL;
+    return gang;
+}
+
+// =====================
+// Deadline class (EDF)
+// =====================
+typedef struct {
+    long long deadline_us;
+    long long work;   // units x us still to run on one node
+} DeadlineWork;
+
+static int by_deadline(const void* a, const void* b) {
+    long long x = ((const DeadlineWork*)a)->deadline_us;
+    long long y = ((const DeadlineWork*)b)->deadline_us;
+    return (x > y) - (x < y);
+}
+
+static int units_on(RTask* task, RNode* node) {
+    int units = 0;
+    for (int i = 0; i < task->resource_count; i++)
+        if (task->resources[i].node == node) units += task->resources[i].amount;
+    return units;
+}
+
+// Queued entries count every member; caller holds sched->lock
+static long long entry_work(RTask* task, RNode* node) {
+    RTask** tasks = task->gang ? task->gang->tasks : &task;
+    int n = task->gang ? task->gang->count : 1;
+    long long work = 0;
+    for (int i = 0; i < n; i++)
+        work += (long long)units_on(tasks[i], node) * task_estimate_us(tasks[i]);
+    return work;
+}
+
+// Units x us that running tasks without a deadline keep from the
+// deadline class up to time t. With preemption on they can be evicted, so
+// nothing is held.
+static long long held_until(RTaskScheduler* sched, DeadlineWork* held, int count, long long t) {
+    if (sched->preemption) return 0;
+    long long total = 0;
+    for (int i = 0; i < count; i++)
+        total += held[i].work * (held[i].deadline_us < t ? held[i].deadline_us : t);
+    return total;
+}
+
+// Processor demand on one node: for every deadline from the new one on,
+// the admitted work due by then must fit in what capacity x time left
+// leaves after running tasks that cannot be evicted
+static int node_feasible(RTaskScheduler* sched, RNode* node, long long deadline, long long work, long long now) {
+    int cap = sched->active_count + heap_size(&sched->deadlines) + 1;
+    DeadlineWork* w = (DeadlineWork*)malloc(cap * sizeof(DeadlineWork));
+    DeadlineWork* held = (DeadlineWork*)malloc(cap * sizeof(DeadlineWork));   // units, time left
+    if (!w || !held) {
+        free(w);
+        free(held);
+        return 0;
+    }
+
+    int n = 0, h = 0;
+    w[n].deadline_us = deadline;
+    w[n++].work = work;
+    for (int i = 0; i < sched->active_count; i++) {
+        RTask* t = sched->active[i].task;
+        long long left = sched->active[i].end_us - now;
+        int units = units_on(t, node);
+        if (units <= 0 || left <= 0) continue;
+        if (t->deadline_us) {
+            w[n].deadline_us = t->deadline_us;
+            w[n++].work = units * left;
+        } else {
+            held[h].work = units;
+            held[h++].deadline_us = left;
+        }
+    }
+    for (int i = 0; i < sched->deadlines.count; i++) {
+        RTask* t = (RTask*)sched->deadlines.items[i].data;
+        long long queued = entry_work(t, node);
+        if (queued > 0) {
+            w[n].deadline_us = t->deadline_us;
+            w[n++].work = queued;
+        }
+    }
+    qsort(w, n, sizeof(DeadlineWork), by_deadline);
+
+    long long due = 0;
+    int ok = 1;
+    for (int i = 0; i < n && ok; i++) {
+        due += w[i].work;
+        int last = i + 1 == n || w[i + 1].deadline_us != w[i].deadline_us;
+        if (!last || w[i].deadline_us < deadline) continue;
+        long long span = w[i].deadline_us - now;
+        if (due > (long long)node->capacity * span - held_until(sched, held, h, span)) ok = 0;
+    }
+    free(w);
+    free(held);
+    return ok;
+}
+
+// Caller holds sched->lock
+static int admit_deadline(RTaskScheduler* sched, RTask* task) {
+    RTask** tasks = task->gang ? task->gang->tasks : &task;
+    int n = task->gang ? task->gang->count : 1;
+    long long now = roc_now_us();
+    if (now + unit_estimate(tasks, n) > task->deadline_us) return 0;
+
+    NodeDemand d[SCHED_UNIT_DEMAND];
+    int count = unit_demand(tasks, n, d);
+    if (count < 0) return 0;
+    for (int i = 0; i < count; i++) {
+        if (!node_feasible(sched, d[i].node, task->deadline_us, entry_work(task, d[i].node), now)) return 0;
+    }
+    return 1;
+}
+
+// Caller holds sched->lock
+static void deadline_outcome(RTaskScheduler* sched, RTask* task) {
+    if (!task->deadline_us) return;
+    long long late = roc_now_us() - task->deadline_us;
+    RSchedDeadlineStats* s = &sched->deadline_stats;
+    if (late <= 0) {
+        s->met++;
+        return;
+    }
+    s->missed++;
+    s->total_late_us += late;
+    if (late > s->max_late_us) s->max_late_us = late;
+    ROC_WARN("[Scheduler] Task '%s' missed its deadline by %lld us.\n", task->name, late);
+}
+
+static NodeDemand* find_demand(NodeDemand* nodes, int count, RNode* node) {
+    for (int i = 0; i < count; i++)
+        if (nodes[i].node == node) return &nodes[i];
+    return NULL;
+}
+
+static int fits_ever(NodeDemand* d, int count) {
+    for (int i = 0; i < count; i++)
+        if (!d[i].node || d[i].need > d[i].node->capacity) return 0;
+    return 1;
+}
+
+static int fits_now(NodeDemand* d, int count) {
+    for (int i = 0; i < count; i++)
+        if (d[i].need > monitor(d[i].node)) return 0;
+    return 1;
+}
+
+static int by_end(const void* a, const void* b) {
+    long long x = ((const RSchedActive*)a)->end_us;
+    long long y = ((const RSchedActive*)b)->end_us;
+    return (x > y) - (x < y);
+}
+
+// Replay estimated completions of running tasks on the head's nodes until
+// the head fits. Caller holds sched->lock.
+static void reserve_for_head(RTaskScheduler* sched, NodeDemand* d, int count, HeadReservation* r) {
+    r->count = count;
+    for (int i = 0; i < count; i++) r->nodes[i] = d[i];
+    int avail[SCHED_UNIT_DEMAND];
+    for (int i = 0; i < r->count; i++) avail[i] = monitor(r->nodes[i].node);
+
+    RSchedActive* touching = (RSchedActive*)malloc((sched->active_count + 1) * sizeof(RSchedActive));
+    int n = 0;
+    for (int i = 0; i < sched->active_count; i++) {
+        RTask* t = sched->active[i].task;
+        for (int k = 0; k < t->resource_count; k++) {
+            if (find_demand(r->nodes, r->count, t->resources[k].node)) {
+                touching[n++] = sched->active[i];
+                break;
+            }
+        }
+    }
+    qsort(touching, n, sizeof(RSchedActive), by_end);
+
+    r->shadow_us = LLONG_MAX;
+    int satisfied = 0;
+    for (int i = 0; i <= n && !satisfied; i++) {
+        if (i > 0) {
+            RTask* t = touching[i - 1].task;
+            for (int k = 0; k < t->resource_count; k++) {
+                NodeDemand* d = find_demand(r->nodes, r->count, t->resources[k].node);
+                if (d) avail[d - r->nodes] += t->resources[k].amount;
+            }
+        }
+        satisfied = 1;
+        for (int j = 0; j < r->count; j++)
+            if (avail[j] < r->nodes[j].need) satisfied = 0;
+        if (satisfied) r->shadow_us = (i == 0) ? roc_now_us() : touching[i - 1].end_us;
+    }
+    free(touching);
+
+    // Never satisfied means capacity is held outside the scheduler: keep it all
+    for (int j = 0; j < r->count; j++) {
+        int extra = avail[j] - r->nodes[j].need;
+        r->nodes[j].extra = (satisfied && extra > 0) ? extra : 0;
+    }
+}
+
+// A later task may jump the head if it ends before the shadow time or only
+// uses the head's nodes within the spare capacity
+static int can_backfill(HeadReservation* r, long long est, NodeDemand* d, int count, long long now) {
+    if (!fits_now(d, count)) return 0;
+    if (now + est <= r->shadow_us) return 1;
+    for (int i = 0; i < count; i++) {
+        NodeDemand* h = find_demand(r->nodes, r->count, d[i].node);
+        if (h && d[i].need > h->extra) return 0;
+    }
+    return 1;
+}
+
+static void take_extra(HeadReservation* r, long long est, NodeDemand* d, int count, long long now) {
+    if (now + est <= r->shadow_us) return;
+    for (int i = 0; i < count; i++) {
+        NodeDemand* h = find_demand(r->nodes, r->count, d[i].node);
+        if (h) h->extra -= d[i].need;
+    }
+}
+
+// Caller holds sched->lock. The task stops calling back into the scheduler;
+// track() hooks it up again if it is dispatched once more.
+static void remove_active(RTaskScheduler* sched, RTask* task) {
+    int slot = task->sched_slot;
+    sched->active[slot] = sched->active[--sched->active_count];
+    sched->active[slot].task->sched_slot = slot;
+    task->sched_slot = -1;
+    task->on_done = NULL;
+    task->done_arg = NULL;
+}
+
+static void task_finished(RTask* task, void* arg) {
     RTaskScheduler* sched = (RTaskScheduler*)arg;
+    pthread_mutex_lock(&sched->lock);
+    charge(sched, task, -1);
+    remove_active(sched, task);
+    deadline_outcome(sched, task);
+    roc_cond_signal(&sched->cond);
+    pthread_mutex_unlock(&sched->lock);
+}
 
-    while (sched->running) {
+// release() on a watched node: wake the dispatcher only if it is asleep
+static void capacity_released(RNode* node, void* arg) {
+    (void)node;
+    RTaskScheduler* sched = (RTaskScheduler*)arg;
+    atomic_store(&sched->dirty, 1);
+    if (atomic_load(&sched->sleeping)) {
         pthread_mutex_lock(&sched->lock);
-        while (sched->count == 0 && sched->running)
-            pthread_cond_wait(&sched->cond, &sched->lock);
+        roc_cond_signal(&sched->cond);
+        pthread_mutex_unlock(&sched->lock);
+    }
+}
 
-        int idx = find_highest_priority(sched);
-        if (idx != -1) {
-            RTask* task = sched->queue[idx];
+// Caller holds sched->lock. Watches stay until the scheduler is destroyed.
+static void watch_nodes(RTaskScheduler* sched, NodeDemand* d, int count) {
+    for (int i = 0; i < count; i++) {
+        int j;
+        for (j = 0; j < sched->watch_count; j++)
+            if (sched->watched[j] == d[i].node) break;
+        if (j < sched->watch_count) continue;
 
-            // Remove task from queue
-            for (int i = idx; i < sched->count - 1; i++)
-                sched->queue[i] = sched->queue[i + 1];
-            sched->count--;
+        if (sched->watch_count == sched->watch_capacity) {
+            int cap = sched->watch_capacity ? sched->watch_capacity * 2 : 16;
+            RNodeWatcher** watches = realloc(sched->watches, cap * sizeof(RNodeWatcher*));
+            RNode** watched = realloc(sched->watched, cap * sizeof(RNode*));
+            if (watches) sched->watches = watches;
+            if (watched) sched->watched = watched;
+            if (!watches || !watched) return;
+            sched->watch_capacity = cap;
+        }
+        RNodeWatcher* w = node_watch(d[i].node, capacity_released, sched);
+        if (!w) return;
+        sched->watches[sched->watch_count] = w;
+        sched->watched[sched->watch_count] = d[i].node;
+        sched->watch_count++;
+    }
+}
 
-            pthread_mutex_unlock(&sched->lock);
+static void fail_task(RTask* task, const char* why) {
+    ROC_WARN("[Scheduler] Task '%s' %s.\n", task->name, why);
+    task_finish(task, TASK_FAILED);
+}
+
+// An allocated task that never ran: give its resources back, then fail it
+static void abandon_task(RTask* task, const char* why) {
+    deallocate_task(task);
+    fail_task(task, why);
+}
+
+// Caller holds sched->lock. Room for n more running tasks.
+static int grow_active(RTaskScheduler* sched, int n) {
+    if (sched->active_count + n <= sched->active_capacity) return 1;
+    int cap = sched->active_capacity ? sched->active_capacity : 64;
+    while (cap < sched->active_count + n) cap *= 2;
+    RSchedActive* active = realloc(sched->active, cap * sizeof(RSchedActive));
+    if (!active) return 0;
+    sched->active = active;
+    sched->active_capacity = cap;
+    return 1;
+}
+
+// Caller holds sched->lock and has made room with grow_active
+static void track(RTaskScheduler* sched, RTask* task, const RHeapItem* entry, long long now, int in_gang) {
+    task->sched_slot = sched->active_count;
+    sched->active[sched->active_count].task = task;
+    charge(sched, task, 1);
+    sched->active[sched->active_count].end_us = now + task_estimate_us(task);
+    sched->active[sched->active_count].in_gang = in_gang;
+    sched->active[sched->active_count].entry = *entry;
+    sched->active_count++;
+
+    task->on_done = task_finished;
+    task->done_arg = sched;
+}
+
+static void untrack(RTaskScheduler* sched, RTask* task) {
+    charge(sched, task, -1);
+    remove_active(sched, task);
+}
 
-            // Run task in its own thread (allocates resources internally)
-            if (!run_task(task)) {
-                printf("[Scheduler] Failed to run task '%s'.\n", task->name);
+// Caller holds sched->lock; the task's resources are already reserved
+static int dispatch(RTaskScheduler* sched, const RHeapItem* entry, long long now) {
+    RTask* task = (RTask*)entry->data;
+    if (!grow_active(sched, 1)) {
+        abandon_task(task, "could not be tracked (out of memory)");
+        return 0;
+    }
+    track(sched, task, entry, now, 0);
+    if (!start_task_on(sched->pool, task)) {
+        untrack(sched, task);
+        abandon_task(task, "could not be started");
+        return 0;
+    }
+    return 1;
+}
+
+// Fail a queue entry; members of a gang that already ran are left alone
+static void fail_unit(RTask* task, const char* why) {
+    RGang* gang = take_gang(task);
+    if (!gang) {
+        fail_task(task, why);
+        return;
+    }
+    for (int i = 0; i < gang->count; i++)
+        if (task_status(gang->tasks[i]) == TASK_PENDING) fail_task(gang->tasks[i], why);
+    free(gang);
+}
+
+// Every member is allocated. A gang is started by one pool job, so if it
+// cannot be tracked or queued no member has run and the whole gang fails.
+static int dispatch_unit(RTaskScheduler* sched, const RHeapItem* entry, long long now) {
+    RGang* gang = take_gang((RTask*)entry->data);
+    if (!gang) return dispatch(sched, entry, now);
+
+    int ok = grow_active(sched, gang->count);
+    if (ok) {
+        for (int i = 0; i < gang->count; i++)
+            track(sched, gang->tasks[i], entry, now, 1);
+        ok = start_tasks_on(sched->pool, gang->tasks, gang->count);
+        if (!ok) {
+            for (int i = 0; i < gang->count; i++)
+                untrack(sched, gang->tasks[i]);
+        }
+    }
+    if (!ok) {
+        for (int i = 0; i < gang->count; i++)
+            abandon_task(gang->tasks[i], "belongs to a gang that could not be started");
+    }
+    free(gang);
+    return ok;
+}
+
+// =====================
+// Preemption
+// =====================
+static int task_waiting(RTask* task) {
+    TaskStatus s = task_status(task);
+    return s == TASK_PENDING || s == TASK_PREEMPTED;
+}
+
+// The deadline class outranks every priority class
+static int outranks(RTask* head, RTask* victim) {
+    if (victim->deadline_us) return 0;
+    return head->deadline_us || victim->priority < head->priority;
+}
+
+// Units a running task would free toward the remaining shortfall
+static int victim_gain(RTask* t, NodeDemand* d, int count, int* shortfall) {
+    int gain = 0;
+    for (int k = 0; k < t->resource_count; k++) {
+        NodeDemand* h = find_demand(d, count, t->resources[k].node);
+        if (!h) continue;
+        int s = shortfall[h - d];
+        if (s > 0) gain += t->resources[k].amount < s ? t->resources[k].amount : s;
+    }
+    return gain;
+}
+
+static void apply_victim(RTask* t, NodeDemand* d, int count, int* shortfall, int sign) {
+    for (int k = 0; k < t->resource_count; k++) {
+        NodeDemand* h = find_demand(d, count, t->resources[k].node);
+        if (h) shortfall[h - d] -= sign * t->resources[k].amount;
+    }
+}
+
+static int covered(int* shortfall, int count) {
+    for (int j = 0; j < count; j++)
+        if (shortfall[j] > 0) return 0;
+    return 1;
+}
+
+// Greedy, lowest priority first and then the largest gain, followed by a
+// pruning pass so that no chosen victim could be spared. Returns the
+// number of victims, 0 if lower-priority tasks cannot free enough.
+// Caller holds sched->lock.
+static int pick_victims(RTaskScheduler* sched, RTask* head, NodeDemand* d, int count, RTask** victims) {
+    int shortfall[SCHED_UNIT_DEMAND];
+    for (int j = 0; j < count; j++) shortfall[j] = d[j].need - monitor(d[j].node);
+
+    int n = 0;
+    while (!covered(shortfall, count)) {
+        RTask* best = NULL;
+        int best_gain = 0;
+        for (int i = 0; i < sched->active_count; i++) {
+            RTask* t = sched->active[i].task;
+            if (sched->active[i].in_gang || !outranks(head, t)) continue;
+            int chosen = 0;
+            for (int v = 0; v < n && !chosen; v++) chosen = victims[v] == t;
+            if (chosen) continue;
+
+            int gain = victim_gain(t, d, count, shortfall);
+            if (gain == 0) continue;
+            if (!best || t->priority < best->priority || (t->priority == best->priority && gain > best_gain)) {
+                best = t;
+                best_gain = gain;
             }
+        }
+        if (!best) return 0;
+        victims[n++] = best;
+        apply_victim(best, d, count, shortfall, 1);
+    }
 
+    for (int v = n - 1; v >= 0; v--) {
+        apply_victim(victims[v], d, count, shortfall, -1);
+        if (covered(shortfall, count)) {
+            victims[v] = victims[--n];
         } else {
+            apply_victim(victims[v], d, count, shortfall, 1);
+        }
+    }
+    return n;
+}
+
+// Evict victims for a blocked head; returns how many were stopped (a victim
+// already finishing is left to finish). Their on_evict hooks may call into
+// the scheduler, so victims are only collected here with their queue
+// entries: the dispatcher runs the hooks after unlocking, then queues each
+// victim again in the place it started from. Caller holds sched->lock.
+static int preempt_for(RTaskScheduler* sched, RTask* head, NodeDemand* d, int count) {
+    if (sched->active_count == 0) return 0;
+    RTask** victims = (RTask**)malloc(sched->active_count * sizeof(RTask*));
+    if (!victims) return 0;
+    int n = pick_victims(sched, head, d, count, victims);
+    if (sched->evicted_count + n > sched->evicted_capacity) {
+        int cap = sched->evicted_count + n;
+        RHeapItem* evicted = realloc(sched->evicted, cap * sizeof(RHeapItem));
+        if (!evicted) {
+            free(victims);
+            return 0;
+        }
+        sched->evicted = evicted;
+        sched->evicted_capacity = cap;
+    }
+
+    int stopped = 0;
+    for (int v = 0; v < n; v++) {
+        RTask* t = victims[v];
+        if (!task_suspend(t)) continue;
+        sched->evicted[sched->evicted_count++] = sched->active[t->sched_slot].entry;
+        untrack(sched, t);
+        stopped++;
+        ROC_INFO("[Scheduler] Task '%s' preempted for '%s'.\n", t->name, head->name);
+    }
+    free(victims);
+    return stopped;
+}
+
+// One pass over the queue; tasks left waiting get their nodes watched.
+// Caller holds sched->lock.
+static void schedule_pass(RTaskScheduler* sched) {
+    RHeapItem kept[SCHED_BACKFILL_DEPTH + 1];
+    int kept_count = 0;
+    int have_head = 0;
+    HeadReservation r;
+    long long now = roc_now_us();
+
+    RHeapItem item;
+    while (kept_count <= SCHED_BACKFILL_DEPTH && next_entry(sched, &item)) {
+        RTask* task = (RTask*)item.data;
+        RTask** tasks = task->gang ? task->gang->tasks : &task;
+        int n = task->gang ? task->gang->count : 1;
+
+        int pending = 0;
+        for (int i = 0; i < n; i++)
+            if (task_waiting(tasks[i])) pending++;
+        if (pending < n) {   // started elsewhere
+            if (task->gang) fail_unit(task, "belongs to a gang that was partly started elsewhere");
+            continue;
+        }
+
+        NodeDemand d[SCHED_UNIT_DEMAND];
+        int count = unit_demand(tasks, n, d);
+        if (count < 0) {
+            fail_unit(task, "names too many distinct nodes");
+            continue;
+        }
+        if (!fits_ever(d, count) || !placeable(sched, tasks, n)) {
+            fail_unit(task, "can never fit its resource requirements");
+            continue;
+        }
+        long long est = unit_estimate(tasks, n);
+
+        if (!have_head) {
+            if (fits_now(d, count) && try_allocate_unit(sched, tasks, n)) {
+                dispatch_unit(sched, &item, now);
+                continue;
+            }
+            if (sched->preemption && preempt_for(sched, task, d, count) &&
+                fits_now(d, count) && try_allocate_unit(sched, tasks, n)) {
+                dispatch_unit(sched, &item, now);
+                continue;
+            }
+            have_head = 1;
+            reserve_for_head(sched, d, count, &r);
+        } else if (can_backfill(&r, est, d, count, now) && try_allocate_unit(sched, tasks, n)) {
+            take_extra(&r, est, d, count, now);
+            dispatch_unit(sched, &item, now);
+            continue;
+        }
+        watch_nodes(sched, d, count);
+        kept[kept_count++] = item;
+    }
+
+    // Put examined tasks back in their original order; their owners exist
+    for (int i = 0; i < kept_count; i++)
+        queue_entry(sched, (RTask*)kept[i].data, &kept[i]);
+}
+
+// =====================
+// Scheduler thread
+// =====================
+// Move everything submitted so far into the priority heap.
+// Caller holds sched->lock.
+static void drain_intake(RTaskScheduler* sched) {
+    RMpscNode* n;
+    while ((n = mpsc_pop(&sched->intake)) != NULL) {
+        RTask* task = (RTask*)((char*)n - offsetof(RTask, intake));
+        if (task->deadline_us) {
+            if (!admit_deadline(sched, task)) {
+                sched->deadline_stats.rejected++;
+                fail_unit(task, "cannot meet its deadline");
+                continue;
+            }
+            sched->deadline_stats.admitted++;
+        }
+        if (!queue_entry(sched, task, NULL)) {
+            fail_unit(task, "could not be queued (out of memory)");
+            continue;
+        }
+        if (task->gang) note_capacity(sched, task->gang->tasks, task->gang->count);
+        else note_capacity(sched, &task, 1);
+    }
+}
+
+static void* scheduler_thread(void* arg) {
+    RTaskScheduler* sched = (RTaskScheduler*)arg;
+
+    pthread_mutex_lock(&sched->lock);
+    while (sched->running) {
+        atomic_store(&sched->dirty, 0);
+        drain_intake(sched);
+        schedule_pass(sched);
+
+        // Victims stay out of the queue until their hooks have run, so
+        // none of them can be started again with its hook still pending
+        if (sched->evicted_count > 0) {
+            int n = sched->evicted_count;
+            RHeapItem* evicted = sched->evicted;
+            sched->evicted = NULL;
+            sched->evicted_count = 0;
+            sched->evicted_capacity = 0;
             pthread_mutex_unlock(&sched->lock);
-            usleep(10000); // 10ms idle
+            for (int i = 0; i < n; i++)
+                task_notify_evict((RTask*)evicted[i].data);
+            pthread_mutex_lock(&sched->lock);
+            for (int i = 0; i < n; i++) {
+                RTask* t = (RTask*)evicted[i].data;
+                if (!queue_entry(sched, t, &evicted[i])) fail_task(t, "could not be requeued (out of memory)");
+            }
+            free(evicted);
+            continue;
         }
+
+        // Announce the sleep before the final checks; watchers set dirty
+        // and producers push first, and only take the lock when they see
+        // the flag. A push still in flight keeps the intake non-empty.
+        atomic_store(&sched->sleeping, 1);
+        if (sched->running && !atomic_load(&sched->dirty) && mpsc_empty(&sched->intake))
+            roc_cond_wait(&sched->cond, &sched->lock);
+        atomic_store(&sched->sleeping, 0);
     }
+    pthread_mutex_unlock(&sched->lock);
     return NULL;
 }
 
@@ -58,9 +897,41 @@ static void* scheduler_thread(void* arg) {
 // Scheduler API
 // =====================
 RTaskScheduler* create_scheduler() {
+    return create_scheduler_workers(0, 0);
+}
+
+RTaskScheduler* create_scheduler_workers(int workers, int pin_cpus) {
     RTaskScheduler* sched = (RTaskScheduler*)malloc(sizeof(RTaskScheduler));
-    sched->count = 0;
+    mpsc_init(&sched->intake);
+    heap_init(&sched->deadlines);
+    memset(&sched->deadline_stats, 0, sizeof(sched->deadline_stats));
+    sched->owners = NULL;
+    sched->owner_count = 0;
+    sched->ready = NULL;
+    sched->ready_count = 0;
+    sched->type_count = 0;
+    sched->totals_fixed = 0;
+    sched->active = NULL;
+    sched->active_count = 0;
+    sched->active_capacity = 0;
+    sched->evicted = NULL;
+    sched->evicted_count = 0;
+    sched->evicted_capacity = 0;
+    sched->watches = NULL;
+    sched->watched = NULL;
+    sched->watch_count = 0;
+    sched->watch_capacity = 0;
+    atomic_init(&sched->dirty, 0);
+    atomic_init(&sched->sleeping, 0);
+    sched->packing = SCHED_PACK_GANGS_FIRST;
+    sched->preemption = 0;
+    sched->placement = NULL;
     sched->running = 0;
+    sched->pool = create_worker_pool(workers, pin_cpus);
+    if (!sched->pool) {
+        free(sched);
+        return NULL;
+    }
     pthread_mutex_init(&sched->lock, NULL);
     pthread_cond_init(&sched->cond, NULL);
     return sched;
@@ -68,28 +939,125 @@ RTaskScheduler* create_scheduler() {
 
 void destroy_scheduler(RTaskScheduler* sched) {
     scheduler_stop(sched);
+    destroy_worker_pool(sched->pool);
+    // Tasks cut off mid-run must not call back into the freed scheduler
+    for (int i = 0; i < sched->active_count; i++) {
+        sched->active[i].task->on_done = NULL;
+        sched->active[i].task->done_arg = NULL;
+    }
+    for (int i = 0; i < sched->watch_count; i++)
+        node_unwatch(sched->watches[i]);
+    if (sched->placement) placement_set_listener(sched->placement, NULL, NULL);
+
+    // Tasks never started stay pending; only gang wrappers are ours
+    RHeapItem item;
+    drain_intake(sched);
+    while (next_entry(sched, &item))
+        free(take_gang((RTask*)item.data));
+    heap_free(&sched->deadlines);
+    for (int i = 0; i < sched->owner_count; i++)
+        heap_free(&sched->owners[i].queue);
+    free(sched->owners);
+    free(sched->ready);
+    free(sched->active);
+    free(sched->evicted);
+    free(sched->watches);
+    free(sched->watched);
     pthread_mutex_destroy(&sched->lock);
     pthread_cond_destroy(&sched->cond);
     free(sched);
 }
 
 int scheduler_add_task(RTaskScheduler* sched, RTask* task) {
-    pthread_mutex_lock(&sched->lock);
-    if (sched->count >= MAX_TASK_QUEUE) {
+    // Only a push into an empty intake can find the dispatcher asleep:
+    // otherwise an earlier push is still waiting to be drained
+    if (mpsc_push(&sched->intake, &task->intake) && atomic_load(&sched->sleeping)) {
+        pthread_mutex_lock(&sched->lock);
+        roc_cond_signal(&sched->cond);
         pthread_mutex_unlock(&sched->lock);
-        return 0;
     }
-    sched->queue[sched->count++] = task;
-    pthread_cond_signal(&sched->cond);
-    pthread_mutex_unlock(&sched->lock);
     return 1;
 }
 
+int scheduler_add_gang(RTaskScheduler* sched, RTask** tasks, int count) {
+    if (count <= 0 || count > SCHED_GANG_MAX) return 0;
+    if (count == 1) return scheduler_add_task(sched, tasks[0]);
+
+    RGang* gang = (RGang*)malloc(sizeof(RGang));
+    if (!gang) return 0;
+    gang->count = count;
+    gang->units = 0;
+    for (int i = 0; i < count; i++) {
+        gang->tasks[i] = tasks[i];
+        for (int k = 0; k < tasks[i]->resource_count; k++)
+            gang->units += tasks[i]->resources[k].amount;
+    }
+    tasks[0]->gang = gang;
+    return scheduler_add_task(sched, tasks[0]);
+}
+
+void scheduler_set_packing(RTaskScheduler* sched, SchedPacking packing) {
+    pthread_mutex_lock(&sched->lock);
+    sched->packing = packing;
+    pthread_mutex_unlock(&sched->lock);
+}
+
+void scheduler_set_preemption(RTaskScheduler* sched, int on) {
+    pthread_mutex_lock(&sched->lock);
+    sched->preemption = on;
+    pthread_mutex_unlock(&sched->lock);
+}
+
+void scheduler_set_placement(RTaskScheduler* sched, RPlacement* p) {
+    pthread_mutex_lock(&sched->lock);
+    sched->placement = p;
+    pthread_mutex_unlock(&sched->lock);
+    // Any release may let a waiting unbound task fit
+    if (p) placement_set_listener(p, capacity_released, sched);
+}
+
+void scheduler_deadline_stats(RTaskScheduler* sched, RSchedDeadlineStats* out) {
+    pthread_mutex_lock(&sched->lock);
+    *out = sched->deadline_stats;
+    pthread_mutex_unlock(&sched->lock);
+}
+
+int scheduler_set_owner_weight(RTaskScheduler* sched, int owner, double weight) {
+    if (owner < 0 || owner >= SCHED_OWNER_MAX || !(weight > 0.0)) return 0;
+    pthread_mutex_lock(&sched->lock);
+    int ok = ensure_owner(sched, owner);
+    if (ok) {
+        sched->owners[owner].weight = weight;
+        owner_changed(sched, owner);
+    }
+    pthread_mutex_unlock(&sched->lock);
+    return ok;
+}
+
+double scheduler_owner_share(RTaskScheduler* sched, int owner) {
+    pthread_mutex_lock(&sched->lock);
+    double share = (owner >= 0 && owner < sched->owner_count) ? sched->owners[owner].share : 0.0;
+    pthread_mutex_unlock(&sched->lock);
+    return share;
+}
+
+void scheduler_set_network(RTaskScheduler* sched, RNetwork* net) {
+    pthread_mutex_lock(&sched->lock);
+    for (int t = 0; t < sched->type_count; t++) sched->type_total[t] = 0;
+    for (int i = 0; i < net->node_count; i++) {
+        int t = type_index(sched, net->nodes[i]->type);
+        if (t >= 0) sched->type_total[t] += net->nodes[i]->capacity;
+    }
+    sched->totals_fixed = 1;
+    shares_rebuilt(sched);
+    pthread_mutex_unlock(&sched->lock);
+}
+
 void scheduler_start(RTaskScheduler* sched) {
     pthread_mutex_lock(&sched->lock);
     if (!sched->running) {
         sched->running = 1;
-        pthread_create(&sched->thread, NULL, scheduler_thread, sched);
+        roc_thread_spawn(&sched->thread, scheduler_thread, sched);
     }
     pthread_mutex_unlock(&sched->lock);
 }
@@ -98,9 +1066,9 @@ void scheduler_stop(RTaskScheduler* sched) {
     pthread_mutex_lock(&sched->lock);
     if (sched->running) {
         sched->running = 0;
-        pthread_cond_signal(&sched->cond);
+        roc_cond_signal(&sched->cond);
         pthread_mutex_unlock(&sched->lock);
-        pthread_join(sched->thread, NULL);
+        roc_thread_join(sched->thread);
     } else {
         pthread_mutex_unlock(&sched->lock);
     }
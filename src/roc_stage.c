@@ -1,6 +1,7 @@
 #include "roc_stage.h"
 #include "roc_workflow.h"
 #include "roc_job.h"
+#include "roc_clock.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,12 +12,17 @@ RStage* create_stage(const char* name, int priority) {
     stage->item_count = 0;
     stage->priority = priority;
     stage->status = STAGE_PENDING;
+    stage->pending = 0;
+    stage->hooks = NULL;
     pthread_mutex_init(&stage->lock, NULL);
+    pthread_cond_init(&stage->done, NULL);
     return stage;
 }
 
 void destroy_stage(RStage* stage) {
+    completion_hooks_free(stage->hooks);
     pthread_mutex_destroy(&stage->lock);
+    pthread_cond_destroy(&stage->done);
     free(stage);
 }
 
@@ -33,8 +39,8 @@ int stage_add_item(RStage* stage, void* item, StageItemType type) {
     return 1;
 }
 
-static void update_stage_status(RStage* stage) {
-    pthread_mutex_lock(&stage->lock);
+// Derive the stage status from its items; caller holds stage->lock
+static void compute_stage_status(RStage* stage) {
     int all_completed = 1;
     int any_failed = 0;
 
@@ -48,26 +54,78 @@ static void update_stage_status(RStage* stage) {
             WorkflowStatus ws = workflow_status((RWorkflow*)si->item);
             if (ws != WORKFLOW_COMPLETED) all_completed = 0;
             if (ws == WORKFLOW_FAILED) any_failed = 1;
+        } else if (si->type == STAGE_ITEM_TASK) {
+            TaskStatus ts = task_status((RTask*)si->item);
+            if (ts != TASK_COMPLETED) all_completed = 0;
+            if (ts == TASK_FAILED) any_failed = 1;
         }
     }
 
     if (any_failed) stage->status = STAGE_FAILED;
     else if (all_completed) stage->status = STAGE_COMPLETED;
     else stage->status = STAGE_RUNNING;
+}
 
+static void update_stage_status(RStage* stage) {
+    pthread_mutex_lock(&stage->lock);
+    compute_stage_status(stage);
     pthread_mutex_unlock(&stage->lock);
 }
 
+// Completion callback on each item of a running stage
+static void stage_item_done(void* item, void* arg) {
+    (void)item;
+    RStage* stage = (RStage*)arg;
+    RCompletionHook* hooks = NULL;
+
+    pthread_mutex_lock(&stage->lock);
+    if (--stage->pending == 0) {
+        compute_stage_status(stage);
+        hooks = stage->hooks;
+        stage->hooks = NULL;
+        roc_cond_broadcast(&stage->done);
+    }
+    pthread_mutex_unlock(&stage->lock);
+    completion_hooks_run(hooks, stage);
+}
+
+// Start one item; returns 0 if it is not tracked by the run
+static int stage_start_item(RStage* stage, StageItem* si, RTaskScheduler* sched) {
+    switch (si->type) {
+        case STAGE_ITEM_JOB:
+            job_run((RJob*)si->item, sched);
+            return job_on_complete((RJob*)si->item, stage_item_done, stage);
+        case STAGE_ITEM_WORKFLOW:
+            workflow_run((RWorkflow*)si->item, sched);
+            return workflow_on_complete((RWorkflow*)si->item, stage_item_done, stage);
+        case STAGE_ITEM_TASK:
+            if (!task_on_complete((RTask*)si->item, stage_item_done, stage)) return 0;
+            if (!scheduler_add_task(sched, (RTask*)si->item))
+                task_finish((RTask*)si->item, TASK_FAILED);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
 int stage_run(RStage* stage, RTaskScheduler* sched) {
     pthread_mutex_lock(&stage->lock);
+    if (stage->pending > 0) {
+        pthread_mutex_unlock(&stage->lock);
+        return 0;
+    }
     stage->status = STAGE_RUNNING;
+    // One extra count held by this call, so items that finish while
+    // others are still being started cannot end the run early
+    stage->pending = stage->item_count + 1;
+    int count = stage->item_count;
     pthread_mutex_unlock(&stage->lock);
 
-    for (int i = 0; i < stage->item_count; i++) {
-        StageItem* si = &stage->items[i];
-        if (si->type == STAGE_ITEM_JOB) job_run((RJob*)si->item, sched);
-        else if (si->type == STAGE_ITEM_WORKFLOW) workflow_run((RWorkflow*)si->item, sched);
+    for (int i = 0; i < count; i++) {
+        if (!stage_start_item(stage, &stage->items[i], sched))
+            stage_item_done(NULL, stage);
     }
+    stage_item_done(NULL, stage);
     return 1;
 }
 
@@ -79,3 +137,23 @@ StageStatus stage_status(RStage* stage) {
     pthread_mutex_unlock(&stage->lock);
     return s;
 }
+
+StageStatus stage_wait(RStage* stage) {
+    pthread_mutex_lock(&stage->lock);
+    while (stage->pending > 0)
+        roc_cond_wait(&stage->done, &stage->lock);
+    pthread_mutex_unlock(&stage->lock);
+    return stage_status(stage);
+}
+
+int stage_on_complete(RStage* stage, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&stage->lock);
+    if (stage->pending > 0) {
+        int ok = completion_hook_add(&stage->hooks, fn, arg);
+        pthread_mutex_unlock(&stage->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&stage->lock);
+    fn(stage, arg);
+    return 1;
+}
@@ -1,5 +1,5 @@
-#include <windows.h>
 #include "roc_stage_queue.h"
+#include "roc_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,14 +35,12 @@ int stage_queue_run(RStageQueue* queue, RTaskScheduler* sched) {
     pthread_mutex_unlock(&queue->lock);
 
     for (int i = 0; i < count; i++) {
-        printf("[StageQueue] Starting stage '%s'\n", queue->stages[i]->name);
+        ROC_INFO("[StageQueue] Starting stage '%s'\n", queue->stages[i]->name);
         stage_run(queue->stages[i], sched);
 
         // Wait until stage completes
-        while (stage_status(queue->stages[i]) != STAGE_COMPLETED) {
-            Sleep(50);
-        }
-        printf("[StageQueue] Stage '%s' completed\n", queue->stages[i]->name);
+        stage_wait(queue->stages[i]);
+        ROC_INFO("[StageQueue] Stage '%s' completed\n", queue->stages[i]->name);
     }
     return 1;
 }
@@ -7,6 +7,7 @@ const char* task_status_str(TaskStatus status) {
         case TASK_RUNNING:   return "RUNNING";
         case TASK_COMPLETED: return "COMPLETED";
         case TASK_FAILED:    return "FAILED";
+        case TASK_PREEMPTED: return "PREEMPTED";
         default:             return "UNKNOWN";
     }
 }
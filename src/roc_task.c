@@ -1,38 +1,195 @@
 #include "roc_task.h"
+#include "roc_clock.h"
+#include "roc_trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#ifdef _WIN32
+#include <malloc.h>          // _aligned_malloc
+#endif
+
+// =====================
+// Task pool
+// =====================
+// Free tasks keep their mutex and condition variable initialized, so a
+// recycled task only needs its fields reset.
+typedef struct {
+    RTask* head;
+    int count;
+} TaskCache;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static RTask* pool_free;     // shared free list, batches from thread caches
+
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static _Thread_local TaskCache cache;
+static _Thread_local int cache_registered;
+
+// Move up to n tasks from the front of *list onto the shared list
+static void pool_give(RTask** list, int* count, int n) {
+    if (!*list || n <= 0) return;
+    RTask* first = *list;
+    RTask* last = first;
+    int moved = 1;
+    while (moved < n && last->next_free) {
+        last = last->next_free;
+        moved++;
+    }
+    *list = last->next_free;
+    *count -= moved;
+
+    pthread_mutex_lock(&pool_lock);
+    last->next_free = pool_free;
+    pool_free = first;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+// An exiting thread hands its cache back
+static void cache_flush(void* arg) {
+    TaskCache* c = (TaskCache*)arg;
+    pool_give(&c->head, &c->count, c->count);
+}
+
+static void make_cache_key(void) {
+    pthread_key_create(&cache_key, cache_flush);
+}
+
+static TaskCache* thread_cache(void) {
+    if (!cache_registered) {
+        pthread_once(&cache_once, make_cache_key);
+        pthread_setspecific(cache_key, &cache);
+        cache_registered = 1;
+    }
+    return &cache;
+}
+
+static int cache_refill(TaskCache* c) {
+    pthread_mutex_lock(&pool_lock);
+    while (pool_free && c->count < TASK_CACHE_SIZE / 2) {
+        RTask* t = pool_free;
+        pool_free = t->next_free;
+        t->next_free = c->head;
+        c->head = t;
+        c->count++;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    if (c->head) return 1;
+
+#ifdef _WIN32
+    RTask* slab = (RTask*)_aligned_malloc(TASK_SLAB_SIZE * sizeof(RTask), ROC_CACHE_LINE);
+#else
+    RTask* slab = (RTask*)aligned_alloc(ROC_CACHE_LINE, TASK_SLAB_SIZE * sizeof(RTask));
+#endif
+    if (!slab) return 0;
+    for (int i = 0; i < TASK_SLAB_SIZE; i++) {
+        pthread_mutex_init(&slab[i].lock, NULL);
+        pthread_cond_init(&slab[i].done, NULL);
+        slab[i].next_free = c->head;
+        c->head = &slab[i];
+    }
+    c->count += TASK_SLAB_SIZE;
+    return 1;
+}
+
+static RTask* task_alloc(void) {
+    TaskCache* c = thread_cache();
+    if (!c->head && !cache_refill(c)) return NULL;
+    RTask* task = c->head;
+    c->head = task->next_free;
+    c->count--;
+    return task;
+}
+
+static void task_free(RTask* task) {
+    TaskCache* c = thread_cache();
+    task->next_free = c->head;
+    c->head = task;
+    if (++c->count > TASK_CACHE_SIZE)
+        pool_give(&c->head, &c->count, TASK_CACHE_SIZE / 2);
+}
 
 // =====================
 // Task operations
 // =====================
 RTask* create_task(const char* name, int priority) {
-    RTask* task = (RTask*)malloc(sizeof(RTask));
+    RTask* task = task_alloc();
+    if (!task) return NULL;
     strcpy(task->name, name);
     task->resource_count = 0;
+    task->resources = task->inline_resources;
+    task->resource_capacity = TASK_INLINE_RESOURCES;
     task->priority = priority;
+    task->owner = 0;
     task->status = TASK_PENDING;
-    pthread_mutex_init(&task->lock, NULL);
+    task->pool = NULL;
+    task->on_done = NULL;
+    task->done_arg = NULL;
+    task->on_evict = NULL;
+    task->evict_arg = NULL;
+    task->progress_us = 0;
+    task->run_start_us = 0;
+    task->deadline_us = 0;
+    task->sched_slot = -1;
+    task->hooks = NULL;
+    task->finishing = 0;
+    task->gang = NULL;
     return task;
 }
 
 void destroy_task(RTask* task) {
-    pthread_mutex_destroy(&task->lock);
-    free(task);
+    completion_hooks_free(task->hooks);
+    if (task->resources != task->inline_resources) free(task->resources);
+    task_free(task);
+}
+
+// Caller holds task->lock. Requirements spill from the inline slots to the heap.
+static TaskResourceReq* next_req(RTask* task) {
+    if (task->resource_count == task->resource_capacity) {
+        int cap = task->resource_capacity * 2;
+        TaskResourceReq* grown;
+        if (task->resources == task->inline_resources) {
+            grown = (TaskResourceReq*)malloc(cap * sizeof(TaskResourceReq));
+            if (grown) memcpy(grown, task->inline_resources, sizeof(task->inline_resources));
+        } else {
+            grown = (TaskResourceReq*)realloc(task->resources, cap * sizeof(TaskResourceReq));
+        }
+        if (!grown) return NULL;
+        task->resources = grown;
+        task->resource_capacity = cap;
+    }
+    TaskResourceReq* r = &task->resources[task->resource_count++];
+    memset(r, 0, sizeof(*r));
+    return r;
 }
 
 int add_resource_req(RTask* task, RNode* node, int amount) {
     pthread_mutex_lock(&task->lock);
-    if (task->resource_count >= MAX_RESOURCES_PER_TASK) {
-        pthread_mutex_unlock(&task->lock);
-        return 0;
+    TaskResourceReq* r = next_req(task);
+    if (r) {
+        r->node = node;
+        r->amount = amount;
     }
-    task->resources[task->resource_count].node = node;
-    task->resources[task->resource_count].amount = amount;
-    task->resource_count++;
     pthread_mutex_unlock(&task->lock);
-    return 1;
+    return r != NULL;
+}
+
+int add_resource_any(RTask* task, const char* type, int amount, int group) {
+    pthread_mutex_lock(&task->lock);
+    TaskResourceReq* r = next_req(task);
+    if (r) {
+        r->amount = amount;
+        r->group = group;
+        if (type) snprintf(r->type, sizeof(r->type), "%s", type);
+    }
+    pthread_mutex_unlock(&task->lock);
+    return r != NULL;
+}
+
+int task_needs_placement(RTask* task) {
+    for (int i = 0; i < task->resource_count; i++)
+        if (!task->resources[i].node || task->resources[i].placed) return 1;
+    return 0;
 }
 
 int remove_resource_req(RTask* task, int index) {
@@ -48,17 +205,19 @@ int remove_resource_req(RTask* task, int index) {
     return 1;
 }
 
-// Reserve all resources for a task
-int allocate_task(RTask* task) {
+// Reserve all resources for a task. On failure, TASK_FAILED fails the
+// task; otherwise its status is left as it was.
+static int reserve_task(RTask* task, TaskStatus fail_status) {
     pthread_mutex_lock(&task->lock);
     for (int i = 0; i < task->resource_count; i++) {
         TaskResourceReq* r = &task->resources[i];
-        if (!reserve(r->node, r->amount)) {
-            // Rollback any previous reservations
-            for (int j = 0; j < i; j++)
-                release(task->resources[j].node, task->resources[j].amount);
-            task->status = TASK_FAILED;
+        // An unbound requirement cannot be reserved until it is placed
+        if (!r->node || !reserve(r->node, r->amount)) {
+            // Rollback any previous reservations, unlocked as in release_resources
+            TaskResourceReq* held = task->resources;
             pthread_mutex_unlock(&task->lock);
+            for (int j = 0; j < i; j++) release(held[j].node, held[j].amount);
+            if (fail_status == TASK_FAILED) task_finish(task, TASK_FAILED);
             return 0;
         }
     }
@@ -67,62 +226,203 @@ int allocate_task(RTask* task) {
     return 1;
 }
 
-// Release all resources
-void release_task(RTask* task) {
+int allocate_task(RTask* task) {
+    return reserve_task(task, TASK_FAILED);
+}
+
+int try_allocate_task(RTask* task) {
+    return reserve_task(task, TASK_PENDING);
+}
+
+// Released outside the task lock: release() may wake the scheduler, which
+// takes task locks under its own. Requirements do not change while a task
+// holds its resources, so they are read in place.
+static void release_resources(RTask* task) {
     pthread_mutex_lock(&task->lock);
-    for (int i = 0; i < task->resource_count; i++)
-        release(task->resources[i].node, task->resources[i].amount);
-    task->status = TASK_COMPLETED;
+    TaskResourceReq* held = task->resources;
+    int count = task->resource_count;
     pthread_mutex_unlock(&task->lock);
+    for (int i = 0; i < count; i++) release(held[i].node, held[i].amount);
+}
+
+void deallocate_task(RTask* task) {
+    release_resources(task);
+    pthread_mutex_lock(&task->lock);
+    task->status = TASK_PENDING;
+    pthread_mutex_unlock(&task->lock);
+}
+
+// Release all resources
+void release_task(RTask* task) {
+    release_resources(task);
+    task_finish(task, TASK_COMPLETED);
 }
 
 // =====================
-// Internal thread function
+// Internal pool jobs
 // =====================
-static void* run_task_thread(void* arg) {
-    RTask* task = (RTask*)arg;
-
+static int task_units(RTask* task) {
     int total_units = 0;
     for (int i = 0; i < task->resource_count; i++)
         total_units += task->resources[i].amount;
+    return total_units;
+}
+
+// Traced against the first node the task holds
+static int task_trace_node(RTask* task) {
+    return task->resource_count > 0 && task->resources[0].node ? task->resources[0].node->id : -1;
+}
+
+long long task_estimate_us(RTask* task) {
+    long long left = task_units(task) * 200000LL - task->progress_us;
+    return left > 0 ? left : 0;
+}
+
+static void finish_task_job(void* arg) {
+    RTask* task = (RTask*)arg;
+    task->progress_us = 0;   // a later run starts over
+    release_resources(task);
+    ROC_TRACE_EVENT(TRACE_TASK_END, task_trace_node(task), -1, -1, task_units(task));
+    // Before the status flips: whoever polls for completion may free the task
+    if (task->on_done) task->on_done(task, task->done_arg);
+    task_finish(task, TASK_COMPLETED);
+}
 
-    printf("Running task '%s' using %d resource units...\n", task->name, total_units);
-    usleep(total_units * 200000); // simulate work
+// Simulated work is a deadline on the pool, so it does not hold a worker
+static void start_task_job(void* arg) {
+    RTask* task = (RTask*)arg;
+    int total_units = task_units(task);
 
-    release_task(task);
-    printf("Task '%s' completed.\n", task->name);
-    return NULL;
+    ROC_TRACE_EVENT(TRACE_TASK_START, task_trace_node(task), -1, -1, total_units);
+    // The pool is done with task->job once this function runs: reuse it
+    task->job.fn = finish_task_job;
+    task->run_start_us = roc_now_us();
+    if (!worker_pool_submit_job_after(task->pool, &task->job, task->priority, task_estimate_us(task))) {
+        roc_sleep_us(task_estimate_us(task));
+        finish_task_job(task);
+    }
+}
+
+static int submit_task(RWorkerPool* pool, RTask* task) {
+    task->pool = pool;
+    task->job.fn = start_task_job;
+    task->job.arg = task;
+    task->job.owned = 0;
+    return worker_pool_submit_job(pool, &task->job, task->priority);
 }
 
 // =====================
 // Public execution functions
 // =====================
+// Only a run waiting on its deadline can be stopped (the start job is never
+// delayed): withdrawing the deadline job keeps finish_task_job from running
+int task_suspend(RTask* task) {
+    pthread_mutex_lock(&task->lock);
+    if (task->status != TASK_RUNNING || !task->pool || !worker_pool_cancel_job(task->pool, &task->job)) {
+        pthread_mutex_unlock(&task->lock);
+        return 0;
+    }
+    task->progress_us += roc_now_us() - task->run_start_us;
+    task->status = TASK_PREEMPTED;
+    pthread_mutex_unlock(&task->lock);
 
-// Simulate task execution (blocking)
-int run_task(RTask* task) {
-    // Reserve resources first
+    release_resources(task);
+    ROC_TRACE_EVENT(TRACE_TASK_PREEMPT, task_trace_node(task), -1, -1, task_units(task));
+    return 1;
+}
+
+void task_notify_evict(RTask* task) {
+    pthread_mutex_lock(&task->lock);
+    TaskEvictFn on_evict = task->on_evict;
+    void* arg = task->evict_arg;
+    pthread_mutex_unlock(&task->lock);
+
+    if (on_evict && !on_evict(task, task->progress_us, arg))
+        task->progress_us = 0;
+}
+
+int task_preempt(RTask* task) {
+    if (!task_suspend(task)) return 0;
+    task_notify_evict(task);
+    return 1;
+}
+
+void task_set_deadline(RTask* task, long long deadline_us) {
+    pthread_mutex_lock(&task->lock);
+    task->deadline_us = deadline_us > 0 ? deadline_us : 0;
+    pthread_mutex_unlock(&task->lock);
+}
+
+void task_set_evict(RTask* task, TaskEvictFn fn, void* arg) {
+    pthread_mutex_lock(&task->lock);
+    task->on_evict = fn;
+    task->evict_arg = arg;
+    pthread_mutex_unlock(&task->lock);
+}
+
+
+// Reserve resources, then hand the task to a pool worker
+int run_task_on(RWorkerPool* pool, RTask* task) {
+    if (!pool) return 0;
     if (!allocate_task(task)) return 0;
 
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, run_task_thread, task) != 0) {
-        // Failed to create thread, release resources
+    if (!submit_task(pool, task)) {
+        // Could not queue the task, release resources
         release_task(task);
         return 0;
     }
-
-    pthread_detach(thread); // Let it run independently
     return 1;
 }
 
-// Run task asynchronously in a new thread
-int run_task_async(RTask* task) {
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, run_task_thread, task) != 0)
+// Simulate task execution on the default pool
+int run_task(RTask* task) {
+    return run_task_on(roc_default_pool(), task);
+}
+
+int start_task_on(RWorkerPool* pool, RTask* task) {
+    return pool ? submit_task(pool, task) : 0;
+}
+
+// A single pool job starts every task of the batch
+typedef struct {
+    RPoolJob job;
+    int count;
+    RTask* tasks[];
+} TaskBatch;
+
+static void start_batch_job(void* arg) {
+    TaskBatch* batch = (TaskBatch*)arg;
+    for (int i = 0; i < batch->count; i++)
+        start_task_job(batch->tasks[i]);
+    free(batch);
+}
+
+int start_tasks_on(RWorkerPool* pool, RTask** tasks, int count) {
+    if (!pool || count <= 0) return 0;
+    TaskBatch* batch = (TaskBatch*)malloc(sizeof(TaskBatch) + count * sizeof(RTask*));
+    if (!batch) return 0;
+    batch->count = count;
+    for (int i = 0; i < count; i++) {
+        batch->tasks[i] = tasks[i];
+        tasks[i]->pool = pool;
+        tasks[i]->job.arg = tasks[i];
+        tasks[i]->job.owned = 0;
+    }
+    batch->job.fn = start_batch_job;
+    batch->job.arg = batch;
+    batch->job.owned = 0;
+    if (!worker_pool_submit_job(pool, &batch->job, tasks[0]->priority)) {
+        free(batch);
         return 0;
-    pthread_detach(thread); // Let it run independently
+    }
     return 1;
 }
 
+// Run an already allocated task on the default pool
+int run_task_async(RTask* task) {
+    return start_task_on(roc_default_pool(), task);
+}
+
 // Check task status
 TaskStatus task_status(RTask* task) {
     pthread_mutex_lock(&task->lock);
@@ -130,3 +430,49 @@ TaskStatus task_status(RTask* task) {
     pthread_mutex_unlock(&task->lock);
     return s;
 }
+
+// =====================
+// Completion
+// =====================
+static int task_is_final(TaskStatus s) {
+    return s == TASK_COMPLETED || s == TASK_FAILED;
+}
+
+// Hooks run outside the lock with the final status already visible, but
+// waiters are only woken after they return: a waiter may free the task.
+void task_finish(RTask* task, TaskStatus status) {
+    pthread_mutex_lock(&task->lock);
+    task->status = status;
+    RCompletionHook* hooks = task->hooks;
+    task->hooks = NULL;
+    task->finishing++;
+    pthread_mutex_unlock(&task->lock);
+
+    completion_hooks_run(hooks, task);
+
+    pthread_mutex_lock(&task->lock);
+    task->finishing--;
+    roc_cond_broadcast(&task->done);
+    pthread_mutex_unlock(&task->lock);
+}
+
+TaskStatus task_wait(RTask* task) {
+    pthread_mutex_lock(&task->lock);
+    while (!task_is_final(task->status) || task->finishing)
+        roc_cond_wait(&task->done, &task->lock);
+    TaskStatus s = task->status;
+    pthread_mutex_unlock(&task->lock);
+    return s;
+}
+
+int task_on_complete(RTask* task, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&task->lock);
+    if (!task_is_final(task->status)) {
+        int ok = completion_hook_add(&task->hooks, fn, arg);
+        pthread_mutex_unlock(&task->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&task->lock);
+    fn(task, arg);
+    return 1;
+}
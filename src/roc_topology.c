@@ -0,0 +1,339 @@
+#include "roc_topology.h"
+#include "roc_heap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+// =====================
+// Snapshot lifecycle
+// =====================
+static void set_slot(RTopology* topo, int k, int to, RLink* l) {
+    topo->adj_to[k] = to;
+    topo->adj_link[k] = l;
+    topo->adj_latency[k] = l->latency;
+    topo->adj_bandwidth[k] = l->bandwidth;
+    topo->adj_perm[k] = l->permissions;
+}
+
+// Senders take snapshots on their own threads: read under net->lock
+RTopology* topology_snapshot(RNetwork* net) {
+    RTopology* topo = (RTopology*)malloc(sizeof(RTopology));
+    pthread_rwlock_rdlock(&net->lock);
+    int n = net->node_count;
+
+    topo->version = atomic_load(&net->version);
+    topo->node_count = n;
+    topo->nodes = malloc((n ? n : 1) * sizeof(RNode*));
+    memcpy(topo->nodes, net->nodes, n * sizeof(RNode*));
+    atomic_init(&topo->refs, 1);
+
+    // Count usable links per node, then fill the CSR arrays
+    topo->adj_off = calloc(n + 1, sizeof(int));
+    for (int i = 0; i < net->link_count; i++) {
+        RLink* l = net->links[i];
+        if (!l->enabled || l->a->id < 0 || l->b->id < 0) continue;
+        topo->adj_off[l->a->id + 1]++;
+        topo->adj_off[l->b->id + 1]++;
+    }
+    for (int i = 0; i < n; i++) topo->adj_off[i + 1] += topo->adj_off[i];
+
+    int m = topo->adj_off[n] ? topo->adj_off[n] : 1;
+    topo->adj_to = malloc(m * sizeof(int));
+    topo->adj_link = malloc(m * sizeof(RLink*));
+    topo->adj_latency = malloc(m * sizeof(int));
+    topo->adj_bandwidth = malloc(m * sizeof(int));
+    topo->adj_perm = malloc(m * sizeof(unsigned int));
+
+    int* fill = malloc((n ? n : 1) * sizeof(int));
+    memcpy(fill, topo->adj_off, n * sizeof(int));
+    for (int i = 0; i < net->link_count; i++) {
+        RLink* l = net->links[i];
+        if (!l->enabled || l->a->id < 0 || l->b->id < 0) continue;
+        int a = l->a->id, b = l->b->id;
+        set_slot(topo, fill[a]++, b, l);
+        set_slot(topo, fill[b]++, a, l);
+    }
+    free(fill);
+
+    pthread_rwlock_unlock(&net->lock);
+    return topo;
+}
+
+RTopology* topology_current(RNetwork* net) {
+    unsigned long version = atomic_load(&net->version);
+
+    pthread_rwlock_rdlock(&net->topology_lock);
+    RTopology* topo = net->topology;
+    if (topo && topo->version == version) {
+        topology_retain(topo);
+        pthread_rwlock_unlock(&net->topology_lock);
+        return topo;
+    }
+    pthread_rwlock_unlock(&net->topology_lock);
+
+    pthread_rwlock_wrlock(&net->topology_lock);
+    topo = net->topology;
+    if (!topo || topo->version != version) {
+        topology_release(topo);
+        topo = topology_snapshot(net);
+        net->topology = topo;
+    }
+    topology_retain(topo);
+    pthread_rwlock_unlock(&net->topology_lock);
+    return topo;
+}
+
+void topology_retain(RTopology* topo) {
+    atomic_fetch_add(&topo->refs, 1);
+}
+
+void topology_release(RTopology* topo) {
+    if (!topo) return;
+    if (atomic_fetch_sub(&topo->refs, 1) != 1) return;
+    free(topo->nodes);
+    free(topo->adj_off);
+    free(topo->adj_to);
+    free(topo->adj_link);
+    free(topo->adj_latency);
+    free(topo->adj_bandwidth);
+    free(topo->adj_perm);
+    free(topo);
+}
+
+int topology_index(RTopology* topo, RNode* node) {
+    int id = node->id;
+    if (id < 0 || id >= topo->node_count || topo->nodes[id] != node) return -1;
+    return id;
+}
+
+// =====================
+// Searches
+// =====================
+// Searches read link attributes from the snapshot arrays (adjacency slot
+// i), never from the live RLink, which writers update under net->lock
+static int link_usable(RTopology* topo, int i, RoutePolicy policy) {
+    return (topo->adj_perm[i] & (1u << policy)) != 0;
+}
+
+static int search_bfs(RTopology* topo, RoutePolicy policy, int src, int dst, RLink** prev) {
+    int n = topo->node_count;
+    int* queue = malloc(n * sizeof(int));
+    char* seen = calloc(n, 1);
+    int qh = 0, qt = 0;
+
+    queue[qt++] = src;
+    seen[src] = 1;
+    while (qh < qt) {
+        int u = queue[qh++];
+        if (u == dst) break;
+        for (int i = topo->adj_off[u]; i < topo->adj_off[u + 1]; i++) {
+            int v = topo->adj_to[i];
+            if (seen[v] || !link_usable(topo, i, policy)) continue;
+            seen[v] = 1;
+            prev[v] = topo->adj_link[i];
+            queue[qt++] = v;
+        }
+    }
+
+    int found = (dst < 0) ? 1 : seen[dst];
+    free(queue);
+    free(seen);
+    return found;
+}
+
+// Backlog cost of a link in milliseconds: queued units drain at the link's
+// bandwidth, and the packet itself counts as one more unit
+static long long link_load_cost(RTopology* topo, int i) {
+    long long bw = topo->adj_bandwidth[i] > 0 ? topo->adj_bandwidth[i] : 1;
+    long long load = atomic_load_explicit(&topo->adj_link[i]->load, memory_order_relaxed);
+    return ((load + 1) * 1000LL) / bw + topo->adj_latency[i];
+}
+
+// Dijkstra on summed latency or backlog (widest = 0), or max bottleneck
+// bandwidth (widest = 1)
+static int search_dijkstra(RTopology* topo, RoutePolicy policy, int src, int dst, RLink** prev, int widest) {
+    int n = topo->node_count;
+    long long* best = malloc(n * sizeof(long long));
+    for (int i = 0; i < n; i++) best[i] = LLONG_MAX;
+
+    // Keys are minimised: latency as-is, bandwidth negated
+    RHeap heap;
+    heap_init(&heap);
+    best[src] = widest ? -(long long)INT_MAX : 0;
+    heap_push(&heap, best[src], (void*)(intptr_t)src);
+
+    RHeapItem it;
+    while (heap_pop(&heap, &it)) {
+        int u = (int)(intptr_t)it.data;
+        if (it.key > best[u]) continue;
+        if (u == dst) break;
+
+        for (int i = topo->adj_off[u]; i < topo->adj_off[u + 1]; i++) {
+            if (!link_usable(topo, i, policy)) continue;
+            int v = topo->adj_to[i];
+
+            long long key;
+            if (widest) {
+                long long width = -it.key;
+                int bw = topo->adj_bandwidth[i];
+                key = -(long long)((bw < width) ? bw : width);
+            } else if (policy == POLICY_LEAST_LOADED) {
+                key = it.key + link_load_cost(topo, i);
+            } else {
+                key = it.key + topo->adj_latency[i];
+            }
+
+            if (key < best[v]) {
+                best[v] = key;
+                prev[v] = topo->adj_link[i];
+                heap_push(&heap, key, (void*)(intptr_t)v);
+            }
+        }
+    }
+    heap_free(&heap);
+
+    int found = (dst < 0) ? 1 : best[dst] != LLONG_MAX;
+    free(best);
+    return found;
+}
+
+int topology_search(RTopology* topo, RoutePolicy policy, int src, int dst, RLink** prev) {
+    for (int i = 0; i < topo->node_count; i++) prev[i] = NULL;
+
+    switch (policy) {
+        case POLICY_SHORTEST: return search_bfs(topo, policy, src, dst, prev);
+        case POLICY_WIDEST:   return search_dijkstra(topo, policy, src, dst, prev, 1);
+        case POLICY_LATENCY:  return search_dijkstra(topo, policy, src, dst, prev, 0);
+        case POLICY_LEAST_LOADED: return search_dijkstra(topo, policy, src, dst, prev, 0);
+        case POLICY_FASTEST_COMPLETION: return search_bfs(topo, policy, src, dst, prev);
+        default:              return 0;
+    }
+}
+
+int topology_path(RTopology* topo, RLink** prev, int src, int dst, RLink** path, int* plen) {
+    int len = 0;
+    int cur = dst;
+    while (cur != src) {
+        RLink* l = prev[cur];
+        if (!l || len >= MAX_PATH_LEN) return 0;
+        path[len++] = l;
+        cur = topology_index(topo, (l->a == topo->nodes[cur]) ? l->b : l->a);
+        if (cur < 0) return 0;
+    }
+    *plen = len;
+    return 1;
+}
+
+int topology_find_path(RTopology* topo, RoutePolicy policy, RNode* src, RNode* dst, int amount,
+                       RLink** path, int* plen) {
+    int s = topology_index(topo, src);
+    int d = topology_index(topo, dst);
+    if (s < 0 || d < 0) return 0;
+    if (policy == POLICY_FASTEST_COMPLETION)
+        return topology_fastest_path(topo, s, d, amount, path, plen, NULL);
+
+    RLink** prev = malloc(topo->node_count * sizeof(RLink*));
+    int found = topology_search(topo, policy, s, d, prev) &&
+                topology_path(topo, prev, s, d, path, plen);
+    free(prev);
+    return found;
+}
+
+// =====================
+// Fastest completion
+// =====================
+// A label is one non-dominated way of reaching a node: summed latency and
+// bottleneck bandwidth. Completion time grows with latency and shrinks with
+// bandwidth, and extending two labels by the same link keeps dominance, so
+// the optimum is always built from Pareto-optimal labels.
+typedef struct {
+    long long latency;
+    int bandwidth;
+    int node;
+    int parent;          // label index, -1 for the source
+    RLink* link;         // link from the parent's node
+} PathLabel;
+
+static long long completion_ms(long long latency, int bandwidth, int amount) {
+    return latency + ((long long)amount * 1000LL + bandwidth - 1) / bandwidth;
+}
+
+int topology_fastest_path(RTopology* topo, int src, int dst, int amount, RLink** path, int* plen,
+                          long long* cost_ms) {
+    int n = topo->node_count;
+    if (amount < 0) amount = 0;
+
+    // Labels pop in latency order, so a new label at a node is dominated
+    // exactly when an earlier one there already had at least its bandwidth
+    int* best_bw = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) best_bw[i] = 0;
+
+    int label_count = 0, label_cap = 64;
+    PathLabel* labels = malloc(label_cap * sizeof(PathLabel));
+    labels[label_count++] = (PathLabel){ 0, INT_MAX, src, -1, NULL };
+
+    RHeap heap;
+    heap_init(&heap);
+    heap_push(&heap, 0, (void*)(intptr_t)0);
+
+    int best = -1;
+    long long best_cost = LLONG_MAX;
+
+    RHeapItem it;
+    while (heap_pop(&heap, &it)) {
+        // Every remaining label already has at least this much latency
+        if (it.key >= best_cost) break;
+
+        int li = (int)(intptr_t)it.data;
+        PathLabel cur = labels[li];
+        if (cur.bandwidth <= best_bw[cur.node]) continue;
+        best_bw[cur.node] = cur.bandwidth;
+
+        if (cur.node == dst) {
+            long long c = completion_ms(cur.latency, cur.bandwidth, amount);
+            if (c < best_cost) best_cost = c, best = li;
+            continue;
+        }
+
+        for (int i = topo->adj_off[cur.node]; i < topo->adj_off[cur.node + 1]; i++) {
+            int link_bw = topo->adj_bandwidth[i];
+            if (!link_usable(topo, i, POLICY_FASTEST_COMPLETION) || link_bw <= 0) continue;
+            int v = topo->adj_to[i];
+
+            int bw = link_bw < cur.bandwidth ? link_bw : cur.bandwidth;
+            if (bw <= best_bw[v]) continue;
+
+            if (label_count == label_cap) {
+                label_cap *= 2;
+                labels = realloc(labels, label_cap * sizeof(PathLabel));
+            }
+            labels[label_count] = (PathLabel){ cur.latency + topo->adj_latency[i], bw, v, li,
+                                               topo->adj_link[i] };
+            heap_push(&heap, labels[label_count].latency, (void*)(intptr_t)label_count);
+            label_count++;
+        }
+    }
+    heap_free(&heap);
+
+    int found = 0;
+    if (best >= 0) {
+        int len = 0;
+        found = 1;
+        for (int li = best; labels[li].parent >= 0; li = labels[li].parent) {
+            if (len >= MAX_PATH_LEN) {
+                found = 0;
+                break;
+            }
+            path[len++] = labels[li].link;
+        }
+        if (found) {
+            *plen = len;
+            if (cost_ms) *cost_ms = best_cost;
+        }
+    }
+
+    free(labels);
+    free(best_bw);
+    return found;
+}
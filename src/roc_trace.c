@@ -0,0 +1,210 @@
+#include "roc_trace.h"
+#include "roc_clock.h"
+#include "roc_log.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define DRAIN_INTERVAL_MS 10
+
+// =====================
+// Per-thread rings
+// =====================
+// Single producer (the owning thread), single consumer (the drainer)
+typedef struct TraceRing {
+    RTraceRecord records[ROC_TRACE_RING_SIZE];
+    atomic_uint head;        // next slot the producer writes
+    atomic_uint tail;        // next slot the drainer reads
+    atomic_int orphaned;     // owning thread has exited
+    uint32_t thread;
+    struct TraceRing* next;
+} TraceRing;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceRing* rings;
+static uint32_t next_thread;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static _Thread_local TraceRing* tls_ring;
+
+static atomic_int enabled;
+static atomic_ullong dropped;
+
+static FILE* trace_file;
+static pthread_t drainer;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drain_cond = PTHREAD_COND_INITIALIZER;
+static int draining;
+
+static void ring_orphan(void* ring) {
+    atomic_store(&((TraceRing*)ring)->orphaned, 1);
+}
+
+static void make_key(void) {
+    pthread_key_create(&ring_key, ring_orphan);
+}
+
+static TraceRing* thread_ring(void) {
+    if (tls_ring) return tls_ring;
+
+    TraceRing* ring = (TraceRing*)malloc(sizeof(TraceRing));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->orphaned, 0);
+
+    pthread_once(&key_once, make_key);
+    pthread_setspecific(ring_key, ring);
+
+    pthread_mutex_lock(&registry_lock);
+    ring->thread = next_thread++;
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&registry_lock);
+
+    tls_ring = ring;
+    return ring;
+}
+
+// =====================
+// Emission (hot path)
+// =====================
+void roc_trace_emit(int event, int node_a, int node_b, int link, int amount) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) return;
+
+    TraceRing* ring = thread_ring();
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= ROC_TRACE_RING_SIZE) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    RTraceRecord* r = &ring->records[head & (ROC_TRACE_RING_SIZE - 1)];
+    r->time_us = roc_now_us();
+    r->thread = ring->thread;
+    r->event = (uint16_t)event;
+    r->reserved = 0;
+    r->node_a = node_a;
+    r->node_b = node_b;
+    r->link = link;
+    r->amount = amount;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// =====================
+// Drainer
+// =====================
+static void drain_ring(TraceRing* ring) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    while (tail != head) {
+        // Copy up to the end of the buffer, then wrap
+        unsigned idx = tail & (ROC_TRACE_RING_SIZE - 1);
+        unsigned n = head - tail;
+        if (n > ROC_TRACE_RING_SIZE - idx) n = ROC_TRACE_RING_SIZE - idx;
+        fwrite(&ring->records[idx], sizeof(RTraceRecord), n, trace_file);
+        tail += n;
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+}
+
+// One pass over every ring; rings of exited threads are freed once empty
+static void drain_all(void) {
+    pthread_mutex_lock(&registry_lock);
+    TraceRing** link = &rings;
+    while (*link) {
+        TraceRing* ring = *link;
+        int gone = atomic_load(&ring->orphaned);
+        drain_ring(ring);
+        if (gone) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    fflush(trace_file);
+}
+
+// Plain pthread on wall-clock time: the drainer is not part of the simulation
+static void* drainer_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&drain_lock);
+    while (draining) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += DRAIN_INTERVAL_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&drain_cond, &drain_lock, &ts);
+
+        pthread_mutex_unlock(&drain_lock);
+        drain_all();
+        pthread_mutex_lock(&drain_lock);
+    }
+    pthread_mutex_unlock(&drain_lock);
+    return NULL;
+}
+
+// =====================
+// Control
+// =====================
+int roc_trace_start(const char* path) {
+    if (trace_file) return 1;
+
+    trace_file = fopen(path, "wb");
+    if (!trace_file) {
+        ROC_ERROR("[Trace] Cannot open %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+
+    RTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ROC_TRACE_MAGIC, sizeof(header.magic));
+    header.version = ROC_TRACE_VERSION;
+    header.record_size = sizeof(RTraceRecord);
+    fwrite(&header, sizeof(header), 1, trace_file);
+
+    // Records left over from an earlier session are not part of this file
+    pthread_mutex_lock(&registry_lock);
+    for (TraceRing* r = rings; r; r = r->next)
+        atomic_store(&r->tail, atomic_load(&r->head));
+    pthread_mutex_unlock(&registry_lock);
+
+    draining = 1;
+    if (pthread_create(&drainer, NULL, drainer_thread, NULL) != 0) {
+        fclose(trace_file);
+        trace_file = NULL;
+        return 0;
+    }
+    atomic_store(&enabled, 1);
+    return 1;
+}
+
+void roc_trace_stop(void) {
+    if (!trace_file) return;
+    atomic_store(&enabled, 0);
+
+    pthread_mutex_lock(&drain_lock);
+    draining = 0;
+    pthread_cond_signal(&drain_cond);
+    pthread_mutex_unlock(&drain_lock);
+    pthread_join(drainer, NULL);
+
+    drain_all();
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+unsigned long long roc_trace_dropped(void) {
+    return atomic_load(&dropped);
+}
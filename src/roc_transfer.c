@@ -0,0 +1,358 @@
+#include "roc_transfer.h"
+#include "roc_clock.h"
+#include "roc_linkq.h"
+#include "roc_trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+// What the next timer event of a piece means
+enum {
+    STAGE_HOP,       // reached p->current: start crossing path[hop] (or deliver)
+    STAGE_SEND,      // path[hop] granted: put the chunk on the wire
+    STAGE_SENT       // chunk crossed: free the link, then next chunk or next hop
+};
+
+// =====================
+// Internal helpers
+// =====================
+static void schedule(RTransferEngine* engine, RTransferPiece* p, long long due) {
+    pthread_mutex_lock(&engine->lock);
+    heap_push(&engine->timers, due, p);
+    // Only a new earliest deadline changes what a waiting thread sleeps for
+    if (heap_peek(&engine->timers)->data == p)
+        roc_cond_signal(&engine->cond);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static void transfer_unref(RTransfer* t) {
+    if (atomic_fetch_sub(&t->refs, 1) != 1) return;
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->done);
+    free(t->pieces);
+    free(t->path);
+    free(t);
+}
+
+static void finish(RTransfer* t, TransferStatus status) {
+    if (!(t->flags & TRANSFER_LEASED)) release(t->pkt.src, t->pkt.amount);
+    ROC_TRACE_EVENT(status == TRANSFER_COMPLETED ? TRACE_TRANSFER_DONE : TRACE_TRANSFER_FAILED,
+                    t->pkt.src->id, t->pkt.dst ? t->pkt.dst->id : -1, -1, t->pkt.amount);
+
+    pthread_mutex_lock(&t->lock);
+    t->status = status;
+    roc_cond_broadcast(&t->done);
+    pthread_mutex_unlock(&t->lock);
+
+    if (t->callback) t->callback(t, t->callback_arg);
+
+    atomic_fetch_sub(&t->engine->in_flight, 1);
+    transfer_unref(t);
+}
+
+// A piece is done (delivered or failed); the last one finishes the transfer
+static void piece_done(RTransferPiece* p, int ok) {
+    RTransfer* t = p->transfer;
+    if (p->holding) {
+        p->holding = 0;
+        linkq_release(t->path[p->hop]->txq);
+    }
+    if (p->remaining > 0) {
+        // Abandoned mid-hop: the rest of the piece no longer loads the link
+        atomic_fetch_sub_explicit(&t->path[p->hop]->load, p->remaining, memory_order_relaxed);
+        p->remaining = 0;
+    }
+    if (!ok) atomic_store(&t->failed, 1);
+    if (atomic_fetch_sub(&t->pieces_left, 1) == 1)
+        finish(t, atomic_load(&t->failed) ? TRANSFER_FAILED : TRANSFER_COMPLETED);
+}
+
+static void send_chunk(RTransferPiece* p, long long now) {
+    RTransfer* t = p->transfer;
+    int bandwidth = t->path[p->hop]->bandwidth;
+    p->stage = STAGE_SENT;
+    schedule(t->engine, p, now + (bandwidth > 0 ? ((long long)p->sending * 1000000LL) / bandwidth : 0));
+}
+
+// Parked list, under engine->lock
+static void park(RTransferEngine* engine, RTransferPiece* p) {
+    p->park_prev = NULL;
+    p->park_next = engine->parked;
+    if (engine->parked) engine->parked->park_prev = p;
+    engine->parked = p;
+}
+
+static void unpark(RTransferEngine* engine, RTransferPiece* p) {
+    if (p->park_prev) p->park_prev->park_next = p->park_next;
+    else engine->parked = p->park_next;
+    if (p->park_next) p->park_next->park_prev = p->park_prev;
+    p->park_prev = p->park_next = NULL;
+}
+
+// Runs on the thread that released the link; the chunk starts on an engine
+// thread. During destroy the piece lands in the timer heap and fails there.
+static void grant_link(void* arg) {
+    RTransferPiece* p = (RTransferPiece*)arg;
+    RTransferEngine* engine = p->transfer->engine;
+    pthread_mutex_lock(&engine->lock);
+    unpark(engine, p);
+    p->holding = 1;
+    heap_push(&engine->timers, roc_now_us(), p);
+    if (!engine->running || heap_peek(&engine->timers)->data == p)
+        roc_cond_broadcast(&engine->cond);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static void request_chunk(RTransferPiece* p, long long now) {
+    RTransfer* t = p->transfer;
+    RTransferEngine* engine = t->engine;
+    RLink* l = t->path[p->hop];
+    p->sending = (t->chunk > 0 && p->remaining > t->chunk) ? t->chunk : p->remaining;
+    p->stage = STAGE_SEND;
+
+    // Park before the grant can arrive: grant_link waits for engine->lock
+    pthread_mutex_lock(&engine->lock);
+    int granted = linkq_acquire(l->txq, t->pkt.priority, p->sending, grant_link, p);
+    if (!granted) park(engine, p);
+    pthread_mutex_unlock(&engine->lock);
+
+    if (granted) {
+        p->holding = 1;
+        send_chunk(p, now);
+    }
+}
+
+// One event: advance a piece by one stage
+static void step(RTransferPiece* p, long long now) {
+    RTransfer* t = p->transfer;
+
+    if (p->stage == STAGE_SEND) {
+        send_chunk(p, now);
+        return;
+    }
+
+    if (p->stage == STAGE_SENT) {
+        RLink* l = t->path[p->hop];
+        RNode* next = (l->a == p->current) ? l->b : l->a;
+        p->holding = 0;
+        linkq_release(l->txq);
+        ROC_TRACE_EVENT(TRACE_CHUNK_SENT, p->current->id, next->id, l->id, p->sending);
+
+        p->remaining -= p->sending;
+        atomic_fetch_sub_explicit(&l->load, p->sending, memory_order_relaxed);
+        if (p->remaining > 0) {
+            request_chunk(p, now);   // queue again so urgent packets can cut in
+            return;
+        }
+
+        // Last chunk is out: the piece lands after the link latency
+        p->current = next;
+        if (p == &t->pieces[0]) t->current = p->current;
+        p->hop--;
+        p->stage = STAGE_HOP;
+        schedule(t->engine, p, now + l->latency * 1000LL);
+        return;
+    }
+
+    if (p->hop < 0) {
+        piece_done(p, 1);
+        return;
+    }
+
+    RLink* l = t->path[p->hop];
+    if (atomic_load(&t->failed) || !l->enabled ||
+        (l->permissions & (1u << t->policy)) == 0 || l->bandwidth <= 0) {
+        piece_done(p, 0);
+        return;
+    }
+
+    if (t->status == TRANSFER_PENDING) {
+        pthread_mutex_lock(&t->lock);
+        if (t->status == TRANSFER_PENDING) t->status = TRANSFER_RUNNING;
+        pthread_mutex_unlock(&t->lock);
+    }
+
+    p->remaining = p->size;
+    atomic_fetch_add_explicit(&l->load, p->size, memory_order_relaxed);
+    request_chunk(p, now);
+}
+
+static void* engine_thread(void* arg) {
+    RTransferEngine* engine = (RTransferEngine*)arg;
+
+    pthread_mutex_lock(&engine->lock);
+    while (engine->running) {
+        RHeapItem* top = heap_peek(&engine->timers);
+        if (!top) {
+            roc_cond_wait(&engine->cond, &engine->lock);
+            continue;
+        }
+
+        long long now = roc_now_us();
+        if (top->key > now) {
+            roc_cond_timedwait(&engine->cond, &engine->lock, top->key);
+            continue;
+        }
+
+        RHeapItem it;
+        heap_pop(&engine->timers, &it);
+        pthread_mutex_unlock(&engine->lock);
+
+        step((RTransferPiece*)it.data, now);
+
+        pthread_mutex_lock(&engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return NULL;
+}
+
+// =====================
+// Engine API
+// =====================
+RTransferEngine* create_transfer_engine(int threads) {
+    if (threads <= 0) threads = TRANSFER_DEFAULT_THREADS;
+
+    RTransferEngine* engine = (RTransferEngine*)malloc(sizeof(RTransferEngine));
+    heap_init(&engine->timers);
+    engine->parked = NULL;
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->cond, NULL);
+    atomic_init(&engine->in_flight, 0);
+    engine->running = 1;
+    engine->thread_count = 0;
+    engine->threads = malloc(threads * sizeof(pthread_t));
+
+    for (int i = 0; i < threads; i++) {
+        if (roc_thread_spawn(&engine->threads[engine->thread_count], engine_thread, engine))
+            engine->thread_count++;
+    }
+    return engine;
+}
+
+void destroy_transfer_engine(RTransferEngine* engine) {
+    if (!engine) return;
+
+    pthread_mutex_lock(&engine->lock);
+    engine->running = 0;
+    roc_cond_broadcast(&engine->cond);
+    pthread_mutex_unlock(&engine->lock);
+
+    for (int i = 0; i < engine->thread_count; i++)
+        roc_thread_join(engine->threads[i]);
+
+    // Anything still queued never gets delivered. Pieces parked on a link
+    // are withdrawn from its queue; one whose grant is already on its way
+    // lands in the timer heap. Failing a piece frees its link, which may
+    // grant another parked piece, so loop until nothing is left.
+    pthread_mutex_lock(&engine->lock);
+    for (;;) {
+        for (RTransferPiece* p = engine->parked; p; ) {
+            RTransferPiece* next = p->park_next;
+            RLinkQueue* txq = p->transfer->path[p->hop]->txq;
+            if (linkq_cancel(txq, grant_link, p)) {
+                unpark(engine, p);
+                heap_push(&engine->timers, 0, p);
+            }
+            p = next;
+        }
+
+        RHeapItem it;
+        if (heap_pop(&engine->timers, &it)) {
+            pthread_mutex_unlock(&engine->lock);
+            piece_done((RTransferPiece*)it.data, 0);
+            pthread_mutex_lock(&engine->lock);
+        } else if (engine->parked) {
+            roc_cond_wait(&engine->cond, &engine->lock);   // a grant is being delivered
+        } else {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&engine->lock);
+
+    heap_free(&engine->timers);
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->cond);
+    free(engine->threads);
+    free(engine);
+}
+
+RTransfer* transfer_submit(RTransferEngine* engine, RNode* src, RLink** path, int plen,
+                           RPacket* pkt, RoutePolicy policy, int chunk, int flags,
+                           TransferCallback callback, void* arg) {
+    if (!(flags & (TRANSFER_PRERESERVED | TRANSFER_LEASED)) && !reserve(src, pkt->amount))
+        return NULL;
+
+    RTransfer* t = (RTransfer*)malloc(sizeof(RTransfer));
+    t->pkt = *pkt;
+    t->pkt.src = src;
+    t->current = src;
+    t->path = malloc((plen ? plen : 1) * sizeof(RLink*));
+    memcpy(t->path, path, plen * sizeof(RLink*));
+    t->plen = plen;
+    t->policy = policy;
+    t->flags = flags;
+    t->chunk = chunk > 0 ? chunk : 0;
+
+    // Cut-through splits the packet into pieces that travel independently
+    int amount = pkt->amount > 0 ? pkt->amount : 0;
+    int piece_size = amount;
+    if ((flags & TRANSFER_CUT_THROUGH) && t->chunk > 0 && amount > t->chunk) {
+        piece_size = t->chunk;
+        int min_size = (amount + TRANSFER_MAX_PIECES - 1) / TRANSFER_MAX_PIECES;
+        if (piece_size < min_size) piece_size = min_size;
+    }
+    t->piece_count = piece_size > 0 ? (amount + piece_size - 1) / piece_size : 1;
+    t->pieces = malloc(t->piece_count * sizeof(RTransferPiece));
+    for (int i = 0; i < t->piece_count; i++) {
+        RTransferPiece* p = &t->pieces[i];
+        p->transfer = t;
+        p->current = src;
+        p->hop = plen - 1;
+        p->size = (i == t->piece_count - 1) ? amount - i * piece_size : piece_size;
+        p->stage = STAGE_HOP;
+        p->remaining = 0;
+        p->sending = 0;
+        p->holding = 0;
+        p->park_prev = p->park_next = NULL;
+    }
+    atomic_init(&t->pieces_left, t->piece_count);
+    atomic_init(&t->failed, 0);
+
+    t->status = TRANSFER_PENDING;
+    t->callback = callback;
+    t->callback_arg = arg;
+    t->engine = engine;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->done, NULL);
+    atomic_init(&t->refs, 2);
+
+    atomic_fetch_add(&engine->in_flight, 1);
+    ROC_TRACE_EVENT(TRACE_TRANSFER_SUBMIT, src->id, pkt->dst ? pkt->dst->id : -1, -1, pkt->amount);
+    long long now = roc_now_us();
+    for (int i = 0; i < t->piece_count; i++)
+        schedule(engine, &t->pieces[i], now);
+    return t;
+}
+
+TransferStatus transfer_poll(RTransfer* transfer) {
+    pthread_mutex_lock(&transfer->lock);
+    TransferStatus s = transfer->status;
+    pthread_mutex_unlock(&transfer->lock);
+    return s;
+}
+
+TransferStatus transfer_wait(RTransfer* transfer) {
+    pthread_mutex_lock(&transfer->lock);
+    while (transfer->status == TRANSFER_PENDING || transfer->status == TRANSFER_RUNNING)
+        roc_cond_wait(&transfer->done, &transfer->lock);
+    TransferStatus s = transfer->status;
+    pthread_mutex_unlock(&transfer->lock);
+    return s;
+}
+
+void transfer_release(RTransfer* transfer) {
+    if (transfer) transfer_unref(transfer);
+}
+
+int transfer_in_flight(RTransferEngine* engine) {
+    return atomic_load(&engine->in_flight);
+}
@@ -1,5 +1,6 @@
-#include <windows.h>
 #include "roc_workflow.h"
+#include "roc_clock.h"
+#include "roc_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,12 +11,16 @@ RWorkflow* create_workflow(const char* name, int priority) {
     wf->task_count = 0;
     wf->priority = priority;
     wf->status = WORKFLOW_PENDING;
+    wf->hooks = NULL;
     pthread_mutex_init(&wf->lock, NULL);
+    pthread_cond_init(&wf->done, NULL);
     return wf;
 }
 
 void destroy_workflow(RWorkflow* wf) {
+    completion_hooks_free(wf->hooks);
     pthread_mutex_destroy(&wf->lock);
+    pthread_cond_destroy(&wf->done);
     free(wf);
 }
 
@@ -30,58 +35,57 @@ int workflow_add_task(RWorkflow* wf, RTask* task) {
     return 1;
 }
 
-// Internal thread function for workflow
-static void* run_workflow_thread(void* arg) {
-    RWorkflow* wf = (RWorkflow*)arg;
+// Publish the final status, then wake waiters and run callbacks
+static void finish_workflow(RWorkflow* wf, WorkflowStatus status) {
     pthread_mutex_lock(&wf->lock);
-    wf->status = WORKFLOW_RUNNING;
+    wf->status = status;
+    RCompletionHook* hooks = wf->hooks;
+    wf->hooks = NULL;
+    roc_cond_broadcast(&wf->done);
     pthread_mutex_unlock(&wf->lock);
+    completion_hooks_run(hooks, wf);
+}
 
-    printf("[Workflow] Starting workflow '%s'\n", wf->name);
-
-    pthread_t threads[MAX_TASKS_PER_WORKFLOW];
+// Internal thread function for workflow
+static void* run_workflow_thread(void* arg) {
+    RWorkflow* wf = (RWorkflow*)arg;
+    ROC_INFO("[Workflow] Starting workflow '%s'\n", wf->name);
 
     // Launch all tasks asynchronously
-    for (int i = 0; i < wf->task_count; i++) {
-        if (!run_task_async(wf->tasks[i])) {
-            pthread_mutex_lock(&wf->lock);
-            wf->status = WORKFLOW_FAILED;
-            pthread_mutex_unlock(&wf->lock);
-            return NULL;
-        }
-    }
+    int launched = 0;
+    while (launched < wf->task_count && run_task_async(wf->tasks[launched]))
+        launched++;
+    WorkflowStatus status = launched == wf->task_count ? WORKFLOW_COMPLETED : WORKFLOW_FAILED;
 
-    // Wait for all tasks to complete
-    int done = 0;
-    while (!done) {
-        done = 1;
-        for (int i = 0; i < wf->task_count; i++) {
-            if (task_status(wf->tasks[i]) != TASK_COMPLETED) {
-                done = 0;
-                break;
-            }
-        }
-        #ifdef _WIN32
-          Sleep(50);  // milliseconds
-        #else
-          usleep(50000); // microseconds
-        #endif
+    // Tasks already launched run to the end either way
+    for (int i = 0; i < launched; i++) {
+        if (task_wait(wf->tasks[i]) != TASK_COMPLETED)
+            status = WORKFLOW_FAILED;
     }
 
-    pthread_mutex_lock(&wf->lock);
-    wf->status = WORKFLOW_COMPLETED;
-    pthread_mutex_unlock(&wf->lock);
-
-    printf("[Workflow] Workflow '%s' completed\n", wf->name);
+    if (status == WORKFLOW_COMPLETED)
+        ROC_INFO("[Workflow] Workflow '%s' completed\n", wf->name);
+    else
+        ROC_WARN("[Workflow] Workflow '%s' failed\n", wf->name);
+    finish_workflow(wf, status);
     return NULL;
 }
 
 // Run workflow asynchronously
 int workflow_run(RWorkflow* wf, RTaskScheduler* sched) {
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, run_workflow_thread, wf) != 0)
+    (void)sched;   // tasks run on the default pool, not through the scheduler
+    pthread_mutex_lock(&wf->lock);
+    if (wf->status == WORKFLOW_RUNNING) {
+        pthread_mutex_unlock(&wf->lock);
+        return 0;
+    }
+    wf->status = WORKFLOW_RUNNING;
+    pthread_mutex_unlock(&wf->lock);
+
+    if (!roc_thread_spawn(NULL, run_workflow_thread, wf)) { // detached
+        finish_workflow(wf, WORKFLOW_FAILED);
         return 0;
-    pthread_detach(thread);
+    }
     return 1;
 }
 
@@ -91,3 +95,24 @@ WorkflowStatus workflow_status(RWorkflow* wf) {
     pthread_mutex_unlock(&wf->lock);
     return s;
 }
+
+WorkflowStatus workflow_wait(RWorkflow* wf) {
+    pthread_mutex_lock(&wf->lock);
+    while (wf->status == WORKFLOW_RUNNING)
+        roc_cond_wait(&wf->done, &wf->lock);
+    WorkflowStatus s = wf->status;
+    pthread_mutex_unlock(&wf->lock);
+    return s;
+}
+
+int workflow_on_complete(RWorkflow* wf, CompletionFn fn, void* arg) {
+    pthread_mutex_lock(&wf->lock);
+    if (wf->status == WORKFLOW_RUNNING) {
+        int ok = completion_hook_add(&wf->hooks, fn, arg);
+        pthread_mutex_unlock(&wf->lock);
+        return ok;
+    }
+    pthread_mutex_unlock(&wf->lock);
+    fn(wf, arg);
+    return 1;
+}
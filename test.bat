@@ -0,0 +1,31 @@
+@echo off
+setlocal enabledelayedexpansion
+
+echo [+] Building ROC tests...
+
+:: every library source comp.bat builds, without the application's main.c
+set SRCS=
+for %%f in (src\*.c) do (
+    if /i not "%%~nxf"=="main.c" set SRCS=!SRCS! %%f
+)
+
+set FAILED=0
+for %%t in (tests\test_*.c) do (
+    if exist tests\%%~nt.exe del tests\%%~nt.exe
+    gcc -Iinclude %%t !SRCS! -o tests\%%~nt.exe -lpthread
+    if errorlevel 1 (
+        echo [!] %%~nt: compilation failed.
+        set FAILED=1
+    ) else (
+        tests\%%~nt.exe
+        if errorlevel 1 set FAILED=1
+    )
+)
+
+if !FAILED!==1 (
+    echo [!] Some tests failed.
+    exit /b 1
+)
+
+echo [+] All tests passed.
+endlocal
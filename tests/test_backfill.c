@@ -0,0 +1,46 @@
+// EASY backfill: a task may pass the blocked head only if it cannot delay it
+#include "test_util.h"
+#include "roc_scheduler.h"
+
+int main(void) {
+    roc_clock_use_virtual();
+    RNetwork* net = create_network();
+    RNode* node = create_node("n", "CPU", 10);
+    add_node(net, node);
+    RTaskScheduler* sched = create_scheduler_workers(2, 0);
+
+    // A holds 6 of 10 units, so B (8 units) is the blocked head until A ends.
+    // C fits in the 4 free units and ends before A: it is backfilled.
+    // E would still hold units when A ends and delay B: it waits for B.
+    // X is larger than the node and fails at once.
+    enum { A, B, C, E, X, COUNT };
+    RTask* tasks[COUNT];
+    tasks[A] = make_task(node, "A", 5, 6);
+    scheduler_add_task(sched, tasks[A]);
+    scheduler_start(sched);
+    roc_sleep_ms(1);
+
+    tasks[B] = make_task(node, "B", 4, 8);
+    tasks[C] = make_task(node, "C", 1, 4);
+    tasks[E] = make_task(node, "E", 1, 3);
+    tasks[X] = make_task(node, "X", 0, 20);
+    for (int i = B; i < COUNT; i++) scheduler_add_task(sched, tasks[i]);
+
+    long long started[COUNT], ended[COUNT];
+    watch_tasks(tasks, COUNT, started, ended, 400, 10);
+
+    CHECK(started[C] >= 0 && started[C] < ended[A], "C was not backfilled (start %lld, A ends %lld)",
+          started[C], ended[A]);
+    CHECK(ended[C] <= ended[A], "backfilled C outlived A (%lld > %lld)", ended[C], ended[A]);
+    CHECK(started[B] >= ended[A] && started[B] <= ended[A] + 20, "B did not start when A ended (%lld vs %lld)",
+          started[B], ended[A]);
+    CHECK(started[E] >= started[B], "E delayed the head (E %lld, B %lld)", started[E], started[B]);
+    CHECK(task_status(tasks[X]) == TASK_FAILED, "oversized X is %d", task_status(tasks[X]));
+    for (int i = A; i < X; i++)
+        CHECK(task_status(tasks[i]) == TASK_COMPLETED, "%s is %d", tasks[i]->name, task_status(tasks[i]));
+    CHECK(node->available == node->capacity, "%d of %d units left reserved",
+          node->capacity - node->available, node->capacity);
+
+    destroy_scheduler(sched);
+    return test_report("backfill");
+}
@@ -0,0 +1,86 @@
+// Contraction hierarchy queries against plain Dijkstra (find_path_latency)
+#include "test_util.h"
+#include "roc_ch.h"
+
+#define CH_QUERIES 1000
+
+static long long path_latency(RLink** path, int plen) {
+    long long sum = 0;
+    for (int i = 0; i < plen; i++) sum += path[i]->latency;
+    return sum;
+}
+
+// path[plen - 1] leaves src and path[0] enters dst, as in find_path_*
+static int path_connects(RLink** path, int plen, RNode* src, RNode* dst) {
+    RNode* at = src;
+    for (int i = plen - 1; i >= 0; i--) {
+        if (!path[i]->enabled) return 0;
+        if (path[i]->a == at) at = path[i]->b;
+        else if (path[i]->b == at) at = path[i]->a;
+        else return 0;
+    }
+    return at == dst;
+}
+
+static void compare(RNetwork* net, RContractionHierarchy* ch, const char* label) {
+    RLink* want[MAX_PATH_LEN];
+    RLink* got[MAX_PATH_LEN];
+    int mismatches = 0;
+
+    for (int q = 0; q < CH_QUERIES; q++) {
+        RNode* src = net->nodes[test_rand(net->node_count)];
+        RNode* dst = net->nodes[test_rand(net->node_count)];
+        int wlen = 0, glen = 0;
+        int found = find_path_latency(net, src, dst, want, &wlen);
+        int ch_found = find_path_ch(ch, src, dst, got, &glen);
+
+        if (ch_found < 0) continue;   // rebuild still pending
+        if (found != ch_found ||
+            (found && (path_latency(want, wlen) != path_latency(got, glen) ||
+                       !path_connects(got, glen, src, dst)))) {
+            if (mismatches++ < 3)
+                CHECK(0, "%s: %s -> %s: dijkstra %d/%lld, ch %d/%lld", label, src->name, dst->name,
+                      found, found ? path_latency(want, wlen) : 0,
+                      ch_found, ch_found ? path_latency(got, glen) : 0);
+        }
+    }
+    CHECK(mismatches == 0, "%s: %d of %d queries differ", label, mismatches, CH_QUERIES);
+}
+
+static void random_graph(int nodes, int extra_links, int disconnected) {
+    RNetwork* net = create_network();
+    char name[32];
+    for (int i = 0; i < nodes; i++) {
+        snprintf(name, sizeof(name), "n%d", i);
+        add_node(net, create_node(name, "CPU", 10));
+    }
+    // A spanning tree keeps it connected unless some nodes are left isolated
+    for (int i = 1; i < nodes - disconnected; i++)
+        create_link(net, net->nodes[i], net->nodes[test_rand(i)], 100, 1 + test_rand(50));
+    for (int i = 0; i < extra_links; i++) {
+        int a = test_rand(nodes - disconnected), b = test_rand(nodes - disconnected);
+        if (a != b) create_link(net, net->nodes[a], net->nodes[b], 100, 1 + test_rand(50));
+    }
+
+    RContractionHierarchy* ch = create_contraction_hierarchy(net);
+    snprintf(name, sizeof(name), "%d nodes", nodes);
+    compare(net, ch, name);
+
+    // Change the topology: queries must never return a stale path
+    for (int i = 0; i < 10; i++) {
+        disable_link(net->links[test_rand(net->link_count)]);
+        set_link_latency(net->links[test_rand(net->link_count)], 1 + test_rand(50));
+    }
+    compare(net, ch, "during rebuild");
+    ch_rebuild(ch);
+    compare(net, ch, "after rebuild");
+
+    destroy_network(net);
+}
+
+int main(void) {
+    random_graph(50, 100, 0);
+    random_graph(500, 1000, 5);
+    random_graph(2000, 4000, 0);
+    return test_report("contraction hierarchy");
+}
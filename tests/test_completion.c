@@ -0,0 +1,136 @@
+// Completion waits and hooks: hooks run once and in order, waits return
+// after them, and nested containers finish without polling delay
+#include "test_util.h"
+#include "roc_scheduler.h"
+#include "roc_job.h"
+#include "roc_bundle.h"
+#include "roc_campaign.h"
+#include "roc_program.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define UNIT_MS 200   // simulated work per resource unit
+
+static char order[16];
+static atomic_int order_len;
+static atomic_int slow_hook_done;
+static pthread_t main_thread;
+static int ran_on_caller = 0;
+
+static void mark(void* source, void* arg) {
+    (void)source;
+    order[atomic_fetch_add(&order_len, 1)] = (char)(intptr_t)arg;
+}
+
+// Still running when the status turns final: task_wait must wait for it
+static void slow_hook(void* source, void* arg) {
+    mark(source, arg);
+    roc_sleep_ms(100);
+    atomic_store(&slow_hook_done, 1);
+}
+
+static void late_hook(void* source, void* arg) {
+    (void)source;
+    (void)arg;
+    ran_on_caller = pthread_equal(pthread_self(), main_thread);
+}
+
+static void reset_order(void) {
+    atomic_store(&order_len, 0);
+    for (int i = 0; i < (int)sizeof(order); i++) order[i] = 0;
+}
+
+int main(void) {
+    roc_clock_use_virtual();
+    main_thread = pthread_self();
+    atomic_init(&order_len, 0);
+    atomic_init(&slow_hook_done, 0);
+
+    RNetwork* net = create_network();
+    RNode* node = create_node("n", "CPU", 100);
+    add_node(net, node);
+    RTaskScheduler* sched = create_scheduler_workers(2, 0);
+    scheduler_start(sched);
+
+    // Task: hooks in the order added, task_wait after the last one returns
+    reset_order();
+    RTask* task = make_task(node, "t", 0, 1);
+    task_on_complete(task, mark, (void*)'a');
+    task_on_complete(task, slow_hook, (void*)'b');
+    task_on_complete(task, mark, (void*)'c');
+    long long t0 = roc_now_ms();
+    scheduler_add_task(sched, task);
+    CHECK(task_wait(task) == TASK_COMPLETED, "task did not complete");
+    CHECK(atomic_load(&slow_hook_done), "task_wait returned while a hook was still running");
+    CHECK(atomic_load(&order_len) == 3 && order[0] == 'a' && order[1] == 'b' && order[2] == 'c',
+          "hooks ran as '%s', want 'abc'", order);
+    long long took = roc_now_ms() - t0;
+    CHECK(took >= UNIT_MS + 100 && took < UNIT_MS + 110, "task_wait returned after %lld ms", took);
+
+    // A hook added after the task finished runs at once, on the caller
+    CHECK(task_on_complete(task, late_hook, NULL), "late hook refused");
+    CHECK(ran_on_caller, "late hook did not run on the calling thread");
+    CHECK(atomic_load(&order_len) == 3, "earlier hooks ran again");
+    destroy_task(task);
+
+    // Job: finishes with its slowest task, not on the next polling tick
+    reset_order();
+    RJob* job = create_job("job", 0);
+    RTask* tasks[3];
+    for (int i = 0; i < 3; i++) {
+        tasks[i] = make_task(node, "jt", 0, i + 1);
+        job_add_task(job, tasks[i]);
+    }
+    job_on_complete(job, mark, (void*)'j');
+    t0 = roc_now_ms();
+    job_run(job, sched);
+    CHECK(job_wait(job) == JOB_COMPLETED, "job did not complete");
+    took = roc_now_ms() - t0;
+    CHECK(took >= 3 * UNIT_MS && took < 3 * UNIT_MS + 10, "job_wait returned after %lld ms, want %d",
+          took, 3 * UNIT_MS);
+    CHECK(atomic_load(&order_len) == 1 && order[0] == 'j', "job hooks ran as '%s'", order);
+    CHECK(job_wait(job) == JOB_COMPLETED, "second job_wait changed the outcome");
+
+    // Program > campaign > bundle > job: every level completes as soon as
+    // the level below it does, innermost hook first
+    reset_order();
+    RJob* inner = create_job("inner", 0);
+    RTask* inner_tasks[3];
+    for (int i = 0; i < 3; i++) {
+        inner_tasks[i] = make_task(node, "it", 0, i + 1);
+        job_add_task(inner, inner_tasks[i]);
+    }
+    job_on_complete(inner, mark, (void*)'j');
+    RBundle* bundle = create_bundle("bundle", 0);
+    bundle_add_job(bundle, inner);
+    bundle_on_complete(bundle, mark, (void*)'b');
+    RCampaign* campaign = create_campaign("campaign", 0);
+    campaign_add_bundle(campaign, bundle);
+    campaign_on_complete(campaign, mark, (void*)'c');
+    RProgram* program = create_program("program", 0);
+    program_add_campaign(program, campaign);
+    program_on_complete(program, mark, (void*)'p');
+    t0 = roc_now_ms();
+    program_run(program, sched);
+    took = roc_now_ms() - t0;
+    CHECK(program_status(program) == PROGRAM_COMPLETED, "program status %d", program_status(program));
+    CHECK(program_wait(program) == PROGRAM_COMPLETED, "program_wait after the run");
+    CHECK(took >= 3 * UNIT_MS && took < 3 * UNIT_MS + 10, "four levels took %lld ms, want %d",
+          took, 3 * UNIT_MS);
+    CHECK(atomic_load(&order_len) == 4 && order[0] == 'j' && order[1] == 'b' && order[2] == 'c' && order[3] == 'p',
+          "container hooks ran as '%s', want 'jbcp'", order);
+
+    destroy_scheduler(sched);
+    destroy_program(program);
+    destroy_campaign(campaign);
+    destroy_bundle(bundle);
+    destroy_job(inner);
+    destroy_job(job);
+    for (int i = 0; i < 3; i++) {
+        destroy_task(inner_tasks[i]);
+        destroy_task(tasks[i]);
+    }
+    destroy_network(net);
+    return test_report("completion waits");
+}
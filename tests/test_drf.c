@@ -0,0 +1,98 @@
+// Dominant Resource Fairness: owners get equal (or weighted) dominant
+// shares, and priority orders tasks within one owner
+#include "test_util.h"
+#include "roc_scheduler.h"
+#include <math.h>
+
+#define PER_OWNER 10
+
+static int running(RTask** tasks, int first, int step, int count) {
+    int n = 0;
+    for (int i = first; i < count; i += step)
+        if (task_status(tasks[i]) == TASK_RUNNING) n++;
+    return n;
+}
+
+// The DRF paper's example: 9 CPUs and 18 memory units. A's tasks need
+// <1 CPU, 4 mem> (memory-dominant), B's <3 CPU, 1 mem> (CPU-dominant).
+// Equal dominant shares mean 3 tasks for A and 2 for B, both at 2/3.
+static void check_equal_shares(void) {
+    RNetwork* net = create_network();
+    RNode* cpu = create_node("cpu", "CPU", 9);
+    RNode* mem = create_node("mem", "Memory", 18);
+    add_node(net, cpu);
+    add_node(net, mem);
+    RTaskScheduler* sched = create_scheduler_workers(2, 0);
+    scheduler_set_network(sched, net);
+
+    // A is queued first and outnumbers B; only its priority 0 task must wait
+    RTask* tasks[2 * PER_OWNER];
+    for (int i = 0; i < PER_OWNER; i++) {
+        RTask* a = create_task("A", i == 0 ? 0 : 5);
+        add_resource_req(a, cpu, 1);
+        add_resource_req(a, mem, 4);
+        a->owner = 1;
+        tasks[2 * i] = a;
+        RTask* b = create_task("B", 0);
+        add_resource_req(b, cpu, 3);
+        add_resource_req(b, mem, 1);
+        b->owner = 2;
+        tasks[2 * i + 1] = b;
+    }
+    for (int i = 0; i < 2 * PER_OWNER; i++) scheduler_add_task(sched, tasks[i]);
+    scheduler_start(sched);
+    roc_sleep_ms(1);
+
+    int a = running(tasks, 0, 2, 2 * PER_OWNER), b = running(tasks, 1, 2, 2 * PER_OWNER);
+    CHECK(a == 3 && b == 2, "A runs %d and B runs %d tasks, want 3 and 2", a, b);
+    CHECK(task_status(tasks[0]) == TASK_PENDING, "A's lowest-priority task started first");
+    double sa = scheduler_owner_share(sched, 1), sb = scheduler_owner_share(sched, 2);
+    CHECK(fabs(sa - 2.0 / 3) < 1e-9 && fabs(sb - 2.0 / 3) < 1e-9, "shares %.3f and %.3f, want 0.667", sa, sb);
+
+    for (int i = 0; i < 2 * PER_OWNER; i++)
+        CHECK(task_wait(tasks[i]) == TASK_COMPLETED, "task %d did not complete", i);
+    sa = scheduler_owner_share(sched, 1);
+    sb = scheduler_owner_share(sched, 2);
+    CHECK(fabs(sa) < 1e-9 && fabs(sb) < 1e-9, "shares %.3f and %.3f left after every task finished", sa, sb);
+
+    destroy_scheduler(sched);
+    for (int i = 0; i < 2 * PER_OWNER; i++) destroy_task(tasks[i]);
+    destroy_network(net);
+}
+
+// One resource, 12 CPUs, unit tasks: weight 2 earns twice the share
+static void check_weights(void) {
+    RNetwork* net = create_network();
+    RNode* cpu = create_node("cpu", "CPU", 12);
+    add_node(net, cpu);
+    RTaskScheduler* sched = create_scheduler_workers(2, 0);
+    scheduler_set_network(sched, net);
+    CHECK(scheduler_set_owner_weight(sched, 2, 2.0), "weight refused");
+    CHECK(!scheduler_set_owner_weight(sched, 3, 0.0), "zero weight accepted");
+
+    RTask* tasks[2 * PER_OWNER];
+    for (int i = 0; i < 2 * PER_OWNER; i++) {
+        tasks[i] = make_task(cpu, i < PER_OWNER ? "A" : "B", 0, 1);
+        tasks[i]->owner = i < PER_OWNER ? 1 : 2;
+        scheduler_add_task(sched, tasks[i]);
+    }
+    scheduler_start(sched);
+    roc_sleep_ms(1);
+
+    int a = running(tasks, 0, 1, PER_OWNER), b = running(tasks, PER_OWNER, 1, 2 * PER_OWNER);
+    CHECK(a == 4 && b == 8, "A runs %d and B runs %d tasks, want 4 and 8", a, b);
+    double sa = scheduler_owner_share(sched, 1), sb = scheduler_owner_share(sched, 2);
+    CHECK(fabs(sa - sb) < 1e-9, "weighted shares %.3f and %.3f differ", sa, sb);
+
+    for (int i = 0; i < 2 * PER_OWNER; i++) task_wait(tasks[i]);
+    destroy_scheduler(sched);
+    for (int i = 0; i < 2 * PER_OWNER; i++) destroy_task(tasks[i]);
+    destroy_network(net);
+}
+
+int main(void) {
+    roc_clock_use_virtual();
+    check_equal_shares();
+    check_weights();
+    return test_report("dominant resource fairness");
+}
@@ -0,0 +1,57 @@
+// EDF admission: deadline tasks are rejected when they could not finish in time
+#include "test_util.h"
+#include "roc_scheduler.h"
+
+static RTask* deadline_task(RNode* node, const char* name, int priority, int amount, long long due_us) {
+    RTask* task = make_task(node, name, priority, amount);
+    if (due_us) task_set_deadline(task, roc_now_us() + due_us);
+    return task;
+}
+
+int main(void) {
+    roc_clock_use_virtual();
+    RNetwork* net = create_network();
+    RNode* node = create_node("n", "CPU", 4);
+    add_node(net, node);
+    RTaskScheduler* sched = create_scheduler_workers(2, 0);
+
+    // T1 and T2 share the node and meet their deadlines ahead of P, which has
+    // none. T3 needs the whole node for longer than its deadline allows.
+    enum { P, T1, T2, T3, COUNT };
+    RTask* tasks[COUNT];
+    tasks[P] = deadline_task(node, "P", 100, 4, 0);
+    tasks[T1] = deadline_task(node, "T1", 0, 2, 500000);
+    tasks[T2] = deadline_task(node, "T2", 0, 2, 450000);
+    tasks[T3] = deadline_task(node, "T3", 0, 4, 900000);
+    for (int i = 0; i < COUNT; i++) scheduler_add_task(sched, tasks[i]);
+    scheduler_start(sched);
+
+    long long started[COUNT], ended[COUNT];
+    watch_tasks(tasks, COUNT, started, ended, 300, 10);
+
+    RSchedDeadlineStats st;
+    scheduler_deadline_stats(sched, &st);
+    CHECK(st.admitted == 2 && st.rejected == 1, "admitted %lld rejected %lld, want 2 and 1",
+          st.admitted, st.rejected);
+    CHECK(st.met == 2 && st.missed == 0, "met %lld missed %lld, want 2 and 0", st.met, st.missed);
+    CHECK(task_status(tasks[T3]) == TASK_FAILED, "infeasible T3 is %d", task_status(tasks[T3]));
+    CHECK(started[P] >= ended[T1] && started[P] >= ended[T2], "P ran before the deadline tasks");
+
+    // L holds the whole node without a deadline; D cannot start before L ends,
+    // which is past its deadline, so admission must reject it
+    RTask* holder[2];
+    holder[0] = deadline_task(node, "L", 0, 4, 0);
+    scheduler_add_task(sched, holder[0]);
+    roc_sleep_ms(1);
+    holder[1] = deadline_task(node, "D", 0, 1, 300000);
+    scheduler_add_task(sched, holder[1]);
+    watch_tasks(holder, 2, started, ended, 300, 10);
+
+    scheduler_deadline_stats(sched, &st);
+    CHECK(task_status(holder[1]) == TASK_FAILED, "D is %d, want rejected", task_status(holder[1]));
+    CHECK(st.rejected == 2 && st.missed == 0, "rejected %lld missed %lld, want 2 and 0",
+          st.rejected, st.missed);
+
+    destroy_scheduler(sched);
+    return test_report("edf admission");
+}
@@ -0,0 +1,61 @@
+// Gangs start all together or not at all
+#include "test_util.h"
+#include "roc_scheduler.h"
+
+#define GANG_SIZE 3
+
+int main(void) {
+    roc_clock_use_virtual();
+    RNetwork* net = create_network();
+    RNode* node = create_node("n", "CPU", 10);
+    add_node(net, node);
+    RTaskScheduler* sched = create_scheduler_workers(4, 0);
+
+    // F holds 6 units; the gang needs 9, so no member may start before F ends.
+    // S (2 units) fits beside F and ends first, so it may run meanwhile.
+    enum { F, G0, G1, G2, S, COUNT };
+    RTask* tasks[COUNT];
+    tasks[F] = make_task(node, "F", 5, 6);
+    scheduler_add_task(sched, tasks[F]);
+    scheduler_start(sched);
+    roc_sleep_ms(1);
+
+    tasks[G0] = make_task(node, "G0", 1, 3);
+    tasks[G1] = make_task(node, "G1", 1, 3);
+    tasks[G2] = make_task(node, "G2", 1, 3);
+    tasks[S] = make_task(node, "S", 1, 2);
+    CHECK(scheduler_add_gang(sched, &tasks[G0], GANG_SIZE), "gang rejected");
+    scheduler_add_task(sched, tasks[S]);
+
+    long long started[COUNT], ended[COUNT];
+    watch_tasks(tasks, COUNT, started, ended, 400, 10);
+
+    for (int i = G0; i <= G2; i++) {
+        CHECK(started[i] >= ended[F], "%s started at %lld while F ran until %lld",
+              tasks[i]->name, started[i], ended[F]);
+        CHECK(started[i] == started[G0], "%s started at %lld, G0 at %lld",
+              tasks[i]->name, started[i], started[G0]);
+        CHECK(task_status(tasks[i]) == TASK_COMPLETED, "%s is %d", tasks[i]->name, task_status(tasks[i]));
+    }
+    CHECK(started[S] >= 0 && started[S] < ended[F], "S was not backfilled beside F");
+
+    // A gang larger than the node can never start: every member fails, none runs
+    RTask* big[GANG_SIZE];
+    for (int i = 0; i < GANG_SIZE; i++) big[i] = make_task(node, "big", 1, 4);
+    CHECK(scheduler_add_gang(sched, big, GANG_SIZE), "oversized gang rejected at submission");
+    long long big_started[GANG_SIZE], big_ended[GANG_SIZE];
+    watch_tasks(big, GANG_SIZE, big_started, big_ended, 50, 10);
+    for (int i = 0; i < GANG_SIZE; i++)
+        CHECK(task_status(big[i]) == TASK_FAILED, "member %d of an oversized gang is %d",
+              i, task_status(big[i]));
+    CHECK(node->available == node->capacity, "%d of %d units left reserved",
+          node->capacity - node->available, node->capacity);
+
+    // More members than SCHED_GANG_MAX are refused outright
+    RTask* many[SCHED_GANG_MAX + 1];
+    for (int i = 0; i <= SCHED_GANG_MAX; i++) many[i] = make_task(node, "m", 1, 0);
+    CHECK(!scheduler_add_gang(sched, many, SCHED_GANG_MAX + 1), "gang above SCHED_GANG_MAX accepted");
+
+    destroy_scheduler(sched);
+    return test_report("gang");
+}
@@ -0,0 +1,71 @@
+// Lock-free submission: concurrent producers lose and duplicate nothing
+#include "test_util.h"
+#include "roc_scheduler.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PRODUCERS 4
+#define PER_PRODUCER 2000
+#define TOTAL (PRODUCERS * PER_PRODUCER)
+
+static RTaskScheduler* sched;
+static RTask* tasks[TOTAL];
+static atomic_int runs[TOTAL];
+static atomic_int completed;
+static pthread_barrier_t go;
+
+static void on_done(void* source, void* arg) {
+    (void)source;
+    atomic_fetch_add(&runs[(intptr_t)arg], 1);
+    atomic_fetch_add(&completed, 1);
+}
+
+static void* producer(void* arg) {
+    int first = (int)(intptr_t)arg * PER_PRODUCER;
+    pthread_barrier_wait(&go);
+    for (int i = first; i < first + PER_PRODUCER; i++)
+        CHECK(scheduler_add_task(sched, tasks[i]), "submission %d refused", i);
+    return NULL;
+}
+
+int main(void) {
+    RNetwork* net = create_network();
+    RNode* node = create_node("n", "CPU", TOTAL);
+    add_node(net, node);
+    sched = create_scheduler_workers(4, 0);
+    scheduler_start(sched);
+
+    for (int i = 0; i < TOTAL; i++) {
+        tasks[i] = make_task(node, "t", i % 7, 0);
+        atomic_init(&runs[i], 0);
+        task_on_complete(tasks[i], on_done, (void*)(intptr_t)i);
+    }
+    atomic_init(&completed, 0);
+
+    // Producers race each other and the dispatcher, which is already draining
+    pthread_t threads[PRODUCERS];
+    pthread_barrier_init(&go, NULL, PRODUCERS);
+    for (int p = 0; p < PRODUCERS; p++)
+        pthread_create(&threads[p], NULL, producer, (void*)(intptr_t)p);
+    for (int p = 0; p < PRODUCERS; p++)
+        pthread_join(threads[p], NULL);
+    pthread_barrier_destroy(&go);
+
+    for (int i = 0; i < TOTAL; i++) task_wait(tasks[i]);
+
+    int bad = 0;
+    for (int i = 0; i < TOTAL; i++) {
+        // A finished task no longer points back at the scheduler
+        if (atomic_load(&runs[i]) == 1 && task_status(tasks[i]) == TASK_COMPLETED && !tasks[i]->on_done)
+            continue;
+        if (bad++ < 3)
+            CHECK(0, "task %d ran %d times, status %d", i, atomic_load(&runs[i]), task_status(tasks[i]));
+    }
+    CHECK(bad == 0, "%d of %d tasks lost or duplicated", bad, TOTAL);
+    CHECK(atomic_load(&completed) == TOTAL, "%d completions for %d tasks", atomic_load(&completed), TOTAL);
+
+    destroy_scheduler(sched);
+    return test_report("lock-free intake");
+}
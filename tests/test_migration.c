@@ -0,0 +1,131 @@
+// Migration engine: chunk-by-chunk capacity accounting, failure and teardown
+#include "test_util.h"
+#include "roc_migration.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define USED 60
+#define CHUNK 10
+
+static pthread_t main_thread;
+static RNode* src;
+static RNode* dst;
+static int progress_calls = 0;
+static int last_moved = 0;
+static atomic_int done_calls;
+static atomic_int done_off_engine;
+
+static int in_use(RNode* node) {
+    pthread_mutex_lock(&node->lock);
+    int used = node->capacity - node->available;
+    pthread_mutex_unlock(&node->lock);
+    return used;
+}
+
+// After every chunk the moved units sit on the target and nowhere else
+static void on_progress(RMigration* m, int moved, int total, double units_per_sec, void* arg) {
+    (void)m;
+    (void)arg;
+    progress_calls++;
+    CHECK(moved == last_moved + CHUNK && total == USED, "progress %d/%d after %d", moved, total, last_moved);
+    CHECK(in_use(dst) == moved, "target holds %d units after %d moved", in_use(dst), moved);
+    CHECK(in_use(src) == USED - moved, "source holds %d units after %d moved", in_use(src), moved);
+    CHECK(units_per_sec > 0, "throughput %.1f after %d units", units_per_sec, moved);
+    last_moved = moved;
+}
+
+// arg counts the calls; on_done may still run after migration_wait returns
+static void on_done(RMigration* m, void* arg) {
+    (void)m;
+    if (arg) atomic_fetch_add((atomic_int*)arg, 1);
+    if (pthread_equal(pthread_self(), main_thread)) atomic_fetch_add(&done_off_engine, 1);
+}
+
+int main(void) {
+    roc_clock_use_virtual();
+    main_thread = pthread_self();
+    atomic_init(&done_calls, 0);
+    atomic_init(&done_off_engine, 0);
+
+    RNetwork* net = create_network();
+    src = create_node("src", "CPU", 100);
+    RNode* mid = create_node("mid", "CPU", 100);
+    dst = create_node("dst", "CPU", 100);
+    RNode* small = create_node("small", "CPU", 25);
+    add_node(net, src);
+    add_node(net, mid);
+    add_node(net, dst);
+    add_node(net, small);
+    create_link(net, src, mid, 100, 5);
+    create_link(net, mid, dst, 100, 5);
+    create_link(net, mid, small, 100, 5);
+    RController* ctrl = create_controller(net, POLICY_LATENCY);
+    RMigrationEngine* engine = create_migration_engine(ctrl, 2);
+
+    // Progress in whole chunks, capacity moving with each one
+    reserve(src, USED);
+    RMigration* m = migration_submit(engine, src, dst, USED, CHUNK, on_progress, on_done, NULL);
+    CHECK(migration_wait(m) == MIGRATION_COMPLETED, "migration did not complete");
+    CHECK(progress_calls == USED / CHUNK, "%d progress calls for %d chunks", progress_calls, USED / CHUNK);
+    CHECK(migration_moved(m) == USED && atomic_load(&engine->total_moved) == USED,
+          "moved %d, engine total %lld", migration_moved(m), atomic_load(&engine->total_moved));
+    CHECK(in_use(src) == 0 && in_use(dst) == USED, "source holds %d, target %d", in_use(src), in_use(dst));
+    CHECK(migration_throughput(m) > 0, "no throughput for a finished migration");
+    migration_release(m);
+
+    // A target without room fails mid-way; the chunks that landed stay there
+    release(dst, USED);
+    reserve(src, USED);
+    m = migration_submit(engine, src, small, USED, CHUNK, NULL, on_done, NULL);
+    CHECK(migration_wait(m) == MIGRATION_FAILED, "migration into a small target did not fail");
+    CHECK(migration_moved(m) == 20, "moved %d units into 25 free, want 20", migration_moved(m));
+    CHECK(in_use(small) == 20 && in_use(src) == USED - 20, "target holds %d, source %d",
+          in_use(small), in_use(src));
+    migration_release(m);
+    release(small, 20);
+    release(src, USED - 20);
+
+    // Teardown: queued migrations fail, their callbacks on an engine thread
+    reserve(src, 100);
+    RMigration* queued[6];
+    for (int i = 0; i < 6; i++)
+        queued[i] = migration_submit(engine, src, i % 2 ? dst : mid, 10, 1, NULL, on_done, &done_calls);
+    destroy_migration_engine(engine);
+    int failed = 0;
+    for (int i = 0; i < 6; i++) {
+        MigrationStatus s = migration_wait(queued[i]);
+        if (s == MIGRATION_FAILED) failed++;
+        CHECK(s == MIGRATION_COMPLETED || migration_moved(queued[i]) == 0,
+              "queued migration %d failed after moving %d units", i, migration_moved(queued[i]));
+        migration_release(queued[i]);
+    }
+    CHECK(failed > 0, "every queued migration ran before teardown");
+    CHECK(atomic_load(&done_calls) == 6, "%d done callbacks for 6 migrations", atomic_load(&done_calls));
+    CHECK(atomic_load(&done_off_engine) == 0, "%d done callbacks ran on the destroying thread",
+          atomic_load(&done_off_engine));
+    CHECK(in_use(src) + in_use(mid) + in_use(dst) == 100, "%d units in use after teardown, want 100",
+          in_use(src) + in_use(mid) + in_use(dst));
+    release(src, in_use(src));
+    release(mid, in_use(mid));
+    release(dst, in_use(dst));
+
+    // The one-off calls claim the target and leave it alone when it is full
+    reserve(src, 30);
+    RPacket pkt = { .src = src, .dst = dst, .amount = 30 };
+    CHECK(migrate(&pkt, src, dst), "migrate failed");
+    CHECK(in_use(src) == 0 && in_use(dst) == 30, "migrate left source %d, target %d", in_use(src), in_use(dst));
+    reserve(small, 25);
+    CHECK(!migrate_timed(dst, small, 30, 500), "migrate_timed into a full target succeeded");
+    CHECK(in_use(dst) == 30 && in_use(small) == 25, "failed migrate_timed moved capacity: %d / %d",
+          in_use(dst), in_use(small));
+    release(small, 25);
+    CHECK(migrate_timed(dst, small, 20, 500), "migrate_timed failed");
+    CHECK(in_use(dst) == 10 && in_use(small) == 20, "migrate_timed left source %d, target %d",
+          in_use(dst), in_use(small));
+    roc_sleep_ms(600);
+    CHECK(in_use(small) == 0, "target still holds %d units after the timeout", in_use(small));
+
+    destroy_controller(ctrl);
+    destroy_network(net);
+    return test_report("migration engine");
+}
@@ -0,0 +1,122 @@
+// Placement engine lookups against a linear scan of the network
+#include "test_util.h"
+#include "roc_placement.h"
+#include <string.h>
+
+#define NODES 300
+#define STEPS 3000
+#define LIVE_MAX 400
+
+static const char* policy_names[] = { "best-fit", "worst-fit", "first-fit" };
+
+// The node a linear scan picks, ties broken by the lower id; -1 if none fits
+static int linear_scan(RNetwork* net, const char* type, int need, PlacementPolicy policy) {
+    int best = -1;
+    for (int i = 0; i < net->node_count; i++) {
+        RNode* node = net->nodes[i];
+        if (type && strcmp(node->type, type) != 0) continue;
+        int avail = monitor(node);
+        if (avail < need) continue;
+        if (best < 0) {
+            best = i;
+            continue;
+        }
+        int best_avail = monitor(net->nodes[best]);
+        if ((policy == PLACE_BEST_FIT && avail < best_avail) ||
+            (policy == PLACE_WORST_FIT && avail > best_avail))
+            best = i;
+    }
+    return best;
+}
+
+static void drop(RTask* task) {
+    release_task(task);
+    destroy_task(task);
+}
+
+static void check_policy(RNetwork* net, PlacementPolicy policy) {
+    RPlacement* p = create_placement(net, policy);
+    RTask* live[LIVE_MAX];
+    int live_count = 0;
+    int mismatches = 0;
+
+    for (int step = 0; step < STEPS; step++) {
+        if (live_count > 0 && (test_rand(3) == 0 || live_count == LIVE_MAX)) {
+            int k = test_rand(live_count);
+            drop(live[k]);
+            live[k] = live[--live_count];
+            continue;
+        }
+
+        // Reservations made behind the engine's back must reach the index too
+        if (test_rand(10) == 0) {
+            RNode* node = net->nodes[test_rand(net->node_count)];
+            if (reserve(node, 1)) {
+                RTask* outside = create_task("outside", 0);
+                add_resource_req(outside, node, 1);
+                outside->status = TASK_RUNNING;
+                live[live_count++] = outside;
+            }
+            continue;
+        }
+
+        const char* type = test_rand(4) == 0 ? NULL : (test_rand(2) ? "CPU" : "GPU");
+        int need = 1 + test_rand(8);
+        int want = linear_scan(net, type, need, policy);
+
+        RTask* task = create_task("t", 0);
+        add_resource_any(task, type, need, 0);
+        int placed = placement_try_allocate(p, task);
+        int got = placed ? task->resources[0].node->id : -1;
+        if (got != want && mismatches++ < 3)
+            CHECK(0, "%s: %d units of %s went to %d, scan picks %d",
+                  policy_names[policy], need, type ? type : "any", got, want);
+
+        if (placed) live[live_count++] = task;
+        else destroy_task(task);
+    }
+    CHECK(mismatches == 0, "%s: %d of %d lookups differ", policy_names[policy], mismatches, STEPS);
+
+    while (live_count) drop(live[--live_count]);
+    destroy_placement(p);
+}
+
+// Requirements sharing a group land on one host
+static void check_colocation(RNetwork* net) {
+    RPlacement* p = create_placement(net, PLACE_BEST_FIT);
+    for (int i = 0; i < 50; i++) {
+        RTask* task = create_task("group", 0);
+        add_resource_any(task, "GPU", 1, 7);
+        add_resource_any(task, "CPU", 2, 7);
+        add_resource_any(task, "CPU", 1, 0);
+        if (!placement_try_allocate(p, task)) {
+            CHECK(0, "co-located task %d could not be placed", i);
+            destroy_task(task);
+            continue;
+        }
+        CHECK(task->resources[0].node->host == task->resources[1].node->host,
+              "group split across hosts %d and %d",
+              task->resources[0].node->host, task->resources[1].node->host);
+        drop(task);
+    }
+    destroy_placement(p);
+}
+
+int main(void) {
+    RNetwork* net = create_network();
+    char name[32];
+    for (int i = 0; i < NODES; i++) {
+        snprintf(name, sizeof(name), "n%d", i);
+        RNode* node = create_node(name, i % 3 == 0 ? "GPU" : "CPU", 1 + test_rand(16));
+        node->host = i / 3;
+        add_node(net, node);
+    }
+
+    check_policy(net, PLACE_BEST_FIT);
+    check_policy(net, PLACE_WORST_FIT);
+    check_policy(net, PLACE_FIRST_FIT);
+    check_colocation(net);
+
+    destroy_network(net);
+    return test_report("placement");
+}
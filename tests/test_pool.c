@@ -0,0 +1,63 @@
+// Worker pool: delayed jobs become runnable on time while every worker is busy
+#include "test_util.h"
+#include "roc_pool.h"
+#include <stdatomic.h>
+
+#define WORKERS 2
+#define LOAD_JOBS 4
+#define DELAYED 10
+#define MAX_LATE_US 20000
+
+static RWorkerPool* pool;
+static RPoolJob load[LOAD_JOBS];
+static RPoolJob delayed[DELAYED];
+static long long due[DELAYED];
+static atomic_llong ran[DELAYED];
+static atomic_int stop;
+
+// Busy for 200 us, then queue itself again on this worker's deque: the
+// workers never run out of work while the load lasts
+static void busy(void* arg) {
+    long long until = roc_now_us() + 200;
+    while (roc_now_us() < until) {}
+    if (!atomic_load(&stop)) worker_pool_submit_job(pool, (RPoolJob*)arg, -1);
+}
+
+static void record(void* arg) {
+    int i = (int)((RPoolJob*)arg - delayed);
+    atomic_store(&ran[i], roc_now_us());
+}
+
+int main(void) {
+    // Real time: a virtual clock never advances while workers spin
+    pool = create_worker_pool(WORKERS, 0);
+    atomic_init(&stop, 0);
+    for (int i = 0; i < LOAD_JOBS; i++) {
+        load[i].fn = busy;
+        load[i].arg = &load[i];
+        load[i].owned = 0;
+        worker_pool_submit_job(pool, &load[i], -1);
+    }
+    roc_sleep_ms(20);
+
+    // Higher band than the load, so only promotion can hold them back
+    for (int i = 0; i < DELAYED; i++) {
+        delayed[i].fn = record;
+        delayed[i].arg = &delayed[i];
+        delayed[i].owned = 0;
+        atomic_init(&ran[i], -1);
+        long long delay = 10000 + 10000LL * ((i * 7) % DELAYED);
+        due[i] = roc_now_us() + delay;
+        worker_pool_submit_job_after(pool, &delayed[i], 0, delay);
+    }
+    roc_sleep_ms(150);
+    atomic_store(&stop, 1);
+    destroy_worker_pool(pool);
+
+    for (int i = 0; i < DELAYED; i++) {
+        long long r = atomic_load(&ran[i]);
+        CHECK(r >= due[i], "delayed job %d ran %lld us early", i, due[i] - r);
+        CHECK(r < due[i] + MAX_LATE_US, "delayed job %d ran %lld us late under load", i, r - due[i]);
+    }
+    return test_report("worker pool");
+}
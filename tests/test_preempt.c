@@ -0,0 +1,79 @@
+// Preemption: the head starts at once, a victim's on_evict runs before it
+// can start again, and it resumes from its progress
+#include "test_util.h"
+#include "roc_scheduler.h"
+#include <stdatomic.h>
+
+#define UNIT_MS 200
+
+static RNode* node;
+static RTask* victim;
+static atomic_int armed;
+static atomic_int evictions;
+static atomic_int status_in_hook;
+static long long progress_in_hook = -1;
+
+static int on_evict(RTask* task, long long progress_us, void* arg) {
+    (void)arg;
+    atomic_fetch_add(&evictions, 1);
+    atomic_store(&status_in_hook, task_status(task));
+    progress_in_hook = progress_us;
+    return 1;   // keep the progress
+}
+
+// The head's reservation frees the units held outside the scheduler, in
+// the middle of the pass: the victim fits again at once
+static void on_reserve(RNode* n, void* arg) {
+    (void)arg;
+    if (atomic_exchange(&armed, 0)) release(n, 5);
+}
+
+int main(void) {
+    roc_clock_use_virtual();
+    atomic_init(&armed, 0);
+    atomic_init(&evictions, 0);
+    atomic_init(&status_in_hook, -1);
+
+    RNetwork* net = create_network();
+    node = create_node("n", "CPU", 10);
+    add_node(net, node);
+    RTaskScheduler* sched = create_scheduler_workers(2, 0);
+    scheduler_set_preemption(sched, 1);
+    scheduler_start(sched);
+    RNodeWatcher* w = node_watch_all(node, NULL, on_reserve, NULL);
+
+    reserve(node, 5);
+    victim = make_task(node, "low", 0, 5);
+    task_set_evict(victim, on_evict, NULL);
+    long long t0 = roc_now_ms();
+    scheduler_add_task(sched, victim);
+    roc_sleep_ms(UNIT_MS);
+    CHECK(task_status(victim) == TASK_RUNNING, "victim is %d before the head arrives", task_status(victim));
+
+    atomic_store(&armed, 1);
+    RTask* head = make_task(node, "high", 10, 5);
+    scheduler_add_task(sched, head);
+    roc_sleep_ms(1);
+    CHECK(task_status(head) == TASK_RUNNING, "head is %d, not started by evicting", task_status(head));
+    CHECK(atomic_load(&evictions) == 1, "%d evictions", atomic_load(&evictions));
+    CHECK(atomic_load(&status_in_hook) == TASK_PREEMPTED, "victim was %d while its on_evict ran",
+          atomic_load(&status_in_hook));
+    CHECK(progress_in_hook >= UNIT_MS * 1000LL, "on_evict saw %lld us of progress", progress_in_hook);
+
+    // Restarted in the space freed mid-pass, it finishes its remaining work
+    // only: 5 units of 200 ms, one of which ran before the eviction
+    CHECK(task_wait(victim) == TASK_COMPLETED, "victim did not complete");
+    long long took = roc_now_ms() - t0;
+    CHECK(took >= 5 * UNIT_MS && took < 5 * UNIT_MS + 20, "victim finished after %lld ms, want %d",
+          took, 5 * UNIT_MS);
+    CHECK(task_wait(head) == TASK_COMPLETED, "head did not complete");
+    CHECK(atomic_load(&evictions) == 1, "%d evictions", atomic_load(&evictions));
+    CHECK(node->available == node->capacity, "%d units still held", node->capacity - node->available);
+
+    node_unwatch(w);
+    destroy_scheduler(sched);
+    destroy_task(victim);
+    destroy_task(head);
+    destroy_network(net);
+    return test_report("preemption");
+}
@@ -0,0 +1,116 @@
+// Topology snapshots: routes match the live searches and ignore later edits
+#include "test_util.h"
+#include "roc_topology.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define NODES 200
+#define QUERIES 500
+
+static long long path_latency(RLink** path, int plen) {
+    long long sum = 0;
+    for (int i = 0; i < plen; i++) sum += path[i]->latency;
+    return sum;
+}
+
+static RNetwork* net;
+static atomic_int stop;
+
+// Rewrites link attributes while the searches run
+static void* writer(void* arg) {
+    (void)arg;
+    unsigned int seed = 99;
+    while (!atomic_load(&stop)) {
+        seed = seed * 1103515245u + 12345u;
+        RLink* l = net->links[(seed >> 8) % (unsigned int)net->link_count];
+        set_link_latency(l, 1 + (int)((seed >> 4) % 50));
+        set_link_bandwidth(l, 10 + (int)((seed >> 12) % 100));
+    }
+    return NULL;
+}
+
+int main(void) {
+    net = create_network();
+    char name[32];
+    for (int i = 0; i < NODES; i++) {
+        snprintf(name, sizeof(name), "n%d", i);
+        add_node(net, create_node(name, "CPU", 10));
+    }
+    for (int i = 1; i < NODES; i++)
+        create_link(net, net->nodes[i], net->nodes[test_rand(i)], 10 + test_rand(100), 1 + test_rand(50));
+    for (int i = 0; i < NODES * 2; i++) {
+        int a = test_rand(NODES), b = test_rand(NODES);
+        if (a != b) create_link(net, net->nodes[a], net->nodes[b], 10 + test_rand(100), 1 + test_rand(50));
+    }
+
+    // Same answers as the searches over the live network
+    RTopology* topo = topology_snapshot(net);
+    RLink* want[MAX_PATH_LEN];
+    RLink* got[MAX_PATH_LEN];
+    int pairs[QUERIES][2];
+    long long cost[QUERIES];
+    int mismatches = 0;
+    for (int q = 0; q < QUERIES; q++) {
+        RNode* src = net->nodes[test_rand(NODES)];
+        RNode* dst = net->nodes[test_rand(NODES)];
+        int wlen = 0, glen = 0;
+        int found = find_path_latency(net, src, dst, want, &wlen);
+        int snap = topology_find_path(topo, POLICY_LATENCY, src, dst, 0, got, &glen);
+        pairs[q][0] = src->id;
+        pairs[q][1] = dst->id;
+        cost[q] = snap ? path_latency(got, glen) : -1;
+        if (found != snap || (found && path_latency(want, wlen) != cost[q])) mismatches++;
+    }
+    CHECK(mismatches == 0, "%d of %d snapshot routes differ from find_path_latency", mismatches, QUERIES);
+
+    // Edits after the snapshot must not change its answers, even mid-search
+    pthread_t thread;
+    atomic_init(&stop, 0);
+    pthread_create(&thread, NULL, writer, NULL);
+    int moved = 0;
+    RLink* prev[NODES];
+    for (int q = 0; q < QUERIES; q++) {
+        int src = pairs[q][0], dst = pairs[q][1];
+        if (cost[q] < 0 || !topology_search(topo, POLICY_LATENCY, src, dst, prev)) continue;
+        // Re-derive the cost from the snapshot arrays the search used
+        long long sum = 0;
+        for (int v = dst; v != src; ) {
+            RLink* l = prev[v];
+            int u = topology_index(topo, (l->a == topo->nodes[v]) ? l->b : l->a);
+            for (int i = topo->adj_off[u]; i < topo->adj_off[u + 1]; i++)
+                if (topo->adj_link[i] == l) {
+                    sum += topo->adj_latency[i];
+                    break;
+                }
+            v = u;
+        }
+        if (sum != cost[q]) moved++;
+    }
+    atomic_store(&stop, 1);
+    pthread_join(thread, NULL);
+    CHECK(moved == 0, "%d snapshot routes changed after later link edits", moved);
+
+    // A new snapshot sees the edits
+    RTopology* fresh = topology_snapshot(net);
+    CHECK(fresh->version != topo->version, "snapshot version did not move with the edits");
+    topology_release(fresh);
+    topology_release(topo);
+
+    // The cached snapshot is shared until the network changes
+    RTopology* cached = topology_current(net);
+    int len = 0;
+    find_path_least_loaded(net, net->nodes[0], net->nodes[1], got, &len);
+    find_path_fastest(net, net->nodes[0], net->nodes[1], 10, got, &len);
+    RTopology* again = topology_current(net);
+    CHECK(again == cached, "routing rebuilt the snapshot of an unchanged network");
+    topology_release(again);
+    set_link_latency(net->links[0], 7);
+    again = topology_current(net);
+    CHECK(again != cached && again->version == atomic_load(&net->version),
+          "cached snapshot not rebuilt after a link edit");
+    topology_release(again);
+    topology_release(cached);
+
+    destroy_network(net);
+    return test_report("topology snapshot");
+}
@@ -0,0 +1,81 @@
+// Transfer engine: cut-through pipelining and teardown with transfers in flight
+#include "test_util.h"
+#include "roc_transfer.h"
+#include "roc_linkq.h"
+
+#define PARKED 5
+
+static atomic_int callbacks;
+
+static void on_transfer(RTransfer* transfer, void* arg) {
+    (void)transfer;
+    (void)arg;
+    atomic_fetch_add(&callbacks, 1);
+}
+
+static long long timed_transfer(RTransferEngine* engine, RNode* src, RLink** path, int plen,
+                                RPacket* pkt, int flags, TransferStatus* status) {
+    long long t0 = roc_now_ms();
+    RTransfer* t = transfer_submit(engine, src, path, plen, pkt, POLICY_SHORTEST, 10, flags, NULL, NULL);
+    *status = t ? transfer_wait(t) : TRANSFER_FAILED;
+    transfer_release(t);
+    return roc_now_ms() - t0;
+}
+
+int main(void) {
+    roc_clock_use_virtual();
+    RNetwork* net = create_network();
+    RNode* nodes[4];
+    const char* names[4] = { "a", "b", "c", "d" };
+    for (int i = 0; i < 4; i++) {
+        nodes[i] = create_node(names[i], "CPU", 100);
+        add_node(net, nodes[i]);
+    }
+    // 100 units/s and 10 ms per hop: 100 units take 1 s to cross one hop
+    for (int i = 0; i < 3; i++) create_link(net, nodes[i], nodes[i + 1], 100, 10);
+
+    RLink* path[MAX_PATH_LEN];
+    int plen = 0;
+    CHECK(find_path_latency(net, nodes[0], nodes[3], path, &plen) && plen == 3, "no 3-hop path");
+    RTransferEngine* engine = create_transfer_engine(2);
+    RPacket pkt = { .src = nodes[0], .dst = nodes[3], .amount = 100 };
+
+    // Store-and-forward pays the full serialization on every hop; cut-through
+    // pays it once plus one chunk per extra hop
+    TransferStatus st;
+    long long sf = timed_transfer(engine, nodes[0], path, plen, &pkt, 0, &st);
+    CHECK(st == TRANSFER_COMPLETED, "store-and-forward transfer is %d", st);
+    CHECK(sf >= 3030 && sf < 3100, "store-and-forward took %lld ms, want about 3030", sf);
+    long long ct = timed_transfer(engine, nodes[0], path, plen, &pkt, TRANSFER_CUT_THROUGH, &st);
+    CHECK(st == TRANSFER_COMPLETED, "cut-through transfer is %d", st);
+    CHECK(ct >= 1230 && ct < 1300, "cut-through took %lld ms, want about 1230", ct);
+    CHECK(nodes[0]->available == nodes[0]->capacity, "source kept %d units reserved",
+          nodes[0]->capacity - nodes[0]->available);
+
+    // Hold the first hop so every new transfer parks in its queue, then tear
+    // the engine down: each transfer fails once and the queue is left empty
+    RLinkQueue* txq = path[plen - 1]->txq;
+    CHECK(linkq_acquire(txq, 0, 1, NULL, NULL), "first hop was busy");
+    RTransfer* parked[PARKED];
+    RPacket small = { .src = nodes[0], .dst = nodes[3], .amount = 10 };
+    atomic_init(&callbacks, 0);
+    for (int i = 0; i < PARKED; i++)
+        parked[i] = transfer_submit(engine, nodes[0], path, plen, &small, POLICY_SHORTEST, 5,
+                                    i % 2 ? TRANSFER_CUT_THROUGH : 0, on_transfer, NULL);
+    roc_sleep_ms(50);
+    CHECK(linkq_waiting(txq) > 0, "no transfer queued for the held link");
+
+    destroy_transfer_engine(engine);
+    CHECK(linkq_waiting(txq) == 0, "%d engine pieces left in the link queue", linkq_waiting(txq));
+    for (int i = 0; i < PARKED; i++) {
+        CHECK(transfer_wait(parked[i]) == TRANSFER_FAILED, "parked transfer %d did not fail", i);
+        transfer_release(parked[i]);
+    }
+    CHECK(atomic_load(&callbacks) == PARKED, "%d callbacks for %d transfers", atomic_load(&callbacks), PARKED);
+    CHECK(nodes[0]->available == nodes[0]->capacity, "source kept %d units reserved",
+          nodes[0]->capacity - nodes[0]->available);
+    linkq_release(txq);   // nothing of the freed engine may be granted now
+
+    destroy_network(net);
+    return test_report("transfer engine");
+}
@@ -0,0 +1,63 @@
+#ifndef ROC_TEST_UTIL_H
+#define ROC_TEST_UTIL_H
+
+#include "roc.h"
+#include "roc_task.h"
+#include "roc_clock.h"
+#include <stdio.h>
+
+// =====================
+// Test helpers
+// =====================
+// Every test is a standalone program built by test.bat. CHECK() prints the
+// failed condition and keeps going; test_report() turns the tally into the
+// exit code.
+static int test_failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            test_failures++;                                    \
+            printf("  FAIL %s:%d: ", __FILE__, __LINE__);       \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+static inline int test_report(const char* name) {
+    printf("[%s] %s: %s\n", test_failures ? "!" : "+", name, test_failures ? "FAILED" : "ok");
+    return test_failures != 0;
+}
+
+// Deterministic generator so a failure reproduces on every platform
+static unsigned int test_seed = 12345;
+static inline int test_rand(int n) {
+    test_seed = test_seed * 1103515245u + 12345u;
+    return (int)((test_seed >> 8) % (unsigned int)n);
+}
+
+static inline RTask* make_task(RNode* node, const char* name, int priority, int amount) {
+    RTask* task = create_task(name, priority);
+    add_resource_req(task, node, amount);
+    return task;
+}
+
+// Poll the tasks on the (virtual) clock for steps * step_ms and record when
+// each one left TASK_PENDING and when it reached a final state (-1 = never).
+// Times are relative to the call.
+static inline void watch_tasks(RTask** tasks, int count, long long* started, long long* ended,
+                               int steps, int step_ms) {
+    long long t0 = roc_now_ms();
+    for (int i = 0; i < count; i++) started[i] = ended[i] = -1;
+
+    for (int s = 0; s < steps; s++) {
+        long long now = roc_now_ms() - t0;
+        for (int i = 0; i < count; i++) {
+            TaskStatus st = task_status(tasks[i]);
+            if (st != TASK_PENDING && started[i] < 0) started[i] = now;
+            if ((st == TASK_COMPLETED || st == TASK_FAILED) && ended[i] < 0) ended[i] = now;
+        }
+        roc_sleep_ms(step_ms);
+    }
+}
+
+#endif
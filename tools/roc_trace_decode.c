@@ -0,0 +1,63 @@
+// Decode a ROC binary trace into one text line per record.
+//   gcc -Iinclude tools/roc_trace_decode.c -o roc_trace_decode
+//   ./roc_trace_decode trace.bin [--sort]
+#include "roc_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROC_TRACE_LABEL(name, label) label,
+static const char* event_names[] = { ROC_TRACE_EVENTS(ROC_TRACE_LABEL) };
+#undef ROC_TRACE_LABEL
+
+static int by_time(const void* a, const void* b) {
+    const RTraceRecord* x = (const RTraceRecord*)a;
+    const RTraceRecord* y = (const RTraceRecord*)b;
+    if (x->time_us != y->time_us) return x->time_us < y->time_us ? -1 : 1;
+    return (x->thread > y->thread) - (x->thread < y->thread);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s <trace file> [--sort]\n", argv[0]);
+        return 1;
+    }
+    int sort = argc > 2 && strcmp(argv[2], "--sort") == 0;
+
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) {
+        printf("Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    RTraceHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, ROC_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ROC_TRACE_VERSION || header.record_size != sizeof(RTraceRecord)) {
+        printf("%s is not a version %d ROC trace\n", argv[1], ROC_TRACE_VERSION);
+        fclose(f);
+        return 1;
+    }
+
+    // Records are grouped per thread on disk; --sort interleaves them by time
+    int count = 0, capacity = 4096;
+    RTraceRecord* records = malloc(capacity * sizeof(RTraceRecord));
+    while (fread(&records[count], sizeof(RTraceRecord), 1, f) == 1) {
+        if (++count == capacity) {
+            capacity *= 2;
+            records = realloc(records, capacity * sizeof(RTraceRecord));
+        }
+    }
+    fclose(f);
+    if (sort) qsort(records, count, sizeof(RTraceRecord), by_time);
+
+    printf("%14s %6s %-16s %6s %6s %6s %8s\n", "time_us", "thread", "event", "node_a", "node_b", "link", "amount");
+    for (int i = 0; i < count; i++) {
+        RTraceRecord* r = &records[i];
+        const char* name = r->event < TRACE_EVENT_COUNT ? event_names[r->event] : "?";
+        printf("%14lld %6u %-16s %6d %6d %6d %8d\n", (long long)r->time_us, r->thread, name,
+               r->node_a, r->node_b, r->link, r->amount);
+    }
+    free(records);
+    return 0;
+}